@@ -3,13 +3,13 @@
  * 
  * Description:
  * Multi-stream audio playback engine for RP2350.
- * Supports simultaneous playback of up to 3 streams (WAV or MP3).
+ * Supports simultaneous playback of up to 3 streams (WAV, MP3 or QOA).
  * Sound file manifest handling; so your droid knows what sounds are available.
  * 
  * Features:
  * - 3 Independent Audio Streams
  * - Supports new CHIRP serial commands and legacy MP3 Trigger commands
- * - Dual MP3 Decoders (Helix) running on Core 0
+ * - Pooled MP3 Decoders (Helix) on Core 0, allocated on demand in PSRAM
  * - Ring Buffers in PSRAM (512KB per stream) for glitch-free playback
  * - Automatic mixing on Core 1
  * - Dynamic resource allocation for decoders
@@ -22,6 +22,10 @@
  * with the CHIRP Audio Trigger. It will play 48kHz, but then will be slowed ~92% and not
  * sound good.
  * To keep filesizes down, it's recommended to use mono WAV files. Stereo MP3's are fine.
+ * WAV files may be 8, 16, 24 or 32-bit PCM or 32-bit float (including the
+ * WAVE_FORMAT_EXTENSIBLE headers DAWs write); everything is converted to 16-bit for mixing.
+ * QOA files (.qoa, made with tools/wav2qoa.py) are ~5x smaller than WAV but nearly as
+ * cheap to decode as WAV, so they're the best choice when several SD streams play at once.
  *
  * SD Card Structure for Droid Use:
  * Files can be stored similarly to Padawan/MP3 Trigger, but to take full advantage
@@ -42,8 +46,10 @@
  *   SD:/1A_R2D2/happy_02.wav
  * Sound Bank 1 files are transfered from the SD card to flash memory at startup, allowing
  * these sounds to always be available with minimal system overhead needed.
+ * With #BANK1_RESIDENT ON in CHIRP.INI they are also loaded from flash into PSRAM in the
+ * background after boot, and played from there without any file I/O.
  * Sound Banks 2-6 have looser rules. Files can still be grouped by ending similar sounds 
- * with variant numbers, but the files can be MP3 or WAV format and of any filesize.
+ * with variant numbers, but the files can be MP3, WAV or QOA format and of any filesize.
  * Different pages of sounds are defined by the letter in the folder name following the
  * Sound Bank number. File names should be kept short as possible while keeping them
  * identifiable to the user. For example...
@@ -65,6 +71,30 @@
  * LIST : Get a list of Sound Banks and Pages
  * GNME : Get Name of a sound in a provided sound bank and page
  * STAT : display the Status of each stream
+ * PAUS : pause a stream (keeps its file, decoder and buffer)
+ * RESM : resume a paused stream
+ * FADE : ramp a stream's fader (FADE:stream,vol,ms); STOP:n,ms fades out (ms up to 60000)
+ * INPT : button / trigger input status (edge interrupts, gesture counts)
+ * TRIG : trigger pin mapping (#TRIGGER in CHIRP.INI) and trigger latency
+ * MEM  : SRAM/PSRAM use per subsystem, peaks and fragmentation
+ * TASK : Core 0 scheduler task timing (TASK:R resets)
+ * BUFS : per-stream ring level, start threshold and underruns (BUFS:R resets)
+ * PROF : PC sampling profiler, both cores (PROF:ON[,us] / PROF:OFF / PROF:D dump,
+ *        symbolize with tools/chirp_prof.py)
+ * SDIO : SD card wait/hold time per request class, refill gap (SDIO:R resets)
+ * PRED : next-sound prediction and PSRAM pre-roll cache hit rate (PRED:L lists,
+ *        PRED:R resets the counters, PRED:C clears the learned model)
+ * WARM : boot warm-up of the pre-roll cache from the saved hot set (WARM:L lists,
+ *        WARM:S starts it again)
+ * CTLG : sound catalog generation and checksum (CTLG:S rescans banks 2-6 and the
+ *        root tracks in the background, then swaps the catalog in)
+ * ADMT : admission control load vs budget, learned per-file costs (ADMT:L),
+ *        ADMT:ON/OFF, ADMT:B,core0%,sdKB/s sets the budget, ADMT:R resets
+ * XFAD : crossfade time (ms) when a PLAY replaces a playing track, 0 = cut, max 60000
+ * RESD : report Bank 1 PSRAM residency
+ * MP3P : report MP3 decoder pool usage and decode load (MP3P:B,<file> decodes the
+ *        start of an SD MP3 on an SRAM and a PSRAM decoder and compares them)
+ * DSPT : self-test the DSP kernels and report cycle counts
  *
  * Legacy MP3 Trigger Serial Commands:
  * T : Trigger by sound file number (ASCII)
@@ -78,35 +108,14 @@
  */
 
 #include "config.h"
-#include <CRC32.h> // For checksum
 #include <Adafruit_NeoPixel.h>
 
 volatile bool g_allowAudio = false; // Start muted (for startup sync)
 
-// ===================================
-// NEW FUNCTION: Calculate Checksum
-// ===================================
-/*void calculateGlobalChecksum() {
-    Serial.print("Calculating filename checksum... ");
-    CRC32 crc;
-
-    // 1. Checksum Bank 1 (Flash) variant filenames
-    for (int i = 0; i < bank1SoundCount; i++) {
-        for (int v = 0; v < bank1Sounds[i].variantCount; v++) {
-            crc.update(bank1Sounds[i].variants[v], strlen(bank1Sounds[i].variants[v]));
-        }
-    }
-
-    // 2. Checksum Banks 2-6 (SD) filenames
-    for (int i = 0; i < sdBankCount; i++) {
-        for (int f = 0; f < sdBanks[i].fileCount; f++) {
-            crc.update(sdBanks[i].files[f], strlen(sdBanks[i].files[f]));
-        }
-    }
-
-    globalFilenameChecksum = crc.finalize();
-    Serial.println(globalFilenameChecksum);
-}*/
+static void registerTasks(); // Core 0 tasks, below loop()'s helpers
+static void onNavButton(uint8_t input, uint8_t gesture, uint32_t edgeUs);
+static void onFwdButton(uint8_t input, uint8_t gesture, uint32_t edgeUs);
+static void onRevButton(uint8_t input, uint8_t gesture, uint32_t edgeUs);
 
 // ===================================
 // SETUP (Core 0)
@@ -138,31 +147,24 @@ void setup() {
     Serial.printf(  "║  CHIRP Audio Trigger v%s        ║\n", VERSION_STRING);
     Serial.println("╚═══════════════════════════════════════╝");
     Serial.println();
-    Serial.printf("PSRAM: %d KB free\n\n", rp2040.getFreePSRAMHeap() / 1024);
+    Serial.printf("PSRAM: %lu KB free\n\n", psramFreeHeap() / 1024);
     
-    // Buttons
-    pinMode(PIN_BTN_NAV, INPUT_PULLUP);
-    pinMode(PIN_BTN_FWD, INPUT_PULLUP);
-    pinMode(PIN_BTN_REV, INPUT_PULLUP);
+    // Buttons (edge interrupts, see input_events.cpp)
+    registerInput(PIN_BTN_NAV, true, onNavButton);
+    registerInput(PIN_BTN_FWD, true, onFwdButton);
+    registerInput(PIN_BTN_REV, true, onRevButton);
 
     // Initialize Audio System (Streams, Buffers, Flags)
     initAudioSystem();
-    Serial.println("Audio System Initialized (3 Streams, 2 MP3 Decoders)");
+    Serial.printf("Audio System Initialized (%d Streams, up to %d MP3 Decoders)\n", MAX_STREAMS, MP3_POOL_SLOTS);
     
     // Initialize Serial2 Message Queue
     initSerial2Queue();
     Serial.println("Serial2 Message Queue Initialized");
 
-    // Allocate MP3 decoders in PSRAM
-    Serial.print("Allocating MP3 decoders in PSRAM... ");
-    for (int i = 0; i < MAX_MP3_DECODERS; i++) {
-        mp3Decoders[i] = new (pmalloc(sizeof(MP3DecoderHelix))) MP3DecoderHelix(mp3DataCallback);
-        if (!mp3Decoders[i]) {
-            Serial.printf("Decoder %d FAILED! ", i);
-        } else {
-            Serial.printf("Decoder %d OK. ", i);
-        }
-    }
+    // Pre-warm the MP3 decoder pool (SRAM first, then PSRAM; it grows on demand from here)
+    Serial.print("Allocating MP3 decoders... ");
+    initMp3Pool();
     Serial.println();
     
     // Initialize SD Card
@@ -211,11 +213,36 @@ void setup() {
     Serial.println("\n=== Reading CHIRP.INI ===");
     bool fwUpdated = parseIniFile();
     Serial.printf("Active Bank 1 Page set to: %c\n", activeBank1Page);
+    initTriggerInputs();
                   
+    // Scan the card into the boot catalog (catalog.cpp); CTLG:S rescans later
+    Catalog* cat = beginCatalogBuild();
+
     // Scan Bank 1 on SD
     Serial.println("\n=== Scanning Bank 1 (SD Card) ===");
-    scanBank1();
-    Serial.printf("Found %d sounds in Bank 1\n", bank1SoundCount);
+    scanBank1(cat);
+    Serial.printf("Found %d sounds in Bank 1\n", cat->bank1SoundCount);
+
+    // Scan SD banks (2-6)
+    Serial.println("\n=== Scanning Banks 2-6 (SD Card) ===");
+    scanSDBanks(cat);
+    Serial.printf("Found %d bank directories\n", cat->sdBankCount);
+    
+    for (int i = 0; i < cat->sdBankCount; i++) {
+        Serial.printf("  Bank %d%c: %s (%d files)\n",
+                     cat->sdBanks[i].bankNum,
+                     cat->sdBanks[i].page ? cat->sdBanks[i].page : ' ',
+                     cat->sdBanks[i].dirName,
+                     cat->sdBanks[i].fileCount);
+    }
+    
+    // Scan Root Tracks for Legacy Compatibility
+    Serial.println("\n=== Scanning Root Tracks (Legacy) ===");
+    scanRootTracks(cat);
+    
+    // Checksum and publish *after* all banks are scanned
+    publishCatalog(cat);
+    Serial.printf("Filename checksum: %lu\n", catalog()->checksum);
     
     // Sync Bank 1 to Flash
     Serial.println("\n=== Syncing Bank 1 to Flash ===");
@@ -223,61 +250,58 @@ void setup() {
         Serial.println("WARNING: Bank 1 sync incomplete");
     }
     
+    // Start pulling Bank 1 into PSRAM (continues from loop())
+    beginBank1Residency();
+    
     // Re-check flash usage
     LittleFS.info(fsInfo);
     Serial.printf("  Flash Used: %d KB / %d KB (%.1f%%)\n",
                   fsInfo.usedBytes / 1024,
                   fsInfo.totalBytes / 1024,
                   (fsInfo.usedBytes * 100.0) / fsInfo.totalBytes);
-
-    // Scan SD banks (2-6)
-    Serial.println("\n=== Scanning Banks 2-6 (SD Card) ===");
-    scanSDBanks();
-    Serial.printf("Found %d bank directories\n", sdBankCount);
-    
-    for (int i = 0; i < sdBankCount; i++) {
-        Serial.printf("  Bank %d%c: %s (%d files)\n",
-                     sdBanks[i].bankNum,
-                     sdBanks[i].page ? sdBanks[i].page : ' ',
-                     sdBanks[i].dirName,
-                     sdBanks[i].fileCount);
-    }
     
-    // Calculate checksum *after* all banks are scanned
-    //calculateGlobalChecksum();
-    Serial.print("Calculating filename checksum... ");
-    CRC32 crc;
-    // 1. Checksum Bank 1 (Flash) variant filenames
-    for (int i = 0; i < bank1SoundCount; i++) {
-        for (int v = 0; v < bank1Sounds[i].variantCount; v++) {
-            crc.update(bank1Sounds[i].variants[v], strlen(bank1Sounds[i].variants[v]));
-        }
-    }
-    // 2. Checksum Banks 2-6 (SD) filenames
-    for (int i = 0; i < sdBankCount; i++) {
-        for (int f = 0; f < sdBanks[i].fileCount; f++) {
-            crc.update(sdBanks[i].files[f], strlen(sdBanks[i].files[f]));
-        }
-    }
-    globalFilenameChecksum = crc.finalize();
-    Serial.println(globalFilenameChecksum);
-    
-    // Scan Root Tracks for Legacy Compatibility
-    Serial.println("\n=== Scanning Root Tracks (Legacy) ===");
-    scanRootTracks();
+    // Next-sound model (flash) and the PSRAM pre-roll cache it fills
+    Serial.println("\n=== Prefetch ===");
+    loadPredictModel();
+    initPrerollCache();
+    loadHotSet();
+    beginWarmup(); // Cache the hot set from loop(), hottest first
     
     // Enable Audio Output (Unmute)
     g_allowAudio = true;
     delay(100);
 
+    // Core 0 work is run by the scheduler from here on
+    registerTasks();
+    profilerInitCore(); // PROF sampling alarm for this core (Core 1 claims its own in setup1)
+
     Serial.println("\n=== System Ready ===");
     Serial.println("Serial Commands (115200 baud):");
     Serial.println("  PLAY:5         Play Bank 1, Sound 5");
     Serial.println("  PLAY:1,2,B,80  Play Bank 2, Page B, Sound 1, Vol 80");
     Serial.println("  STOP:0           Stop stream 0");
     Serial.println("  STOP:* Stop all streams");
+    Serial.println("  STOP:1,2000      Fade stream 1 out over 2s, then stop");
+    Serial.println("  FADE:1,30,500    Fade stream 1 to 30% over 500ms");
     Serial.println("  VOL:1,50         Set stream 1 volume to 50");
+    Serial.println("  PAUS:1 / RESM:1  Pause / resume stream 1");
+    Serial.println("  XFAD:2000        Crossfade 2s between tracks (0 = cut)");
     Serial.println("  LIST             List all banks");
+    Serial.println("  RESD             Bank 1 PSRAM residency");
+    Serial.println("  MP3P             MP3 decoder pool status");
+    Serial.println("  MP3P:B,<file>    MP3 decode time per placement, same file (idle only)");
+    Serial.println("  DSPT             DSP kernel self-test");
+    Serial.println("  TASK / TASK:R    Core 0 task timing / reset");
+    Serial.println("  INPT             Button/trigger input status");
+    Serial.println("  TRIG             Trigger pins and latency");
+    Serial.println("  MEM              Memory use by subsystem");
+    Serial.println("  BUFS / BUFS:R    Stream buffers and underruns / reset");
+    Serial.println("  PROF:ON / PROF:D Sampling profiler on / dump");
+    Serial.println("  SDIO / SDIO:R    SD card access by class / reset");
+    Serial.println("  PRED / PRED:L    Prefetch hit rate / model and cache");
+    Serial.println("  WARM / WARM:L    Boot cache warm-up progress / hot set");
+    Serial.println("  ADMT / ADMT:L    Admission load and budget / learned costs");
+    Serial.println("  CTLG / CTLG:S    Sound catalog / rescan the card");
     Serial.println("  CHRP:500,100,500,50"); //CHRP:StartHz,EndHz,DurationMs,Volume
     Serial.println("  CCRC             Clear sounds from flash ram"); //CHRP:StartHz,EndHz,DurationMs,Volume
 
@@ -287,71 +311,60 @@ void setup() {
 }
 
 // ===================================
-// LOOP (Core 0)
+// CORE 0 TASKS
 // ===================================
-void loop() {
-    #ifdef DEBUG
-    static uint32_t maxLoopTime = 0;
-    uint32_t startMicros = micros();
-    #endif
-    
-    // Handle serial commands
+// Run by the scheduler (scheduler.cpp); registered at the end of setup()
+
+static void task_serialUsb() {
     processSerialCommands(Serial);   // USB debug
+}
+
+static void task_serial2() {
     processSerialCommands(Serial2);  // ESP32 communication
-    
-    // Update Blinkies
-    updateRuntimeLEDs();
-    
-    // Try to send queued Serial2 messages (up to 5 per loop iteration)
-    // Only sends when CPU is not busy with MP3 decoding
+}
+
+// Try to send queued Serial2 messages (up to 5 per run)
+// Only sends when CPU is not busy with MP3 decoding
+static void task_serialQueue() {
     trySendQueuedMessages(5);
-    
-    // --- Button Handling ---
-    static unsigned long lastBtnCheck = 0;
-    static bool lastNavState = HIGH;
-    static bool lastFwdState = HIGH;
-    static bool lastRevState = HIGH;
-    
-    if (millis() - lastBtnCheck > 50) {
-        lastBtnCheck = millis();
-        
-        bool navState = digitalRead(PIN_BTN_NAV);
-        bool fwdState = digitalRead(PIN_BTN_FWD);
-        bool revState = digitalRead(PIN_BTN_REV);
-        
-        // Active LOW (Pressed = 0)
-        if (lastNavState == HIGH && navState == LOW) action_togglePlayPause();
-        if (lastFwdState == HIGH && fwdState == LOW) action_playNext();
-        if (lastRevState == HIGH && revState == LOW) action_playPrev();
-        
-        lastNavState = navState;
-        lastFwdState = fwdState;
-        lastRevState = revState;
+}
+
+// --- Button Handling ---
+// NAV: click = play/stop, double = restart track, long = fade out and stop
+// FWD / REV: next / previous track straight on the press edge
+static void onNavButton(uint8_t input, uint8_t gesture, uint32_t edgeUs) {
+    if (gesture == INPUT_CLICK) {
+        action_togglePlayPause();
+    } else if (gesture == INPUT_DOUBLE) {
+        action_restartTrack();
+    } else if (gesture == INPUT_LONG) {
+        if (fadeOutStream(1, 1000, &Serial)) Serial.println("COMPAT: Fade out");
     }
-    
-    // --- Main Audio Task ---
-    // Reads from files and fills ring buffers for all active streams
+}
+
+static void onFwdButton(uint8_t input, uint8_t gesture, uint32_t edgeUs) {
+    if (gesture == INPUT_PRESS) action_playNext();
+}
+
+static void onRevButton(uint8_t input, uint8_t gesture, uint32_t edgeUs) {
+    if (gesture == INPUT_PRESS) action_playPrev();
+}
+
+// --- Main Audio Task ---
+// Reads from files and fills ring buffers for all active streams
+static void task_refill() {
     fillStreamBuffers();
-    
-    // Debug: Monitor Buffer Status (every 1s)
-    #ifdef DEBUG
-    static uint32_t lastDebugTime = 0;
-    if (millis() - lastDebugTime > 1000) {
-        lastDebugTime = millis();
-        for (int i = 0; i < MAX_STREAMS; i++) {
-            if (streams[i].active) {
-                int avail = streams[i].ringBuffer->availableForWrite();
-                int used = STREAM_BUFFER_SIZE - 1 - avail;
-                Serial.printf("STRM:%d Used:%d/%d (%.1f%%) R:%d W:%d\n", 
-                    i, used, STREAM_BUFFER_SIZE, (float)used*100.0/STREAM_BUFFER_SIZE,
-                    streams[i].ringBuffer->readPos, streams[i].ringBuffer->writePos);
-            }
-        }
-    }
-    #endif
+}
+
+// Decoder pool (start waiting MP3 streams, free idle decoders, load meter),
+// crossfades, timed fades and auto-stop
+static void task_streams() {
+    serviceMp3Pool();
+    serviceCrossfade();
+    serviceStreamFades();
     
     // Check for stop requests (auto-stop)
-    for (int i = 0; i < MAX_STREAMS; i++) {
+    for (int i = 0; i < MAX_VOICES; i++) {
         // 1. Explicit stop request
         if (streams[i].stopRequested) {
             stopStream(i);
@@ -365,20 +378,66 @@ void loop() {
             }
         }
     }
+}
+
+// Background Bank 1 -> PSRAM load (no-op once finished)
+static void task_residency() {
+    serviceBank1Residency();
+}
+
+// Pre-roll cache fills (idle I/O only), boot warm-up, saving the
+// prediction model and hot set, and catalog rescans
+static void task_prefetch() {
+    servicePrerollCache();
+    servicePredictModel();
+    serviceHotSet();
+    serviceCatalog();
+}
+
+#ifdef DEBUG
+// Debug: Monitor Buffer Status (every 1s) and System Stats (every 5s)
+static void task_debug() {
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (streams[i].active) {
+            int avail = streams[i].ringBuffer->availableForWrite();
+            int used = STREAM_BUFFER_SIZE - 1 - avail;
+            Serial.printf("STRM:%d Used:%d/%d (%.1f%%) R:%d W:%d\n", 
+                i, used, STREAM_BUFFER_SIZE, (float)used*100.0/STREAM_BUFFER_SIZE,
+                streams[i].ringBuffer->readPos, streams[i].ringBuffer->writePos);
+        }
+    }
     
-    // Debug: System Stats (every 5s)
-    #ifdef DEBUG
     static uint32_t lastStatsTime = 0;
     if (millis() - lastStatsTime > 5000) {
         lastStatsTime = millis();
-        Serial.printf("STATS: RAM: %d KB, PSRAM: %d KB, Core0 Max Loop: %d us\n", 
+        Serial.printf("STATS: RAM: %d KB, PSRAM: %d KB (see TASK for loop timing)\n", 
             rp2040.getFreeHeap() / 1024, 
-            rp2040.getFreePSRAMHeap() / 1024,
-            maxLoopTime);
-        maxLoopTime = 0; // Reset max
+            (int)(psramFreeHeap() / 1024));
     }
-    
-    uint32_t loopDuration = micros() - startMicros;
-    if (loopDuration > maxLoopTime) maxLoopTime = loopDuration;
+}
+#endif
+
+static void registerTasks() {
+    //      name        function               class                   period(us) budget(us)
+    addTask("refill",   task_refill,           TASK_PRIO_AUDIO,        0,         2000);
+    addTask("streams",  task_streams,          TASK_PRIO_CONTROL,      0,         500);
+    addTask("serial2",  task_serial2,          TASK_PRIO_CONTROL,      0,         1000);
+    addTask("usb",      task_serialUsb,        TASK_PRIO_CONTROL,      0,         1000);
+    addTask("txqueue",  task_serialQueue,      TASK_PRIO_CONTROL,      1000,      500);
+    addTask("inputs",   serviceInputs,         TASK_PRIO_CONTROL,      1000,      3000);
+    addTask("leds",     updateRuntimeLEDs,     TASK_PRIO_HOUSEKEEPING, 10000,     200);
+    addTask("resident", task_residency,        TASK_PRIO_HOUSEKEEPING, 0,         2000);
+    addTask("prefetch", task_prefetch,         TASK_PRIO_HOUSEKEEPING, 0,         2000);
+    addTask("triglat",  serviceTriggerLatency, TASK_PRIO_HOUSEKEEPING, 1000,      50);
+    addTask("profdump", serviceProfilerDump,   TASK_PRIO_HOUSEKEEPING, 0,         3000);
+    #ifdef DEBUG
+    addTask("debug",    task_debug,            TASK_PRIO_HOUSEKEEPING, 1000000,   5000);
     #endif
 }
+
+// ===================================
+// LOOP (Core 0)
+// ===================================
+void loop() {
+    runScheduler();
+}
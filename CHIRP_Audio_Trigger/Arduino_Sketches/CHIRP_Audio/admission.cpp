@@ -0,0 +1,296 @@
+#include "config.h"
+
+// =================================================================================
+//  ADMISSION CONTROL (ADMT command)
+// =================================================================================
+// Every start used to be let through as long as a decoder was free, so a third
+// MP3 (or one high-bitrate file too many) could push Core 0 past what it can
+// refill in real time, and then every stream underran, not just the new one.
+//
+// Now each start is charged a cost per second of audio:
+//   - Core 0 time: refill, SD read and decode (fillStreamBuffers)
+//   - SD bandwidth: source bytes read from the card
+// and admitStream() (called by startStream) checks it against the budget
+// (#ADMIT in CHIRP.INI, ADMT:B) on top of what is already playing:
+//
+//   fits                       admitted
+//   fits once lower priority   those streams are stopped, lowest priority
+//   streams are stopped        and oldest first, until it fits (steal)
+//   can't fit, HIGH            steals as above, then admitted anyway
+//                              (counted as forced)
+//   can't fit, LOW/NORMAL      rejected, the playing streams are untouched
+//                              (PLAY answers ERR:ADMIT, no PACK:PLAY)
+//
+// Costs are learned per file: when a stream stops after playing long enough,
+// the refill time it actually used goes into a small table keyed by a hash of
+// the path (averaged over plays). Files not in the table yet are charged a
+// conservative default for their type. The crossfade shadow voice is charged
+// but never rejected: the overlap lasts one fade and the rings cover it.
+// Paused streams cost nothing and aren't counted (the shadow, held paused
+// while it prebuffers, is); a resume isn't re-checked.
+
+#define ADMIT_COST_SLOTS 64
+#define ADMIT_MIN_MEASURE_FRAMES (SAMPLE_RATE / 2) // Shorter plays aren't measured
+
+// Defaults until a file has been measured (per second of audio)
+struct TypeCost {
+    uint32_t us;    // Core 0
+    uint32_t bytes; // From SD
+};
+static const TypeCost typeDefaults[] = {
+    { 0, 0 },            // INACTIVE
+    { 15000, 0 },        // WAV_FLASH
+    { 30000, 176400 },   // WAV_SD (16-bit stereo 44.1k)
+    { 220000, 40000 },   // MP3_SD (up to 320kbps)
+    { 2000, 0 },         // WAV_RAM
+    { 60000, 35300 }     // QOA_SD
+};
+
+struct FileCost {
+    uint32_t hash;      // 0 = empty
+    uint32_t us;
+    uint32_t bytes;
+    uint16_t plays;
+    uint32_t lastUsed;  // millis(), for replacement
+    char name[20];      // Tail of the path, for ADMT:L
+};
+
+static FileCost costTable[ADMIT_COST_SLOTS];
+
+bool admissionEnabled = true;
+static uint8_t budgetPct = ADMIT_CORE0_BUDGET_PCT;
+static uint32_t budgetKBps = ADMIT_SD_BUDGET_KBPS;
+
+// Stats
+static uint32_t admitted = 0;
+static uint32_t stolen = 0;
+static uint32_t forced = 0;
+static uint32_t rejected = 0;
+static uint32_t rejectCount = 0; // Same, but never reset (ADMT:R): callers compare it around a start
+
+static FileCost* findCost(uint32_t hash) {
+    for (int i = 0; i < ADMIT_COST_SLOTS; i++) {
+        if (costTable[i].hash == hash) return &costTable[i];
+    }
+    return nullptr;
+}
+
+// Source type from the path alone (startStream's rules, before anything is opened)
+static StreamType guessType(const char* filename) {
+    const char* ext = strrchr(filename, '.');
+    if (strncmp(filename, "/flash/", 7) == 0) {
+        const char* baseName = strrchr(filename, '/') + 1;
+        const uint8_t* data;
+        WavInfo info;
+        return findResidentSound(baseName, &data, &info) ? STREAM_TYPE_WAV_RAM : STREAM_TYPE_WAV_FLASH;
+    }
+    if (ext && strcasecmp(ext, ".mp3") == 0) return STREAM_TYPE_MP3_SD;
+    if (ext && strcasecmp(ext, ".qoa") == 0) return STREAM_TYPE_QOA_SD;
+    return STREAM_TYPE_WAV_SD;
+}
+
+// Load of everything playing except voice 'skip' (per second of audio).
+// A prebuffering crossfade shadow is paused (silent) but already reading
+// and decoding, so it counts.
+static void currentLoad(int skip, uint32_t* us, uint32_t* bytes) {
+    *us = 0;
+    *bytes = 0;
+    for (int i = 0; i < MAX_VOICES; i++) {
+        AudioStream* s = &streams[i];
+        if (i == skip || (s->paused && i != SHADOW_VOICE) || !(s->active || s->waitingForDecoder)) continue;
+        *us += s->costUs;
+        *bytes += s->costBytes;
+    }
+}
+
+// A playing stream a start of 'priority' on voice 'streamIdx' may stop
+static bool stealable(int i, int streamIdx, uint8_t priority) {
+    AudioStream* v = &streams[i];
+    if (i == streamIdx || v->paused || !(v->active || v->waitingForDecoder)) return false;
+    return v->priority < priority;
+}
+
+static bool fits(uint32_t us, uint32_t bytes) {
+    return us <= (uint32_t)budgetPct * 10000 && bytes <= budgetKBps * 1024;
+}
+
+// ===================================
+// Admit (startStream, target voice already stopped)
+// ===================================
+bool admitStream(int streamIdx, const char* filename, uint8_t priority) {
+    AudioStream* s = &streams[streamIdx];
+
+    FileCost* fc = findCost(pathHash(filename));
+    if (fc) {
+        s->costUs = fc->us;
+        s->costBytes = fc->bytes;
+        fc->lastUsed = millis();
+    } else {
+        const TypeCost* d = &typeDefaults[guessType(filename)];
+        s->costUs = d->us;
+        s->costBytes = d->bytes;
+    }
+    if (!admissionEnabled || streamIdx == SHADOW_VOICE) {
+        admitted++;
+        return true;
+    }
+
+    uint32_t us, bytes;
+    currentLoad(streamIdx, &us, &bytes);
+
+    // Stealing only happens if it's going to work: if stopping every lower
+    // priority stream still wouldn't make room, a LOW/NORMAL start is
+    // rejected with nothing stopped. HIGH gets in either way, so it steals.
+    bool steal = priority >= STREAM_PRIORITY_HIGH;
+    if (!steal && !fits(us + s->costUs, bytes + s->costBytes)) {
+        uint32_t freeUs = 0, freeBytes = 0;
+        for (int i = 0; i < MAX_STREAMS; i++) {
+            if (!stealable(i, streamIdx, priority)) continue;
+            freeUs += streams[i].costUs;
+            freeBytes += streams[i].costBytes;
+        }
+        steal = fits(us - freeUs + s->costUs, bytes - freeBytes + s->costBytes);
+    }
+
+    // Steal from lower priority streams, lowest then oldest first
+    while (steal && !fits(us + s->costUs, bytes + s->costBytes)) {
+        int victim = -1;
+        for (int i = 0; i < MAX_STREAMS; i++) {
+            AudioStream* v = &streams[i];
+            if (!stealable(i, streamIdx, priority)) continue;
+            if (victim < 0 || v->priority < streams[victim].priority ||
+                (v->priority == streams[victim].priority &&
+                 (int32_t)(v->startTime - streams[victim].startTime) < 0)) {
+                victim = i;
+            }
+        }
+        if (victim < 0) break;
+        log_message(String("Admission: stream ") + victim + " stopped for stream " + streamIdx);
+        stolen++;
+        stopStream(victim);
+        currentLoad(streamIdx, &us, &bytes);
+    }
+
+    if (fits(us + s->costUs, bytes + s->costBytes)) {
+        admitted++;
+        return true;
+    }
+    if (priority >= STREAM_PRIORITY_HIGH) {
+        log_message(String("Admission: stream ") + streamIdx + " over budget, admitted (high priority)");
+        forced++;
+        admitted++;
+        return true;
+    }
+
+    log_message(String("Stream ") + streamIdx + ": Rejected " + filename + " (load " +
+                (us / 10000) + "% + " + (s->costUs / 10000) + "% > " + budgetPct + "%)");
+    rejected++;
+    rejectCount++;
+    s->costUs = 0;
+    s->costBytes = 0;
+    return false;
+}
+
+// ===================================
+// Learn (stopStream)
+// ===================================
+void noteStreamCost(int streamIdx) {
+    AudioStream* s = &streams[streamIdx];
+    if (s->framesQueued < ADMIT_MIN_MEASURE_FRAMES || s->filename[0] == '\0') return;
+
+    uint32_t us = (uint32_t)((uint64_t)s->refillUs * SAMPLE_RATE / s->framesQueued);
+    bool fromSd = (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_MP3_SD || s->type == STREAM_TYPE_QOA_SD);
+    uint32_t bytes = fromSd ? (uint32_t)((uint64_t)s->bytesConsumed * SAMPLE_RATE / s->framesQueued) : 0;
+
+    uint32_t hash = pathHash(s->filename);
+    FileCost* fc = findCost(hash);
+    if (fc) {
+        fc->us = (fc->us * 3 + us) / 4;
+        fc->bytes = (fc->bytes * 3 + bytes) / 4;
+        if (fc->plays < 0xFFFF) fc->plays++;
+    } else {
+        // Empty slot, else the least recently used
+        fc = &costTable[0];
+        for (int i = 0; i < ADMIT_COST_SLOTS; i++) {
+            if (costTable[i].hash == 0) {
+                fc = &costTable[i];
+                break;
+            }
+            if ((int32_t)(costTable[i].lastUsed - fc->lastUsed) < 0) fc = &costTable[i];
+        }
+        fc->hash = hash;
+        fc->us = us;
+        fc->bytes = bytes;
+        fc->plays = 1;
+        size_t len = strlen(s->filename);
+        const char* tail = len >= sizeof(fc->name) ? s->filename + len - (sizeof(fc->name) - 1) : s->filename;
+        strncpy(fc->name, tail, sizeof(fc->name) - 1);
+        fc->name[sizeof(fc->name) - 1] = '\0';
+    }
+    fc->lastUsed = millis();
+}
+
+// ===================================
+// Budget (#ADMIT in CHIRP.INI, ADMT:B)
+// ===================================
+void setAdmissionBudget(int core0Pct, int sdKBps) {
+    budgetPct = constrain(core0Pct, 10, 100);
+    budgetKBps = constrain(sdKBps, 100, 20000);
+}
+
+// #ADMIT <ON|OFF> <core0 %> <SD KB/s>
+bool setAdmissionFromIni(const char* args) {
+    char onOff[4];
+    int pct, kbps;
+    if (sscanf(args, "%3s %d %d", onOff, &pct, &kbps) != 3) {
+        Serial.printf("ADMIT: ERROR - expected <ON|OFF> <core0 %%> <SD KB/s>: %s\n", args);
+        return false;
+    }
+    admissionEnabled = (strcasecmp(onOff, "ON") == 0);
+    setAdmissionBudget(pct, kbps);
+    return true;
+}
+
+void writeAdmissionIni(Print& out) {
+    out.printf("#ADMIT %s %u %lu\n", admissionEnabled ? "ON" : "OFF", budgetPct, budgetKBps);
+}
+
+// ===================================
+// Status (ADMT command)
+// ===================================
+void printAdmissionStatus(Print& out, bool listTable) {
+    uint32_t us, bytes;
+    currentLoad(-1, &us, &bytes);
+    int learned = 0;
+    for (int i = 0; i < ADMIT_COST_SLOTS; i++) {
+        if (costTable[i].hash) learned++;
+    }
+    out.printf("ADMT:%s,budget core0 %u%% sd %luKB/s,load core0 %lu%% sd %luKB/s\n",
+               admissionEnabled ? "on" : "off", budgetPct, budgetKBps, us / 10000, bytes / 1024);
+    out.printf("ADMT:admitted %lu,stolen %lu,forced %lu,rejected %lu,learned %d/%d files\n",
+               admitted, stolen, forced, rejected, learned, ADMIT_COST_SLOTS);
+    for (int i = 0; i < MAX_VOICES; i++) {
+        AudioStream* s = &streams[i];
+        if (!s->active && !s->waitingForDecoder) continue;
+        out.printf("ADMT:%d core0 %5luus/s sd %4luKB/s%s %s\n", i, s->costUs, s->costBytes / 1024,
+                   s->paused ? " (paused)" : "", s->filename);
+    }
+    if (!listTable) return;
+    for (int i = 0; i < ADMIT_COST_SLOTS; i++) {
+        FileCost* fc = &costTable[i];
+        if (!fc->hash) continue;
+        out.printf("ADMT:file %-19s core0 %6luus/s sd %4luKB/s plays %u\n", fc->name, fc->us, fc->bytes / 1024, fc->plays);
+    }
+}
+
+// Tells a failed start that admission turned it away, rather than the file
+uint32_t admissionRejectCount() {
+    return rejectCount;
+}
+
+void resetAdmissionStats() {
+    admitted = 0;
+    stolen = 0;
+    forced = 0;
+    rejected = 0;
+}
@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <math.h>
+#include "dsp_kernels.h"
 
 // =================================================================================
 //  UNIFIED MIXER LOGIC + CHIRP GENERATOR
@@ -54,54 +55,117 @@ volatile ChirpState chirp = {false, 0, 0, 0, 0, 0, 0};
 // ===================================
 // Global Audio Objects
 // ===================================
-AudioStream streams[MAX_STREAMS];
-RingBuffer streamBuffers[MAX_STREAMS];
-MP3DecoderHelix* mp3Decoders[MAX_MP3_DECODERS];
-bool mp3DecoderInUse[MAX_MP3_DECODERS];
+AudioStream streams[MAX_VOICES];
+RingBuffer streamBuffers[MAX_VOICES];
+MixerVoices mixVoices;
 
 // Context for the callback (since library doesn't pass user data through write)
 volatile int currentDecodingStream = -1;
 
+// Core 0 staging for the expand kernel (WAV refill and MP3 callback never nest)
+alignas(4) static int16_t expandBuf[DSP_MAX_EXPAND_OUT]; // Word-copied into the rings
+
+// Core 0 staging for one compressed QOA frame
+static uint8_t qoaFrameBuf[QOA_MAX_FRAME_BYTES];
+
 // ===================================
 // Initialize Audio System
 // ===================================
 void initAudioSystem() {
-    // Initialize Streams
-    for (int i = 0; i < MAX_STREAMS; i++) {
+    // Initialize Streams (plus the crossfade shadow voice)
+    for (int i = 0; i < MAX_VOICES; i++) {
         streams[i].active = false;
         streams[i].type = STREAM_TYPE_INACTIVE;
         streams[i].volume = 1.0f;
         streams[i].decoderIndex = -1;
+        streams[i].priority = STREAM_PRIORITY_NORMAL;
+        streams[i].waitingForDecoder = false;
         streams[i].ringBuffer = &streamBuffers[i];
         streams[i].stopRequested = false;
+        streams[i].paused = false;
+        streams[i].releaseOnFade = nullptr;
         streams[i].fileFinished = false;
+        streams[i].ramData = nullptr;
+        streams[i].prerollData = nullptr;
+        streams[i].prerollLeft = 0;
+        streams[i].dataRemaining = 0;
+        streams[i].blockAlign = 2;
+        streams[i].sampleFormat = WAV_FMT_S16;
         
-        // Allocate Buffer in PSRAM
-        // 256K samples * 2 bytes = 512KB
-        streams[i].ringBuffer->buffer = (int16_t*)pmalloc(STREAM_BUFFER_SIZE * sizeof(int16_t));
+        // Allocate Buffer (PSRAM board: 256K samples * 2 bytes = 512KB)
+        streams[i].ringBuffer->buffer = (int16_t*)memAllocPsram(STREAM_BUFFER_SIZE * sizeof(int16_t), MEM_TAG_RINGS);
         
         if (streams[i].ringBuffer->buffer) {
             // Success
             streams[i].ringBuffer->clear();
             #ifdef DEBUG
-            Serial.printf("Stream %d: Buffer allocated in PSRAM (512KB)\n", i);
+            Serial.printf("Stream %d: Buffer allocated (%luKB)\n", i, (uint32_t)(STREAM_BUFFER_SIZE * sizeof(int16_t) / 1024));
             #endif
         } else {
             // Allocation Failed!
-            Serial.printf("Stream %d: ERROR - PSRAM Allocation Failed!\n", i);
+            Serial.printf("Stream %d: ERROR - Buffer Allocation Failed!\n", i);
         }
+
+        mixVoices.startThreshold[i] = 2;
+        mixVoices.concealQ16[i] = GAIN_UNITY;
+        syncMixVoice(i);
     }
-    
-    // Initialize Decoder Pool Flags
-    for (int i = 0; i < MAX_MP3_DECODERS; i++) {
-        mp3DecoderInUse[i] = false;
-        // Note: mp3Decoders[i] are allocated in setup()
+    mixVoices.swapPair = -1;
+}
+
+// ===================================
+// Mixer Voice Table (Core 0 side)
+// ===================================
+// Publish a voice's control fields after changing active / paused /
+// fileFinished / volume / ringBuffer on its AudioStream. Stopping clears run
+// first, so the mixer is off the ring before Core 0 clears it.
+void syncMixVoice(int v) {
+    if (v < 0 || v >= MAX_VOICES) return;
+    AudioStream* s = &streams[v];
+    mixVoices.volQ8[v] = (int32_t)(s->volume * 256.0f);
+    mixVoices.ended[v] = s->fileFinished;
+    mixVoices.ring[v] = s->ringBuffer;
+    mixVoices.run[v] = s->active && !s->paused;
+}
+
+// Swap every per-voice field (crossfade landing). Runs on Core 1 between
+// samples when asked through swapPair, or directly while the mixer is off.
+static void swapVoiceFields(int a, int b) {
+#define MIX_SWAP(field) { auto t = mixVoices.field[a]; mixVoices.field[a] = mixVoices.field[b]; mixVoices.field[b] = t; }
+    MIX_SWAP(ring); MIX_SWAP(run); MIX_SWAP(ended); MIX_SWAP(volQ8);
+    MIX_SWAP(gainTarget); MIX_SWAP(gainStep); MIX_SWAP(startThreshold);
+    MIX_SWAP(gainQ30); MIX_SWAP(concealQ16); MIX_SWAP(lastFrame); MIX_SWAP(primed);
+    MIX_SWAP(framesMixed); MIX_SWAP(firstMixUs); MIX_SWAP(underruns); MIX_SWAP(concealedFrames);
+#undef MIX_SWAP
+}
+
+// Core 0: hand the swap to the mixer and wait for it (one sample, ~23us).
+// Only the voice table moves; Core 1 is never parked.
+void swapMixVoices(int a, int b) {
+    if (!g_allowAudio) {
+        swapVoiceFields(a, b);
+        return;
     }
+    mixVoices.swapPair = (int16_t)((a << 8) | b);
+    while (mixVoices.swapPair >= 0) tight_loop_contents();
 }
 
 // Simple inline helpers
 static inline int32_t i16_to_i32(int16_t s) { return (int32_t)s; }
-static inline int16_t i32_to_i16(int32_t v) { if (v > 32767) return 32767; if (v < -32768) return -32768; return (int16_t)v; }
+static inline int16_t i32_to_i16(int32_t v) { return dsp_sat16(v); } // Single SSAT on the M33
+
+// Convert a block of WAV sample data to int16 (bytes must be whole samples)
+static int convertToS16(uint8_t sampleFormat, const uint8_t* in, int bytes, int16_t* out) {
+    switch (sampleFormat) {
+        case WAV_FMT_U8:  return dsp_u8_to_s16(in, bytes, out);
+        case WAV_FMT_S24: return dsp_s24_to_s16(in, bytes / 3, out);
+        case WAV_FMT_S32: return dsp_s32_to_s16(in, bytes / 4, out);
+        case WAV_FMT_F32: return dsp_f32_to_s16(in, bytes / 4, out);
+        default:
+            memcpy(out, in, bytes & ~1); // 16-bit LE is already the int16 layout
+            return bytes / 2;
+    }
+}
 
 // ===================================
 // Fill Stream Buffers (Core 0)
@@ -110,10 +174,11 @@ static inline int16_t i32_to_i16(int32_t v) { if (v > 32767) return 32767; if (v
 // respective files (Flash or SD), decodes it (if MP3), and pushes it into
 // the stream's Ring Buffer.
 void fillStreamBuffers() {
-    for (int i = 0; i < MAX_STREAMS; i++) {
+    for (int i = 0; i < MAX_VOICES; i++) {
         AudioStream* s = &streams[i];
         
         if (!s->active || s->fileFinished) continue;
+        uint32_t refillStart = micros(); // Learned cost (admission.cpp)
         
         // Check if buffer needs data
         int available = s->ringBuffer->availableForWrite();
@@ -126,123 +191,140 @@ void fillStreamBuffers() {
                 uint8_t mp3Buf[512]; 
                 int bytesRead = 0;
                 
-                mutex_enter_blocking(&sd_mutex);
-                if (s->sdFile) {
-                    bytesRead = s->sdFile.read(mp3Buf, sizeof(mp3Buf));
-                    if (bytesRead == 0) {
-                        if (!s->sdFile.available()) {
-                            s->fileFinished = true;
-                            #ifdef DEBUG
-                            log_message(String("Stream ") + i + ": MP3 EOF detected (read 0)");
-                            #endif
-                        } else {
-                             #ifdef DEBUG
-                             log_message(String("Stream ") + i + ": MP3 read 0 but available!");
-                             #endif
+                if (s->prerollLeft) {
+                    // Pre-roll cache hit: the start of the file comes from PSRAM
+                    bytesRead = takePreroll(s, mp3Buf, sizeof(mp3Buf));
+                } else {
+                    sdBegin(SDIO_REFILL);
+                    if (s->sdFile) {
+                        bytesRead = s->sdFile.read(mp3Buf, sizeof(mp3Buf));
+                        if (bytesRead == 0) {
+                            if (!s->sdFile.available()) {
+                                s->fileFinished = true;
+                                #ifdef DEBUG
+                                log_message(String("Stream ") + i + ": MP3 EOF detected (read 0)");
+                                #endif
+                            } else {
+                                 #ifdef DEBUG
+                                 log_message(String("Stream ") + i + ": MP3 read 0 but available!");
+                                 #endif
+                            }
                         }
                     }
+                    sdEnd();
                 }
-                mutex_exit(&sd_mutex);
                 
                 if (bytesRead > 0 && s->decoderIndex != -1) {
+                    s->bytesConsumed += bytesRead;
+                    
                     // Set global context before writing
                     currentDecodingStream = i;
-                    mp3Decoders[s->decoderIndex]->write(mp3Buf, bytesRead);
+                    uint32_t t0 = micros();
+                    getMp3Decoder(s->decoderIndex)->write(mp3Buf, bytesRead);
+                    noteMp3DecodeTime(s->decoderIndex, micros() - t0);
                     currentDecodingStream = -1;
                 }
             }
             
-        } else if (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_WAV_FLASH) {
-            // --- WAV (SD or Flash) ---
-            // WAV is simpler, we read small chunks.
-            // We need enough space for the expanded data.
-            // Worst case: Mono 22.05kHz -> Stereo 44.1kHz = 4x expansion.
-            // 512 bytes read = 256 samples input -> 1024 samples output.
-            // To be safe and avoid any boundary issues, we check for 2048 samples.
+        } else if (s->type == STREAM_TYPE_QOA_SD) {
+            // --- QOA (SD) ---
+            // One whole frame per pass: ~4KB read expands to up to 20K ring samples
+            if (available > QOA_MAX_FRAME_OUT) {
+                int frameBytes = 0;
+                
+                sdBegin(SDIO_REFILL);
+                if (s->sdFile) {
+                    frameBytes = qoaReadFrame(s->sdFile, qoaFrameBuf);
+                }
+                sdEnd();
+                
+                if (frameBytes > 0) {
+                    int written = qoaDecodeFrame(s, qoaFrameBuf, frameBytes);
+                    if (written < 0) {
+                        frameBytes = -1;
+                    } else {
+                        s->bytesConsumed += frameBytes;
+                        s->framesQueued += written / 2;
+                    }
+                }
+                if (frameBytes < 0) {
+                    log_message(String("Stream ") + i + ": ERROR - Corrupt QOA frame, stopping");
+                }
+                if (frameBytes <= 0) {
+                    s->fileFinished = true;
+                    #ifdef DEBUG
+                    log_message(String("Stream ") + i + ": QOA EOF detected");
+                    #endif
+                }
+            }
+            
+        } else if (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_WAV_FLASH ||
+                   s->type == STREAM_TYPE_WAV_RAM) {
+            // --- WAV (SD, Flash or PSRAM-resident) ---
+            // WAV is simpler, we read small chunks of whole frames, convert them
+            // to 16-bit and expand to stereo 44.1kHz.
+            // Worst case: 8-bit Mono 22.05kHz -> 512 bytes = 512 samples input,
+            // x4 expansion -> 2048 samples output, so check for more than that.
             if (available > 2048) {
-                uint8_t wavBuf[512];
+                uint32_t rawWords[128]; // 512 bytes, word aligned
+                uint8_t* raw = (uint8_t*)rawWords;
+                uint32_t toRead = sizeof(rawWords) - (sizeof(rawWords) % s->blockAlign);
+                if (toRead > s->dataRemaining) toRead = s->dataRemaining;
                 int bytesRead = 0;
                 
-                if (s->type == STREAM_TYPE_WAV_SD) {
-                    mutex_enter_blocking(&sd_mutex);
+                if (toRead == 0) {
+                    // End of the data chunk (anything after it is metadata, not audio)
+                    s->fileFinished = true;
+                    #ifdef DEBUG
+                    log_message(String("Stream ") + i + ": WAV EOF detected");
+                    #endif
+                } else if (s->type == STREAM_TYPE_WAV_RAM) {
+                    // Resident: straight copy out of the PSRAM arena, no I/O or locks
+                    memcpy(raw, s->ramData, toRead);
+                    s->ramData += toRead;
+                    bytesRead = toRead;
+                } else if (s->type == STREAM_TYPE_WAV_SD && s->prerollLeft) {
+                    // Pre-roll cache hit (whole frames, like the file reads)
+                    if (toRead > s->prerollLeft) toRead = s->prerollLeft;
+                    bytesRead = takePreroll(s, raw, toRead);
+                } else if (s->type == STREAM_TYPE_WAV_SD) {
+                    sdBegin(SDIO_REFILL);
                     if (s->sdFile) {
-                        bytesRead = s->sdFile.read(wavBuf, sizeof(wavBuf));
-                        if (bytesRead == 0) { 
-                            s->fileFinished = true;
-                            #ifdef DEBUG
-                            log_message(String("Stream ") + i + ": WAV (SD) EOF detected");
-                            #endif
-                        }
+                        bytesRead = s->sdFile.read(raw, toRead);
                     }
-                    mutex_exit(&sd_mutex);
+                    sdEnd();
                 } else {
                     mutex_enter_blocking(&flash_mutex);
                     if (s->flashFile) {
-                        bytesRead = s->flashFile.read(wavBuf, sizeof(wavBuf));
-                        if (bytesRead == 0) { 
-                            s->fileFinished = true;
-                            #ifdef DEBUG
-                            log_message(String("Stream ") + i + ": WAV (Flash) EOF detected");
-                            #endif
-                        }
+                        bytesRead = s->flashFile.read(raw, toRead);
                     }
                     mutex_exit(&flash_mutex);
                 }
                 
+                if (toRead > 0 && bytesRead < (int)toRead) {
+                    // Short read: file is truncated, play the whole frames we got
+                    bytesRead = bytesRead < 0 ? 0 : bytesRead - (bytesRead % s->blockAlign);
+                    s->fileFinished = true;
+                    #ifdef DEBUG
+                    log_message(String("Stream ") + i + ": WAV short read, EOF");
+                    #endif
+                }
+                
                 if (bytesRead > 0) {
-                    int samples = bytesRead / 2;
-                    
-                    // Handle 22.05kHz upsampling (duplicate samples)
-                    if (s->sampleRate == 22050) {
-                         if (s->channels == 2) {
-                              // STEREO -> UPSAMPLE (Duplicate frame)
-                              // Process in pairs (L+R) and duplicate each frame
-                              // Input: L0, R0, L1, R1...
-                              // Output: L0, R0, L0, R0, L1, R1, L1, R1...
-                              for (int k = 0; k < samples; k += 2) {
-                                  if (k + 1 >= samples) break; // Should not happen if aligned
-                                  
-                                  int16_t left = (int16_t)(wavBuf[k*2] | (wavBuf[k*2+1] << 8));
-                                  int16_t right = (int16_t)(wavBuf[(k+1)*2] | (wavBuf[(k+1)*2+1] << 8));
-                                  
-                                  // Frame 1
-                                  if (!s->ringBuffer->push(left)) break;
-                                  if (!s->ringBuffer->push(right)) break;
-                                  // Frame 2 (Duplicate)
-                                  if (!s->ringBuffer->push(left)) break;
-                                  if (!s->ringBuffer->push(right)) break;
-                              }
-                         } else {
-                             // MONO -> STEREO (Duplicate) -> UPSAMPLE (Duplicate again)
-                             // Total 4 pushes per input sample
-                             for (int k = 0; k < samples; k++) {
-                                 int16_t sample = (int16_t)(wavBuf[k*2] | (wavBuf[k*2+1] << 8));
-                                 if (!s->ringBuffer->push(sample)) break; // L1
-                                 if (!s->ringBuffer->push(sample)) break; // R1
-                                 if (!s->ringBuffer->push(sample)) break; // L2
-                                 if (!s->ringBuffer->push(sample)) break; // R2
-                             }
-                         }
-                         
-                    } else {
-                        // Normal 44.1kHz handling
-                        for (int k = 0; k < samples; k++) {
-                            int16_t sample = (int16_t)(wavBuf[k*2] | (wavBuf[k*2+1] << 8));
-                            
-                            if (s->channels == 1) {
-                                // MONO -> STEREO (Duplicate)
-                                s->ringBuffer->push(sample); // Left
-                                s->ringBuffer->push(sample); // Right
-                            } else {
-                                // STEREO (Pass through)
-                                s->ringBuffer->push(sample);
-                            }
-                        }
-                    }
+                    s->dataRemaining -= bytesRead;
+                    s->bytesConsumed += bytesRead;
+                    int16_t pcm[512];
+                    int samples = convertToS16(s->sampleFormat, raw, bytesRead, pcm);
+                    int n = dsp_expand_to_stereo(pcm, samples, s->channels,
+                                                 s->sampleRate == 22050, expandBuf, s->resampleCarry);
+                    s->framesQueued += s->ringBuffer->writeBlock(expandBuf, n) / 2;
                 }
             }
         }
         
+        mixVoices.ended[i] = s->fileFinished; // After the last write
+        s->refillUs += micros() - refillStart;
+
         // Auto-stop if finished and buffer empty
         if (s->fileFinished && s->ringBuffer->availableForRead() == 0) {
             s->stopRequested = true;
@@ -250,15 +332,6 @@ void fillStreamBuffers() {
     }
 }
 
-// OPTIMIZED: Integer-only Hard Limiter (Much faster than float version)
-static inline void applyFastLimiter(int32_t &l, int32_t &r) {
-    if (l > 32767) l = 32767;
-    else if (l < -32768) l = -32768;
-
-    if (r > 32767) r = 32767;
-    else if (r < -32768) r = -32768;
-}
-
 namespace Mixer {
     // ===================================
     // Mixer (Core 1)
@@ -270,46 +343,87 @@ namespace Mixer {
         bool activeAudio = false;
 
         // 1. Mix Streams
-        for (int i = 0; i < MAX_STREAMS; i++) {
-            if (streams[i].active && streams[i].ringBuffer->availableForRead() >= 2) {
-                // Pop stereo samples (L, R)
-                int16_t l = streams[i].ringBuffer->pop();
-                int16_t r = streams[i].ringBuffer->pop();
-                
-                // Apply Volume
-                // Gain is 0..256 (volume * master)
-                // We'll do a simple float multiply for flexibility first, then optimize later if needed.
-                // Or stick to int math: volume is float 0..1.0
-                
-                int32_t volFixed = (int32_t)(streams[i].volume * 256.0f);
-                
-                // Ramp Up (Fade In) over 50ms to prevent pops
-                uint32_t elapsed = millis() - streams[i].startTime;
-                if (elapsed < 50) {
-                     int32_t ramp = (elapsed * 256) / 50;
-                     if (ramp > 256) ramp = 256;
-                     volFixed = (volFixed * ramp) >> 8;
+        // Each voice is accumulated at full precision (sample * gain, gain ~0..256)
+        // with one SMLAxB per channel, and the sum is scaled back once at the end.
+        int32_t accLeft = 0;
+        int32_t accRight = 0;
+        MixerVoices& mv = mixVoices;
+        int16_t swap = mv.swapPair;
+        if (swap >= 0) {
+            swapVoiceFields(swap >> 8, swap & 0xFF);
+            mv.swapPair = -1;
+        }
+        for (int i = 0; i < MAX_VOICES; i++) {
+            // Paused streams are skipped, which freezes their read position
+            if (!mv.run[i]) continue;
+
+            // Wait for the start threshold (a short file that is all in
+            // starts as soon as there is anything)
+            RingBuffer* rb = mv.ring[i];
+            int avail = rb->availableForRead();
+            bool ready = mv.primed[i] ? avail >= 2
+                                      : (avail >= (int)mv.startThreshold[i] || (mv.ended[i] && avail >= 2));
+            uint32_t frame;
+            int32_t g = mv.gainQ30[i];
+            int32_t conceal = mv.concealQ16[i];
+            if (ready) {
+                // Pop stereo frame (L | R << 16)
+                frame = rb->popFrame();
+                mv.primed[i] = true;
+                mv.lastFrame[i] = frame;
+                if (mv.framesMixed[i]++ == 0) mv.firstMixUs[i] = micros();
+
+                // Gain ramp (start/resume fade-in, fades, crossfades)
+                int32_t step = mv.gainStep[i];
+                if (step != 0 && g != mv.gainTarget[i]) {
+                    int32_t target = mv.gainTarget[i];
+                    g += step;
+                    if ((step > 0 && g > target) || (step < 0 && g < target)) g = target;
+                    mv.gainQ30[i] = g;
                 }
 
-                int32_t gain = (volFixed * masterAttenMultiplier) >> 8; // Result 0..256 approx
-                
-                mixedLeft += ((int32_t)l * gain) >> 8;
-                mixedRight += ((int32_t)r * gain) >> 8;
-                activeAudio = true;
+                // Back in after an underrun
+                if (conceal < GAIN_UNITY) {
+                    conceal += GAIN_UNITY / (SAMPLE_RATE * UNDERRUN_FADE_IN_MS / 1000);
+                    if (conceal > GAIN_UNITY) conceal = GAIN_UNITY;
+                    mv.concealQ16[i] = conceal;
+                }
+            } else {
+                // Ring ran dry mid-file: count it, go back to prebuffering, and
+                // fade the last frame out rather than dropping to zero. A stream
+                // that hasn't played a frame yet is just prebuffering: nothing
+                // to conceal, and its start keeps the plain STREAM_FADE_IN_MS ramp.
+                if (mv.primed[i] && !mv.ended[i]) {
+                    mv.primed[i] = false;
+                    mv.underruns[i]++;
+                }
+                if (mv.ended[i] || mv.framesMixed[i] == 0 || conceal <= 0) continue;
+                conceal -= GAIN_UNITY / (SAMPLE_RATE * UNDERRUN_FADE_OUT_MS / 1000);
+                if (conceal < 0) conceal = 0;
+                mv.concealQ16[i] = conceal;
+                mv.concealedFrames[i]++;
+                frame = mv.lastFrame[i];
             }
+
+            // Apply Volume
+            // Gain is 0..256 (volume * master)
+            int32_t volFixed = (mv.volQ8[i] * (g >> (8 + GAIN_RAMP_SHIFT))) >> 8;
+            volFixed = (volFixed * (conceal >> 8)) >> 8;
+
+            int32_t gain = (volFixed * masterAttenMultiplier) >> 8; // Result 0..256 approx
+
+            dsp_mac_frame(frame, gain, accLeft, accRight);
+            activeAudio = true;
         }
+        mixedLeft = accLeft >> 8;
+        mixedRight = accRight >> 8;
 
         // --- CHIRP / TONE GENERATOR ---
         if (chirp.active) {
             if (chirp.samplesLeft > 0) {
-                // 1. Get Sine Value from LUT (index 0-255)
-                uint8_t index = (chirp.phase >> 24); 
-                int32_t sample = (int32_t)SINE_LUT[index];
-
-                // 2. Scale up: LUT is +/- 127. 
-                // We want standard audio levels (+/- 32000ish).
-                // Shift << 8 gives +/- 32512.
-                sample = sample << 8;
+                // 1+2. Sine from the LUT, linear interpolated between entries
+                // (INTERP0 blend), scaled up: LUT is +/- 127, << 8 gives +/- 32512.
+                int32_t sample = dsp_wavetable_s8(SINE_LUT, chirp.phase);
 
                 // 3. Apply Volume (0-255)
                 // sample * vol >> 8
@@ -335,9 +449,7 @@ namespace Mixer {
             }
         }
 
-        // --- OPTIMIZATION: Fast Limiter ---
-        applyFastLimiter(mixedLeft, mixedRight);
-
+        // --- Hard Limiter (saturate) ---
         i2s.write16(i32_to_i16(mixedLeft), i32_to_i16(mixedRight));
     }
 } 
@@ -378,10 +490,15 @@ void playChirp(int startFreq, int endFreq, int durationMs, uint8_t vol = 128) {
 // ===================================
 // MP3 Decoder Callback
 // ===================================
-void mp3DataCallback(MP3FrameInfo &info, int16_t *pcm_buffer, size_t len, void* ref) {
+// Runs once per decoded frame. Kept in SRAM so the per-frame path doesn't
+// fetch code over the same QMI bus as the PSRAM ring buffers. flatten pulls
+// the expand kernel and the ring write into this body, so nothing it calls
+// runs from flash (noteMp3Frame is in SRAM too, and neither uses memcpy).
+void __attribute__((flatten)) __not_in_flash_func(mp3DataCallback)(MP3FrameInfo &info, int16_t *pcm_buffer, size_t len, void* ref) {
     // Use global context since library doesn't pass user data through write() correctly
     int streamIdx = currentDecodingStream;
-    if (streamIdx < 0 || streamIdx >= MAX_STREAMS) return;
+    if (streamIdx < 0 || streamIdx >= MAX_VOICES) return; // Includes the crossfade shadow
+    noteMp3Frame(streams[streamIdx].decoderIndex);
     
     RingBuffer* rb = streams[streamIdx].ringBuffer;
     
@@ -396,47 +513,201 @@ void mp3DataCallback(MP3FrameInfo &info, int16_t *pcm_buffer, size_t len, void*
     if (streams[streamIdx].sampleRate == 0 && info.samprate != 0) {
         streams[streamIdx].sampleRate = info.samprate;
     }
-    // Handle 22.05kHz upsampling vs Normal 44.1kHz
-    if (info.samprate == 22050) {
-        // --- 22.05kHz Handling ---
-        if (channels == 2) {
-             // Stereo: Process in pairs (L, R) and duplicate the frame
-             for (size_t i = 0; i < len; i += 2) {
-                 if (i + 1 >= len) break;
-                 
-                 int16_t left = pcm_buffer[i];
-                 int16_t right = pcm_buffer[i+1];
-                 
-                 // Frame 1
-                 if (!rb->push(left)) break;
-                 if (!rb->push(right)) break;
-                 // Frame 2 (Duplicate)
-                 if (!rb->push(left)) break;
-                 if (!rb->push(right)) break;
-             }
-        } else {
-            // Mono: Duplicate sample 4 times (L1, R1, L2, R2)
-             for (size_t i = 0; i < len; i++) {
-                int16_t sample = pcm_buffer[i];
-                if (!rb->push(sample)) break; // L1
-                if (!rb->push(sample)) break; // R1
-                if (!rb->push(sample)) break; // L2
-                if (!rb->push(sample)) break; // R2
-             }
+    // Expand to stereo 44.1k in SRAM, then one block write into the PSRAM ring
+    // (whole frames only, so L/R can never get swapped when the ring fills up)
+    int n = dsp_expand_to_stereo(pcm_buffer, (int)len, channels, info.samprate == 22050, expandBuf,
+                                 streams[streamIdx].resampleCarry);
+    streams[streamIdx].framesQueued += rb->writeBlock(expandBuf, n) / 2;
+}
+
+
+// ===================================
+// DSP Kernel Self-Test (DSPT command)
+// ===================================
+// Runs the kernels against the original per-sample code on a pseudo-random
+// block and reports mismatches and cycles per output sample. Expand and WAV
+// conversion must be bit-exact; the mixer may differ by up to MAX_STREAMS LSB
+// because it now rounds once per frame instead of once per voice. The
+// interpolator blend is checked against the C blend it replaces.
+static int refExpand(const int16_t* in, int n, int channels, bool halfRate, int16_t* out) {
+    int o = 0;
+    int16_t prevL = 0, prevR = 0; // Carry starts at 0
+    for (int k = 0; k + channels - 1 < n; k += channels) {
+        int16_t l = in[k];
+        int16_t r = (channels == 2) ? in[k + 1] : in[k];
+        if (halfRate) {
+            out[o++] = (int16_t)((prevL + l) >> 1);
+            out[o++] = (int16_t)((prevR + r) >> 1);
         }
-    } else {
-        // --- Normal 44.1kHz Handling ---
-        for (size_t i = 0; i < len; i++) {
-            if (channels == 1) {
-                // MONO -> STEREO (Duplicate)
-                if (!rb->push(pcm_buffer[i])) break; // Left
-                if (!rb->push(pcm_buffer[i])) break; // Right
-            } else {
-                // STEREO (Pass through)
-                rb->push(pcm_buffer[i]);
+        out[o++] = l; out[o++] = r;
+        prevL = l; prevR = r;
+    }
+    return o;
+}
+
+void runDspSelfTest(Print& out) {
+    static int16_t src[1152];
+    static int16_t ref[DSP_MAX_EXPAND_OUT];
+    uint32_t seed = 0x1234567;
+    for (int i = 0; i < 1152; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        src[i] = (int16_t)(seed >> 16);
+    }
+    src[0] = 32767; src[1] = -32768; // Make sure the extremes are covered
+
+    out.printf("DSPT:M33 DSP extension %s\n", DSP_HAS_M33_EXT ? "used" : "not available (C fallback)");
+
+    static const struct { int ch; bool half; int n; const char* name; } modes[] = {
+        {2, false, 1152, "stereo 44.1k"}, {1, false, 1152, "mono 44.1k"},
+        {2, true,  1152, "stereo 22.05k"}, {1, true,  576,  "mono 22.05k"},
+    };
+    for (const auto& m : modes) {
+        uint32_t c0 = rp2040.getCycleCount();
+        int nRef = refExpand(src, m.n, m.ch, m.half, ref);
+        uint32_t c1 = rp2040.getCycleCount();
+        uint32_t carry = 0;
+        int nOut = dsp_expand_to_stereo(src, m.n, m.ch, m.half, expandBuf, carry);
+        uint32_t c2 = rp2040.getCycleCount();
+
+        int bad = (nRef != nOut) ? 1 : 0;
+        for (int i = 0; i < nOut && i < nRef; i++) {
+            if (ref[i] != expandBuf[i]) bad++;
+        }
+        out.printf("DSPT:expand %-13s %s, ref %lu cyc, kernel %lu cyc (%d samples)\n",
+                   m.name, bad ? "MISMATCH" : "exact", c1 - c0, c2 - c1, nOut);
+    }
+
+    // Mixer: 3 voices at assorted gains, frame by frame
+    int maxErr = 0;
+    uint32_t refCyc = 0, kerCyc = 0;
+    static const int32_t gains[3] = {256, 181, 37};
+    for (int f = 0; f + 2 * MAX_STREAMS <= 1152; f += 2 * MAX_STREAMS) {
+        uint32_t c0 = rp2040.getCycleCount();
+        int32_t rl = 0, rr = 0;
+        for (int v = 0; v < MAX_STREAMS; v++) {
+            rl += ((int32_t)src[f + v * 2] * gains[v % 3]) >> 8;
+            rr += ((int32_t)src[f + v * 2 + 1] * gains[v % 3]) >> 8;
+        }
+        uint32_t c1 = rp2040.getCycleCount();
+        int32_t al = 0, ar = 0;
+        for (int v = 0; v < MAX_STREAMS; v++) {
+            uint32_t frame;
+            memcpy(&frame, &src[f + v * 2], 4);
+            dsp_mac_frame(frame, gains[v % 3], al, ar);
+        }
+        al >>= 8;
+        ar >>= 8;
+        uint32_t c2 = rp2040.getCycleCount();
+        refCyc += c1 - c0;
+        kerCyc += c2 - c1;
+        if (abs(i32_to_i16(al) - i32_to_i16(rl)) > maxErr) maxErr = abs(i32_to_i16(al) - i32_to_i16(rl));
+        if (abs(i32_to_i16(ar) - i32_to_i16(rr)) > maxErr) maxErr = abs(i32_to_i16(ar) - i32_to_i16(rr));
+    }
+    out.printf("DSPT:mix %d voices %s (max err %d LSB), ref %lu cyc, kernel %lu cyc\n",
+               MAX_STREAMS, maxErr <= MAX_STREAMS ? "ok" : "OUT OF TOLERANCE", maxErr, refCyc, kerCyc);
+
+    // Interpolator blend vs the C blend: every alpha over assorted endpoints
+    dsp_interp_init(); // Core 0's INTERP0 (Core 1 set up its own)
+    int blendErr = 0;
+    for (int i = 0; i + 1 < 64; i++) {
+        for (uint32_t alpha = 0; alpha < 256; alpha++) {
+            int d = abs(dsp_blend(src[i], src[i + 1], alpha) - dsp_blend_c(src[i], src[i + 1], alpha));
+            if (d > blendErr) blendErr = d;
+        }
+    }
+    const int oscSamples = 1024;
+    uint32_t phase = 0, inc = (uint32_t)(440.0 * 4294967296.0 / SAMPLE_RATE);
+    int32_t oscSink = 0;
+    uint32_t c0 = rp2040.getCycleCount();
+    for (int i = 0; i < oscSamples; i++, phase += inc) oscSink += (int32_t)SINE_LUT[phase >> 24] << 8;
+    uint32_t c1 = rp2040.getCycleCount();
+    for (int i = 0; i < oscSamples; i++, phase += inc) {
+        uint32_t idx = phase >> 24;
+        oscSink += dsp_blend_c((int32_t)SINE_LUT[idx] << 8, (int32_t)SINE_LUT[(idx + 1) & 0xFF] << 8, (phase >> 16) & 0xFF);
+    }
+    uint32_t c2 = rp2040.getCycleCount();
+    for (int i = 0; i < oscSamples; i++, phase += inc) oscSink += dsp_wavetable_s8(SINE_LUT, phase);
+    uint32_t c3 = rp2040.getCycleCount();
+    volatile int32_t keepOsc = oscSink; // Keep the loops
+    (void)keepOsc;
+    out.printf("DSPT:interp %s, blend %s (max err %d LSB vs C)\n",
+               DSP_HAS_INTERP ? "INTERP0" : "not available (C fallback)", blendErr <= 1 ? "ok" : "MISMATCH", blendErr);
+    out.printf("DSPT:osc %d samples, lookup %lu cyc, C lerp %lu cyc, interp lerp %lu cyc\n",
+               oscSamples, c1 - c0, c2 - c1, c3 - c2);
+
+    // Voice table layout: the mixer's per-voice reads from compact arrays
+    // (mixVoices) vs the same fields strided by sizeof(AudioStream), at
+    // growing voice counts
+    struct StridedVoice {
+        uint32_t frame;
+        int32_t volQ8;
+        int32_t gainQ16;
+        uint8_t rest[sizeof(AudioStream) - 12];
+    };
+    const int benchVoices = 16, benchReps = 64;
+    StridedVoice* strided = (StridedVoice*)memAlloc(sizeof(StridedVoice) * benchVoices, MEM_TAG_SCRATCH);
+    if (strided) {
+        static uint32_t tFrame[benchVoices];
+        static int32_t tVol[benchVoices], tGain[benchVoices];
+        for (int v = 0; v < benchVoices; v++) {
+            memcpy(&tFrame[v], &src[v * 2], 4);
+            tVol[v] = strided[v].volQ8 = 256 - v * 9;
+            tGain[v] = strided[v].gainQ16 = GAIN_UNITY - v * 1024;
+            strided[v].frame = tFrame[v];
+        }
+        for (int n = 4; n <= benchVoices; n *= 2) {
+            int32_t al = 0, ar = 0;
+            uint32_t c0 = rp2040.getCycleCount();
+            for (int r = 0; r < benchReps; r++) {
+                for (int v = 0; v < n; v++) {
+                    dsp_mac_frame(tFrame[v], (tVol[v] * (tGain[v] >> 8)) >> 8, al, ar);
+                }
+            }
+            uint32_t c1 = rp2040.getCycleCount();
+            for (int r = 0; r < benchReps; r++) {
+                for (int v = 0; v < n; v++) {
+                    dsp_mac_frame(strided[v].frame, (strided[v].volQ8 * (strided[v].gainQ16 >> 8)) >> 8, al, ar);
+                }
             }
+            uint32_t c2 = rp2040.getCycleCount();
+            volatile int32_t sink = al ^ ar; // Keep the loops
+            (void)sink;
+            out.printf("DSPT:voices %2d table %4lu cyc/sample, struct stride %4lu cyc/sample\n",
+                       n, (c1 - c0) / benchReps, (c2 - c1) / benchReps);
         }
+        memFree(strided);
     }
+
+    // WAV sample conversion: encode the block in each format, convert back, compare
+    uint8_t* raw = (uint8_t*)memAlloc(1152 * 4, MEM_TAG_SCRATCH);
+    if (!raw) return;
+    static const uint8_t fmts[] = {WAV_FMT_U8, WAV_FMT_S16, WAV_FMT_S24, WAV_FMT_S32, WAV_FMT_F32};
+    static const uint8_t widths[] = {1, 2, 3, 4, 4};
+    for (int f = 0; f < 5; f++) {
+        for (int i = 0; i < 1152; i++) {
+            int32_t v = src[i];
+            uint8_t* p = raw + i * widths[f];
+            switch (fmts[f]) {
+                case WAV_FMT_U8:  p[0] = (uint8_t)((v >> 8) + 128); break;
+                case WAV_FMT_S16: memcpy(p, &src[i], 2); break;
+                case WAV_FMT_S24: p[0] = 0x5A; p[1] = v & 0xFF; p[2] = (v >> 8) & 0xFF; break;
+                case WAV_FMT_S32: v = (v << 16) | 0x1234; memcpy(p, &v, 4); break;
+                case WAV_FMT_F32: { float fl = src[i] / 32768.0f; memcpy(p, &fl, 4); } break;
+            }
+        }
+        uint32_t c0 = rp2040.getCycleCount();
+        int n = convertToS16(fmts[f], raw, 1152 * widths[f], ref);
+        uint32_t cyc = rp2040.getCycleCount() - c0;
+
+        int bad = (n != 1152) ? 1 : 0;
+        for (int i = 0; i < n && i < 1152; i++) {
+            int16_t want = (fmts[f] == WAV_FMT_U8) ? (int16_t)((src[i] >> 8) << 8) : src[i];
+            if (ref[i] != want) bad++;
+        }
+        out.printf("DSPT:wav %-12s %s, %lu cyc (%lu.%02lu cyc/sample)\n", wavFormatName(fmts[f]),
+                   bad ? "MISMATCH" : "exact", cyc, cyc / 1152, (cyc % 1152) * 100 / 1152);
+    }
+    memFree(raw);
 }
 
 
@@ -445,6 +716,8 @@ void mp3DataCallback(MP3FrameInfo &info, int16_t *pcm_buffer, size_t len, void*
 // ===================================
 void setup1() {
     // Core 1 setup
+    dsp_interp_init(); // This core's INTERP0 (chirp oscillator blend)
+    profilerInitCore(); // PROF sampling alarm for Core 1
 }
 
 
@@ -472,23 +745,112 @@ void loop1() {
 }
 
 
+// Copy the parsed WAV layout into the stream
+static void applyWavInfo(AudioStream* s, const WavInfo* wav) {
+    s->channels = wav->channels;
+    s->sampleRate = wav->sampleRate;
+    s->sampleFormat = wav->sampleFormat;
+    s->blockAlign = wav->blockAlign;
+    s->dataRemaining = wav->dataSize;
+}
+
+// ===================================
+// Prebuffer Thresholds
+// ===================================
+// Per source type, indexed by StreamType (INACTIVE unused)
+static const char* prebufferNames[] = { "", "FLASH", "WAV", "MP3", "RAM", "QOA" };
+static uint16_t prebufferMs[] = { 0, PREBUFFER_MS_FLASH, PREBUFFER_MS_WAV, PREBUFFER_MS_MP3,
+                                  PREBUFFER_MS_RAM, PREBUFFER_MS_QOA };
+#define PREBUFFER_TYPES (sizeof(prebufferMs) / sizeof(prebufferMs[0]))
+
+// Ring samples (stereo, interleaved) for a type's threshold
+static uint32_t prebufferSamples(StreamType type) {
+    uint32_t ms = (type < PREBUFFER_TYPES) ? prebufferMs[type] : 0;
+    uint32_t samples = ms * SAMPLE_RATE / 1000 * 2;
+    if (samples > STREAM_BUFFER_SIZE / 2) samples = STREAM_BUFFER_SIZE / 2; // Small rings (no PSRAM)
+    return samples < 2 ? 2 : samples;
+}
+
+// #PREBUFFER <type> <ms> (parseIniFile)
+bool setPrebufferMs(const char* typeName, int ms) {
+    for (unsigned t = 1; t < PREBUFFER_TYPES; t++) {
+        if (strcasecmp(typeName, prebufferNames[t]) == 0) {
+            prebufferMs[t] = constrain(ms, 0, PREBUFFER_MS_MAX);
+            return true;
+        }
+    }
+    Serial.printf("PREBUFFER: ERROR - unknown type '%s'\n", typeName);
+    return false;
+}
+
+void writePrebufferIni(Print& out) {
+    for (unsigned t = 1; t < PREBUFFER_TYPES; t++) {
+        out.printf("#PREBUFFER %s %u\n", prebufferNames[t], prebufferMs[t]);
+    }
+}
+
+// ===================================
+// Buffer Status (BUFS command)
+// ===================================
+void printBufferStatus(Print& out) {
+    out.print("BUFS:prebuffer");
+    for (unsigned t = 1; t < PREBUFFER_TYPES; t++) {
+        out.printf(" %s %ums", prebufferNames[t], prebufferMs[t]);
+    }
+    out.println();
+    for (int i = 0; i < MAX_VOICES; i++) {
+        AudioStream* s = &streams[i];
+        uint32_t ringMs = (uint32_t)s->ringBuffer->availableForRead() * 1000 / (SAMPLE_RATE * 2);
+        out.printf("BUFS:%d %-9s ring %5lums start %4lums underruns %lu concealed %lu\n", i,
+                   !s->active ? "idle" : s->paused ? "paused" : mixVoices.primed[i] ? "playing" : "buffering",
+                   ringMs, mixVoices.startThreshold[i] * 1000 / (SAMPLE_RATE * 2),
+                   mixVoices.underruns[i], mixVoices.concealedFrames[i]);
+    }
+}
+
+void resetBufferStats() {
+    for (int i = 0; i < MAX_VOICES; i++) {
+        mixVoices.underruns[i] = 0;
+        mixVoices.concealedFrames[i] = 0;
+    }
+}
+
 // ===================================
 // Start Stream Playback
 // ===================================
-bool startStream(int streamIdx, const char* filename) {
-    if (streamIdx < 0 || streamIdx >= MAX_STREAMS) return false;
+bool startStream(int streamIdx, const char* filename, uint8_t priority) {
+    if (streamIdx < 0 || streamIdx >= MAX_VOICES) return false;
     
+    cancelCrossfade(streamIdx); // A hard start replaces any crossfade onto this stream
     stopStream(streamIdx); // Ensure stopped first
     
     AudioStream* s = &streams[streamIdx];
+    s->priority = priority;
+    
+    // Would it push Core 0 or the card past the budget? (may stop lower priority streams)
+    if (!admitStream(streamIdx, filename, priority)) return false;
     
     // Determine file type and location
     // Convention: "/flash/..." is Flash, otherwise SD
     bool isFlash = (strncmp(filename, "/flash/", 7) == 0);
     const char* ext = strrchr(filename, '.');
     bool isMP3 = (ext && strcasecmp(ext, ".mp3") == 0);
+    bool isQOA = (ext && strcasecmp(ext, ".qoa") == 0);
+    
+    // Bank 1 sounds loaded into the PSRAM arena skip the filesystem entirely
+    const uint8_t* ramData = nullptr;
+    WavInfo wav;
+    const char* baseName = strrchr(filename, '/');
+    baseName = baseName ? baseName + 1 : filename;
     
-    if (isFlash) {
+    if (isFlash && findResidentSound(baseName, &ramData, &wav)) {
+        // --- WAV from PSRAM (resident) ---
+        s->ramData = ramData;
+        applyWavInfo(s, &wav);
+        s->type = STREAM_TYPE_WAV_RAM;
+        s->decoderIndex = -1;
+        
+    } else if (isFlash) {
         // --- WAV from Flash ---
         mutex_enter_blocking(&flash_mutex);
         s->flashFile = LittleFS.open(filename, "r");
@@ -498,154 +860,118 @@ bool startStream(int streamIdx, const char* filename) {
             return false;
         }
         
-        // Read Header & Find Data Chunk
-        WAVHeader header;
-        s->flashFile.read((uint8_t*)&header, sizeof(WAVHeader));
-        
-        // Check for "data" chunk (basic check)
-        // If not "data", we might need to skip chunks.
-        // For now, do a simple search for "data"
-        if (strncmp(header.data, "data", 4) != 0) {
-            // Header is likely larger or has extra chunks.
-            // Reset to 12 (after RIFF/WAVE) and search
-            s->flashFile.seek(12);
-            
-            char chunkID[4];
-            uint32_t chunkSize;
-            
-            while (s->flashFile.available()) {
-                s->flashFile.read((uint8_t*)chunkID, 4);
-                s->flashFile.read((uint8_t*)&chunkSize, 4);
-                
-                if (strncmp(chunkID, "data", 4) == 0) {
-                    // Found data!
-                    break; 
-                } else {
-                    // Skip this chunk
-                    s->flashFile.seek(s->flashFile.position() + chunkSize);
-                }
-            }
+        // Parse the RIFF chunks, leaves the file at the first sample
+        if (!parseWavFile(s->flashFile, &wav)) {
+            log_message(String("Stream ") + streamIdx + ": ERROR - Unsupported or corrupt WAV");
+            s->flashFile.close();
+            mutex_exit(&flash_mutex);
+            return false;
         }
-        
-        s->channels = header.numChannels;
-        s->sampleRate = header.sampleRate;
-        if (s->channels < 1 || s->channels > 2) s->channels = 2; 
+        applyWavInfo(s, &wav);
         
         s->type = STREAM_TYPE_WAV_FLASH;
         mutex_exit(&flash_mutex);
         
     } else {
         // --- SD Card File ---
-        mutex_enter_blocking(&sd_mutex);
+        // Get the MP3 decoder before taking the card: acquiring may pre-empt
+        // another stream, and stopping that stream closes its SD file.
+        int decoderIdx = -1;
+        if (isMP3) {
+            decoderIdx = acquireMp3Decoder(streamIdx, priority);
+        }
+        
+        sdBegin(SDIO_OPEN);
         s->sdFile = sd.open(filename, FILE_READ);
         if (!s->sdFile) {
             log_message(String("Stream ") + streamIdx + ": ERROR - Could not open SD file");
-            mutex_exit(&sd_mutex);
+            sdEnd();
+            releaseMp3Decoder(decoderIdx);
             return false;
         }
         
         if (isMP3) {
             // --- MP3 Setup ---
-            // Find free decoder
-            int decoderIdx = -1;
-            for (int i = 0; i < MAX_MP3_DECODERS; i++) {
-                if (!mp3DecoderInUse[i]) {
-                    decoderIdx = i;
-                    mp3DecoderInUse[i] = true;
-                    break;
-                }
-            }
-            
             if (decoderIdx == -1) {
-                log_message(String("Stream ") + streamIdx + ": ERROR - No MP3 decoders available");
-                s->sdFile.close();
-                mutex_exit(&sd_mutex);
-                return false;
+                // Pool exhausted and nothing to pre-empt: park the stream with its
+                // file open; serviceMp3Pool() starts it when a decoder frees up.
+                log_message(String("Stream ") + streamIdx + ": No MP3 decoder free, waiting");
+                s->waitingForDecoder = true;
+                s->waitStart = millis();
+                noteMp3Wait();
             }
             
-            s->decoderIndex = decoderIdx;
             s->decoderIndex = decoderIdx;
             s->type = STREAM_TYPE_MP3_SD;
             s->channels = 2; 
             s->sampleRate = 0; // Unknown until first frame decoded 
             
-            // Initialize Decoder
-            if (mp3Decoders[decoderIdx]) {
-                mp3Decoders[decoderIdx]->begin();
+        } else if (isQOA) {
+            // --- QOA from SD ---
+            if (!qoaOpen(s)) {
+                log_message(String("Stream ") + streamIdx + ": ERROR - Not a valid QOA file");
+                s->sdFile.close();
+                sdEnd();
+                return false;
             }
+            s->type = STREAM_TYPE_QOA_SD;
+            s->decoderIndex = -1;
             
         } else {
             // --- WAV from SD ---
-            // Read Header & Find Data Chunk
-            WAVHeader header;
-            s->sdFile.read((uint8_t*)&header, sizeof(WAVHeader));
-            
-            if (strncmp(header.data, "data", 4) != 0) {
-                s->sdFile.seek(12);
-                char chunkID[4];
-                uint32_t chunkSize;
-                
-                while (s->sdFile.available()) {
-                    s->sdFile.read((uint8_t*)chunkID, 4);
-                    s->sdFile.read((uint8_t*)&chunkSize, 4);
-                    
-                    if (strncmp(chunkID, "data", 4) == 0) {
-                        break; 
-                    } else {
-                        s->sdFile.seek(s->sdFile.position() + chunkSize);
-                    }
-                }
+            if (!parseWavFile(s->sdFile, &wav)) {
+                log_message(String("Stream ") + streamIdx + ": ERROR - Unsupported or corrupt WAV");
+                s->sdFile.close();
+                sdEnd();
+                return false;
             }
-            
-            s->channels = header.numChannels;
-            s->sampleRate = header.sampleRate;
-            if (s->channels < 1 || s->channels > 2) s->channels = 2;
+            applyWavInfo(s, &wav);
             
             s->type = STREAM_TYPE_WAV_SD;
             s->decoderIndex = -1;
         }
-        mutex_exit(&sd_mutex);
+        
+        // Start of the file already in the pre-roll cache? (WAV/MP3)
+        if (attachPreroll(s, filename)) {
+            log_message(String("Stream ") + streamIdx + ": Pre-roll hit, " + s->prerollLeft + " bytes from PSRAM");
+        }
+        sdEnd();
     }
     
     strncpy(s->filename, filename, sizeof(s->filename) - 1);
     s->ringBuffer->clear();
-    s->active = true;
+    s->active = !s->waitingForDecoder;
     s->fileFinished = false;
+    s->paused = false;
+    s->bytesSkipped = 0;
+    s->bytesConsumed = 0;
+    s->framesQueued = 0;
+    s->refillUs = 0;
+    s->resampleCarry = 0;
     s->startTime = millis(); // Log start time
+    s->releaseOnFade = nullptr;
+
+    // Mixer side: not running yet (stopStream cleared run), safe from Core 0
+    mixVoices.startThreshold[streamIdx] = prebufferSamples(s->type);
+    mixVoices.primed[streamIdx] = false;
+    mixVoices.concealQ16[streamIdx] = GAIN_UNITY;
+    mixVoices.lastFrame[streamIdx] = 0;
+    mixVoices.framesMixed[streamIdx] = 0;
+    mixVoices.gainQ30[streamIdx] = 0;
+    setStreamGainRamp(streamIdx, GAIN_UNITY, STREAM_FADE_IN_MS);
+    syncMixVoice(streamIdx);
     
     log_message(String("Stream ") + streamIdx + ": Playing " + filename + " (Start: " + s->startTime + "ms)");
     
     if (isMP3) {
         log_message(String("  Format: MP3, Rate: ") + (s->sampleRate > 0 ? String(s->sampleRate) : "Unknown") + "Hz, Ch: " + s->channels);
+    } else if (s->type == STREAM_TYPE_QOA_SD) {
+        log_message(String("  Format: QOA, Rate: ") + s->sampleRate + "Hz, Ch: " + s->channels);
     } else {
-        // Read details for WAV debugging
-        uint16_t bits = 0;
-        uint16_t align = 0;
-        if (s->type == STREAM_TYPE_WAV_SD) {
-             mutex_enter_blocking(&sd_mutex);
-             if (s->sdFile) {
-                 s->sdFile.seek(34); // bitsPerSample
-                 s->sdFile.read(&bits, 2);
-                 s->sdFile.seek(32); // blockAlign
-                 s->sdFile.read(&align, 2);
-                 s->sdFile.seek(44);
-                 uint32_t pos = s->sdFile.position();
-                 s->sdFile.seek(34); s->sdFile.read(&bits, 2);
-                 s->sdFile.seek(32); s->sdFile.read(&align, 2);
-                 s->sdFile.seek(pos);
-             }
-             mutex_exit(&sd_mutex);
-        } else if (s->type == STREAM_TYPE_WAV_FLASH) {
-             mutex_enter_blocking(&flash_mutex);
-             if (s->flashFile) {
-                 uint32_t pos = s->flashFile.position();
-                 s->flashFile.seek(34); s->flashFile.read((uint8_t*)&bits, 2);
-                 s->flashFile.seek(32); s->flashFile.read((uint8_t*)&align, 2);
-                 s->flashFile.seek(pos);
-             }
-             mutex_exit(&flash_mutex);
-        }
-        log_message(String("  Format: WAV, Rate: ") + s->sampleRate + "Hz, Ch: " + s->channels + ", Bits: " + bits + ", Align: " + align);
+        log_message(String("  Format: WAV ") + wavFormatName(s->sampleFormat) +
+                    (s->type == STREAM_TYPE_WAV_RAM ? " (resident)" : "") +
+                    ", Rate: " + s->sampleRate + "Hz, Ch: " + s->channels +
+                    ", Align: " + s->blockAlign + ", Data: " + s->dataRemaining + " bytes");
     }
     return true;
 }
@@ -655,34 +981,43 @@ bool startStream(int streamIdx, const char* filename) {
 // Stop Stream Playback
 // ===================================
 void stopStream(int streamIdx) {
-    if (streamIdx < 0 || streamIdx >= MAX_STREAMS) return;
+    if (streamIdx < 0 || streamIdx >= MAX_VOICES) return;
     AudioStream* s = &streams[streamIdx];
     
     if (!s->active && s->type == STREAM_TYPE_INACTIVE) return;
     
     s->active = false;
+    s->paused = false;
+    s->releaseOnFade = nullptr; // Stopped before its fade finished: nothing left to report
+    syncMixVoice(streamIdx);
+    noteStreamCost(streamIdx); // Before the counters go
+    s->costUs = 0;
+    s->costBytes = 0;
     
-    // Release Decoder
+    // Release Decoder (stays warm in the pool)
     if (s->type == STREAM_TYPE_MP3_SD && s->decoderIndex != -1) {
-        if (mp3Decoders[s->decoderIndex]) {
-            mp3Decoders[s->decoderIndex]->end();
-        }
-        mp3DecoderInUse[s->decoderIndex] = false;
+        releaseMp3Decoder(s->decoderIndex);
         s->decoderIndex = -1;
     }
+    s->waitingForDecoder = false;
     
     // Close Files
     if (s->type == STREAM_TYPE_WAV_FLASH) {
         mutex_enter_blocking(&flash_mutex);
         if (s->flashFile) s->flashFile.close();
         mutex_exit(&flash_mutex);
-    } else if (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_MP3_SD) {
-        mutex_enter_blocking(&sd_mutex);
+    } else if (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_MP3_SD ||
+               s->type == STREAM_TYPE_QOA_SD) {
+        sdBegin(SDIO_OPEN);
         if (s->sdFile) s->sdFile.close();
-        mutex_exit(&sd_mutex);
+        sdEnd();
     }
     
     s->type = STREAM_TYPE_INACTIVE;
+    s->ramData = nullptr;
+    s->prerollData = nullptr;
+    s->prerollLeft = 0;
+    s->dataRemaining = 0;
     s->ringBuffer->clear();
     
     uint32_t duration = millis() - s->startTime;
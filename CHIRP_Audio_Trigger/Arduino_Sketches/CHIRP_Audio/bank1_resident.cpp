@@ -0,0 +1,205 @@
+#include "config.h"
+
+// =================================================================================
+//  BANK 1 PSRAM RESIDENCY
+// =================================================================================
+// Optional (CHIRP.INI: #BANK1_RESIDENT ON). After the flash pack is committed,
+// the PCM data of every Bank 1 file is copied from flash into one PSRAM arena
+// a little at a time from loop(). Once a sound is resident, startStream() plays
+// it straight out of PSRAM: no LittleFS reads and no flash_mutex. Anything that
+// doesn't fit in the arena keeps streaming from flash as before.
+
+#define RESIDENT_LOAD_CHUNK 8192 // Bytes copied per service call (keeps loop() responsive)
+
+struct ResidentSound {
+    char name[32];
+    uint32_t hash;      // FNV-1a of name, checked before strcmp
+    uint32_t offset;    // Start of PCM data in the arena
+    WavInfo wav;        // Format; dataSize = bytes held in the arena
+    volatile bool ready; // Set only once the whole sound is in the arena
+};
+
+bool bank1ResidentEnabled = false;
+
+static uint8_t* arena = nullptr;
+static uint32_t arenaSize = 0;
+static uint32_t arenaUsed = 0;
+
+static ResidentSound* residents = nullptr;
+static int residentCount = 0;    // Entries in residents[] (loaded or loading)
+static int residentReady = 0;
+static int residentSkipped = 0;  // Didn't fit, left on flash
+
+// Loader state
+static bool loading = false;
+static int loadIndex = 0;        // Pack entry being loaded
+static File loadFile;
+static uint32_t loadRemaining = 0;
+static uint32_t loadStartMs = 0;
+
+// ===================================
+// Begin Loading (after flash sync)
+// ===================================
+void beginBank1Residency() {
+    if (!bank1ResidentEnabled) return;
+    if (!BoardProfile::hasPsram) {
+        Serial.println("  Bank 1 residency: needs PSRAM, streaming from flash");
+        return;
+    }
+
+    int entries = getFlashPackEntryCount();
+    if (entries == 0) {
+        Serial.println("  Bank 1 residency: no flash pack to load");
+        return;
+    }
+
+    if (!arena) {
+        // Try the configured size, then back off if PSRAM is tighter than expected
+        for (uint32_t kb = BANK1_RESIDENT_ARENA_KB; kb >= 256 && !arena; kb /= 2) {
+            arena = (uint8_t*)memAllocPsram(kb * 1024, MEM_TAG_RESIDENT);
+            if (arena) arenaSize = kb * 1024;
+        }
+    }
+    if (!residents) {
+        residents = (ResidentSound*)memAllocPsram(entries * sizeof(ResidentSound), MEM_TAG_RESIDENT);
+    }
+    if (!arena || !residents) {
+        Serial.println("  Bank 1 residency: PSRAM allocation failed, streaming from flash");
+        return;
+    }
+
+    arenaUsed = 0;
+    residentCount = 0;
+    residentReady = 0;
+    residentSkipped = 0;
+    loadIndex = 0;
+    loadRemaining = 0;
+    loadStartMs = millis();
+    loading = true;
+
+    Serial.printf("  Bank 1 residency: loading %d files into %lu KB PSRAM arena (background)\n",
+                  entries, arenaSize / 1024);
+}
+
+// Parse the WAV and leave loadFile at the first sample
+static bool openResidentSource(const FlashPackEntry* e, ResidentSound* r) {
+    char path[80];
+    snprintf(path, sizeof(path), "%s/%s", getBank1FlashDir(), e->name);
+    loadFile = LittleFS.open(path, "r");
+    if (!loadFile) return false;
+
+    if (!parseWavFile(loadFile, &r->wav)) {
+        loadFile.close();
+        return false;
+    }
+
+    strncpy(r->name, e->name, sizeof(r->name) - 1);
+    r->name[sizeof(r->name) - 1] = '\0';
+    r->hash = pathHash(r->name);
+    r->ready = false;
+    return r->wav.dataSize > 0;
+}
+
+// ===================================
+// Service Loader (Core 0 loop)
+// ===================================
+void serviceBank1Residency() {
+    if (!loading) return;
+
+    int entries = getFlashPackEntryCount();
+
+    // Start the next file
+    if (loadRemaining == 0) {
+        if (loadIndex >= entries) {
+            loading = false;
+            log_message(String("Bank 1 residency: ") + residentReady + "/" + entries +
+                        " resident, " + (arenaUsed / 1024) + " KB used, " +
+                        residentSkipped + " left on flash (" + (millis() - loadStartMs) + "ms)");
+            return;
+        }
+
+        const FlashPackEntry* e = getFlashPackEntry(loadIndex++);
+        ResidentSound* r = &residents[residentCount];
+
+        mutex_enter_blocking(&flash_mutex);
+        bool ok = openResidentSource(e, r);
+        if (ok && arenaUsed + r->wav.dataSize > arenaSize) {
+            loadFile.close();
+            ok = false;
+        }
+        mutex_exit(&flash_mutex);
+
+        if (!ok) {
+            residentSkipped++;
+            return;
+        }
+
+        r->offset = arenaUsed;
+        arenaUsed += (r->wav.dataSize + 3) & ~3u; // Keep each sound word aligned
+        loadRemaining = r->wav.dataSize;
+        residentCount++;
+        return;
+    }
+
+    // Copy one chunk of the current file
+    ResidentSound* r = &residents[residentCount - 1];
+    uint32_t done = r->wav.dataSize - loadRemaining;
+    uint32_t toRead = loadRemaining > RESIDENT_LOAD_CHUNK ? RESIDENT_LOAD_CHUNK : loadRemaining;
+
+    mutex_enter_blocking(&flash_mutex);
+    int n = loadFile.read(arena + r->offset + done, toRead);
+    mutex_exit(&flash_mutex);
+
+    if (n <= 0) {
+        // Truncated file: give the space back, leave it on flash
+        mutex_enter_blocking(&flash_mutex);
+        loadFile.close();
+        mutex_exit(&flash_mutex);
+        arenaUsed = r->offset;
+        residentCount--;
+        residentSkipped++;
+        loadRemaining = 0;
+        return;
+    }
+
+    loadRemaining -= n;
+    if (loadRemaining == 0) {
+        mutex_enter_blocking(&flash_mutex);
+        loadFile.close();
+        mutex_exit(&flash_mutex);
+        r->ready = true;
+        residentReady++;
+    }
+}
+
+// ===================================
+// Lookup (startStream)
+// ===================================
+bool findResidentSound(const char* name, const uint8_t** data, WavInfo* info) {
+    if (!residents || residentReady == 0) return false;
+
+    uint32_t h = pathHash(name);
+    for (int i = 0; i < residentCount; i++) {
+        ResidentSound* r = &residents[i];
+        if (r->ready && r->hash == h && strcmp(r->name, name) == 0) {
+            *data = arena + r->offset;
+            *info = r->wav;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ===================================
+// Residency Report (RESD command)
+// ===================================
+void printBank1Residency(Print& out) {
+    if (!bank1ResidentEnabled) {
+        out.println("RESD:off");
+        return;
+    }
+    out.printf("RESD:%s,%d/%d,%luKB/%luKB,skipped %d\n",
+               loading ? "loading" : "ready",
+               residentReady, getFlashPackEntryCount(),
+               arenaUsed / 1024, arenaSize / 1024, residentSkipped);
+}
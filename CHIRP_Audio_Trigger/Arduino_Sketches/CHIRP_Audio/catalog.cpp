@@ -0,0 +1,192 @@
+#include "config.h"
+#include <CRC32.h>
+
+// =================================================================================
+//  SOUND CATALOG SNAPSHOTS (CTLG command)
+// =================================================================================
+// Everything the card scans find (Bank 1 names, banks 2-6, root tracks and
+// the MSUM checksum) lives in one Catalog. A published catalog is never
+// written again. A rescan (CTLG:S) fills a second one in the background while
+// PLAY, GNME, LIST and the trigger inputs keep resolving sounds from the
+// current one, then swaps the pointer in one store.
+//
+// Readers call catalog() once per operation and use that pointer throughout.
+// They never keep it past the end of the scheduler task they run in, so once
+// the scheduler pass in which the swap happened is over, nobody can still be
+// reading the old snapshot and it is freed (a grace period of one pass).
+// Core 1 never reads the catalog.
+//
+// The boot scan builds in place (nothing reads the catalog during setup).
+// Rescan snapshots come from PSRAM; the boot buffer is reused once it has
+// been retired. A rescan keeps Bank 1 as it is: changing it means a flash
+// sync, which only happens at boot.
+
+enum RescanPhase {
+    RESCAN_IDLE,
+    RESCAN_START,   // Waiting for a buffer (the previous snapshot's grace period)
+    RESCAN_SD,      // Banks 2-6
+    RESCAN_ROOT,    // Root tracks
+    RESCAN_PUBLISH
+};
+
+static Catalog bootCatalog;
+const Catalog* currentCatalog = &bootCatalog;
+
+static bool published = false;
+static bool bootFree = false;        // Boot buffer retired and reclaimed
+static Catalog* retired = nullptr;   // Waiting out its grace period
+static uint32_t retiredEpoch = 0;
+
+// Rescan
+static RescanPhase phase = RESCAN_IDLE;
+static Catalog* building = nullptr;
+static uint32_t rescanStartMs = 0;
+static uint32_t rescans = 0;
+static uint32_t rescanFailures = 0;
+static uint32_t lastRescanMs = 0;
+
+// ===================================
+// Build / Publish
+// ===================================
+// Empty catalog to scan into, or nullptr (no memory, or the previous
+// snapshot hasn't been reclaimed yet)
+Catalog* beginCatalogBuild() {
+    Catalog* c;
+    if (!published) {
+        c = &bootCatalog;
+    } else if (retired) {
+        return nullptr;
+    } else if (bootFree) {
+        bootFree = false;
+        c = &bootCatalog;
+    } else {
+        c = (Catalog*)memAllocPsram(sizeof(Catalog), MEM_TAG_CATALOG);
+        if (!c) return nullptr;
+    }
+    memset(c, 0, sizeof(*c));
+    return c;
+}
+
+static void releaseCatalog(Catalog* c) {
+    if (c == &bootCatalog) bootFree = true;
+    else memFree(c);
+}
+
+static uint32_t catalogChecksum(const Catalog* c) {
+    CRC32 crc;
+    // 1. Bank 1 (Flash) variant filenames
+    for (int i = 0; i < c->bank1SoundCount; i++) {
+        for (int v = 0; v < c->bank1Sounds[i].variantCount; v++) {
+            crc.update(c->bank1Sounds[i].variants[v], strlen(c->bank1Sounds[i].variants[v]));
+        }
+    }
+    // 2. Banks 2-6 (SD) filenames
+    for (int i = 0; i < c->sdBankCount; i++) {
+        for (int f = 0; f < c->sdBanks[i].fileCount; f++) {
+            crc.update(c->sdBanks[i].files[f], strlen(c->sdBanks[i].files[f]));
+        }
+    }
+    return crc.finalize();
+}
+
+// Seal a scanned catalog and make it the current one
+void publishCatalog(Catalog* c) {
+    const Catalog* old = currentCatalog;
+    c->checksum = catalogChecksum(c);
+    c->generation = published ? old->generation + 1 : 1;
+    __atomic_store_n(&currentCatalog, (const Catalog*)c, __ATOMIC_RELEASE);
+
+    if (published && old != c) {
+        retired = (Catalog*)old;
+        retiredEpoch = schedulerEpoch();
+        if (c->checksum != old->checksum) flushPrerollCache(); // Cached heads may be other files now
+    }
+    published = true;
+}
+
+// ===================================
+// Rescan (CTLG:S)
+// ===================================
+bool requestCatalogRescan() {
+    if (phase != RESCAN_IDLE) return false;
+    phase = RESCAN_START;
+    rescanStartMs = millis();
+    return true;
+}
+
+static void failRescan(const char* why) {
+    if (building) releaseCatalog(building);
+    building = nullptr;
+    phase = RESCAN_IDLE;
+    rescanFailures++;
+    log_message(String("CTLG: Rescan failed - ") + why);
+}
+
+// Core 0 housekeeping: reclaim the retired snapshot, and run a rescan one
+// phase per call so commands are served from the old catalog in between
+void serviceCatalog() {
+    if (retired && schedulerEpoch() != retiredEpoch) {
+        releaseCatalog(retired);
+        retired = nullptr;
+    }
+
+    if (phase == RESCAN_IDLE || audioRefillUrgent()) return;
+
+    switch (phase) {
+        case RESCAN_START: {
+            if (retired) return; // Next pass
+            building = beginCatalogBuild();
+            if (!building) {
+                failRescan("no memory for a second catalog");
+                return;
+            }
+            // Bank 1 only changes with a flash sync (boot), keep it
+            const Catalog* cur = catalog();
+            memcpy(building->bank1Sounds, cur->bank1Sounds, sizeof(cur->bank1Sounds));
+            building->bank1SoundCount = cur->bank1SoundCount;
+            strcpy(building->bank1DirName, cur->bank1DirName);
+            phase = RESCAN_SD;
+            break;
+        }
+
+        case RESCAN_SD:
+            scanSDBanks(building);
+            phase = RESCAN_ROOT;
+            break;
+
+        case RESCAN_ROOT:
+            scanRootTracks(building);
+            phase = RESCAN_PUBLISH;
+            break;
+
+        case RESCAN_PUBLISH: {
+            uint32_t oldSum = catalog()->checksum;
+            publishCatalog(building);
+            building = nullptr;
+            phase = RESCAN_IDLE;
+            rescans++;
+            lastRescanMs = millis() - rescanStartMs;
+            const Catalog* cat = catalog();
+            log_message(String("CTLG: Generation ") + cat->generation + ", " + cat->sdBankCount + " banks, " +
+                        cat->rootTrackCount + " root tracks" + (cat->checksum == oldSum ? " (unchanged)" : "") +
+                        ", " + lastRescanMs + "ms");
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+// ===================================
+// Status (CTLG command)
+// ===================================
+void printCatalogStatus(Print& out) {
+    static const char* phaseNames[] = { "idle", "waiting", "banks", "root", "publish" };
+    const Catalog* cat = catalog();
+    out.printf("CTLG:generation %lu,checksum %lu,bank1 %d sounds,sd banks %d,root tracks %d\n",
+               cat->generation, cat->checksum, cat->bank1SoundCount, cat->sdBankCount, cat->rootTrackCount);
+    out.printf("CTLG:rescan %s,rescans %lu,last %lums,failed %lu,snapshot %s %uB,retired %s\n",
+               phaseNames[phase], rescans, lastRescanMs, rescanFailures,
+               cat == &bootCatalog ? "boot" : "heap", (unsigned)sizeof(Catalog), retired ? "pending" : "none");
+}
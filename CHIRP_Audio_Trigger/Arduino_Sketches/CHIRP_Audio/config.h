@@ -35,11 +35,101 @@ using namespace libhelix;
 #define PIN_BTN_FWD 16 // Next
 #define PIN_BTN_REV 18 // Prev
 
+// Input events (input_events.cpp): edge interrupts -> gesture queue
+#define INPUT_MAX 24          // 3 panel buttons + 18 MP3 Trigger style trigger pins + spare
+#define INPUT_DEBOUNCE_US 5000
+#define INPUT_LONG_MS 600     // Held this long = long press
+#define INPUT_DOUBLE_MS 300   // Second press within this of a release = double press
+
+// Trigger pins (#TRIGGER lines in CHIRP.INI, trigger_inputs.cpp)
+#define TRIGGER_MAX 18                 // As many as the original MP3 Trigger
+#define TRIGGER_LATENCY_BUDGET_US 10000 // Edge -> first sample at the mixer
+
 // Development Mode
 #define DEV_MODE true
 #define DEV_SYNC_LIMIT 100
 #define FORMAT_FLASH false
 
+// Flash Sound Pack (Bank 1 A/B slots on LittleFS)
+#define FLASH_PACK_SLOTS 2
+
+// Bank 1 PSRAM Residency (enabled by #BANK1_RESIDENT ON in CHIRP.INI)
+#define BANK1_RESIDENT_ARENA_KB 4096
+
+// PSRAM pre-roll cache: the start of likely-next SD sounds (preroll_cache.cpp)
+#define PREROLL_SLOTS 16
+#define PREROLL_SLOT_KB 64 // ~0.37s of 16-bit stereo WAV, ~2.7s of 192kbps MP3
+
+// Next-sound prediction (predict.cpp)
+#define PREDICT_SOUNDS 128 // Sounds with a successor list
+#define PREDICT_TOPK 4     // Successors kept per sound
+
+// ===================================
+// Build Profile
+// ===================================
+// Board-dependent audio limits come from one profile type picked at compile
+// time. Everything sized from it (stream tables, rings, decoder pool) is
+// static, and the ring index math is constexpr masks instead of modulo.
+//   default                 Pimoroni Pico Plus 2 (8MB PSRAM) / CHIRP PCB
+//   -DCHIRP_PROFILE_PICO2   plain Pico 2, no PSRAM: smaller rings in SRAM,
+//                           no Bank 1 residency
+template <int Streams, int RingLog2, bool Psram, int Mp3Slots, int Mp3SramSlots, uint32_t Mp3PsramBudget>
+struct AudioProfile {
+    static constexpr int maxStreams = Streams;
+    static constexpr uint32_t ringSamples = 1u << RingLog2; // Per voice, interleaved stereo
+    static constexpr uint32_t ringMask = ringSamples - 1;
+    static constexpr bool hasPsram = Psram;
+    static constexpr int mp3Slots = Mp3Slots;
+    static constexpr int mp3SramSlots = Mp3SramSlots;
+    static constexpr uint32_t mp3PsramBudget = Mp3PsramBudget;
+
+    // MP3 refill only reads when 16K samples are free (a 512-byte read can
+    // decode to several frames), so the ring must hold at least twice that
+    static_assert(RingLog2 >= 15 && RingLog2 <= 20, "ring size out of range");
+    static_assert(Mp3SramSlots <= Mp3Slots, "more SRAM decoders than slots");
+    static_assert(Psram || Mp3SramSlots == Mp3Slots, "no PSRAM: every decoder lives in SRAM");
+};
+
+#ifdef CHIRP_PROFILE_PICO2
+typedef AudioProfile<2, 15, false, 2, 2, 0> BoardProfile;        // 3 x 64KB rings in SRAM
+#define CHIRP_HAS_PSRAM 0
+#else
+typedef AudioProfile<3, 18, true, 4, 2, 64 * 1024> BoardProfile; // 4 x 512KB rings in PSRAM
+#define CHIRP_HAS_PSRAM 1
+#endif
+
+// The core only declares pmalloc() and the rp2040 PSRAM heap calls on boards
+// with PSRAM, so the sketch goes through these instead (no PSRAM: no
+// allocation, empty heap)
+static inline void* psramMalloc(size_t size) {
+#if CHIRP_HAS_PSRAM
+    return pmalloc(size);
+#else
+    return nullptr;
+#endif
+}
+static inline uint32_t psramTotalHeap() {
+#if CHIRP_HAS_PSRAM
+    return rp2040.getTotalPSRAMHeap();
+#else
+    return 0;
+#endif
+}
+static inline uint32_t psramUsedHeap() {
+#if CHIRP_HAS_PSRAM
+    return rp2040.getUsedPSRAMHeap();
+#else
+    return 0;
+#endif
+}
+static inline uint32_t psramFreeHeap() {
+#if CHIRP_HAS_PSRAM
+    return rp2040.getFreePSRAMHeap();
+#else
+    return 0;
+#endif
+}
+
 // Audio Configuration
 #define SAMPLE_RATE 44100
 #define WAV_BUFFER_SIZE 8192
@@ -57,27 +147,52 @@ using namespace libhelix;
 // ===================================
 // Struct Definitions
 // ===================================
-struct WAVHeader {
-    char riff[4];
-    uint32_t fileSize;
-    char wave[4];
-    char fmt[4];
-    uint32_t fmtSize;
-    uint16_t audioFormat;
-    uint16_t numChannels;
-    uint32_t sampleRate;
-    uint32_t byteRate;
-    uint16_t blockAlign;
+// Sample encodings the WAV path can convert to int16 (see wav_format.cpp)
+enum WavSampleFormat {
+    WAV_FMT_U8 = 0,  // 8-bit unsigned PCM
+    WAV_FMT_S16,     // 16-bit PCM
+    WAV_FMT_S24,     // 24-bit packed PCM
+    WAV_FMT_S32,     // 32-bit PCM
+    WAV_FMT_F32      // 32-bit IEEE float
+};
+
+// Result of parsing a RIFF/WAVE header
+struct WavInfo {
+    uint8_t sampleFormat; // WavSampleFormat
+    uint8_t channels;
     uint16_t bitsPerSample;
-    char data[4];
-    uint32_t dataSize;
+    uint16_t blockAlign;  // Bytes per frame (all channels)
+    uint32_t sampleRate;
+    uint32_t dataOffset;  // File position of the first sample
+    uint32_t dataSize;    // Bytes of sample data, whole frames only
 };
 
+// FNV-1a of a path or file name, never 0 (tables use 0 for an empty slot).
+// Admission's cost table, the pre-roll cache and Bank 1 residency all key on it.
+static inline uint32_t pathHash(const char* path) {
+    uint32_t h = 2166136261u;
+    while (*path) {
+        h ^= (uint8_t)*path++;
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+// FAT modify date << 16 | time of an SD file. With the size, this is what
+// tells a file edited in place from the copy cached of it (flash pack,
+// pre-roll cache) without reading it.
+static inline uint32_t sdFileStamp(FsFile& f) {
+    uint16_t date = 0, time = 0;
+    f.getModifyDateTime(&date, &time);
+    return ((uint32_t)date << 16) | time;
+}
+
 struct SoundFile {
     char basename[16];
     char variants[25][32];
+    uint32_t variantSizes[25]; // Recorded by scanBank1() for the flash pack diff
+    uint32_t variantStamps[25]; // SD modify time, same (see sdFileStamp())
     int variantCount;
-    int lastVariantPlayed; // For non-repeating random
 };
 
 struct SDBank {
@@ -88,6 +203,32 @@ struct SDBank {
     int fileCount;
 };
 
+struct FlashPackEntry {
+    char name[32];
+    uint32_t size;
+    uint32_t crc;      // CRC32 of the file contents, verified at write time
+    uint32_t modified; // sdFileStamp() of the SD file it was copied from
+};
+
+struct FlashSyncStats {
+    uint32_t bytesRead;
+    uint32_t bytesWritten;
+    uint32_t elapsedMs;
+    uint32_t blocksProgrammed; // Erase blocks written this sync
+    uint32_t lifetimeBlocks;   // Running total kept in the pack header
+    uint32_t flashBlockSize;
+    uint32_t flashTotalBlocks;
+};
+
+enum PackSyncResult {
+    PACK_SYNC_BUSY = 0,     // Working, call again
+    PACK_SYNC_FILE_STARTED, // Opened the next file
+    PACK_SYNC_FILE_COPIED,  // A file from SD was written and verified
+    PACK_SYNC_FILE_REUSED,  // A file was carried over from the active slot
+    PACK_SYNC_DONE,         // New pack committed (or nothing to do)
+    PACK_SYNC_FAILED        // Target slot discarded, active pack untouched
+};
+
 struct SerialMessage {
     char buffer[SERIAL2_MSG_MAX_LENGTH];
     uint8_t length;
@@ -117,18 +258,11 @@ extern mutex_t log_mutex;
 
 // --- Legacy Stream Variables Removed (Replaced by AudioStream streams[]) ---
 
-// Bank File Lists
-extern SoundFile bank1Sounds[MAX_SOUNDS];
-extern int bank1SoundCount;
-extern char bank1DirName[64]; 
+// Bank File Lists: see Catalog below
 extern char activeBank1Page;
-extern SDBank sdBanks[MAX_SD_BANKS];
-extern int sdBankCount;
 
 // Root Tracks (Legacy Compatibility)
 #define MAX_ROOT_TRACKS 255
-extern char rootTracks[MAX_ROOT_TRACKS][16]; // "NNN.MP3"
-extern int rootTrackCount;
 
 // Test Tone State
 extern volatile bool testToneActive;
@@ -138,15 +272,40 @@ extern volatile int16_t masterAttenMultiplier;
 #define TEST_TONE_FREQ 440
 #define PHASE_INCREMENT ((uint32_t)TEST_TONE_FREQ << 16) / SAMPLE_RATE
 
-// MP3 Decoder
-extern MP3DecoderHelix* mp3Decoder; // "Option 2" PSRAM fix
-
-// Filename Checksum
-extern uint32_t globalFilenameChecksum;
 
 // Outgoing Serial Message Queue
 extern SerialQueue serial2Queue;
 
+// ===================================
+// Sound Catalog (snapshots, catalog.cpp)
+// ===================================
+// Everything the scans find, in one block. A published snapshot is never
+// written again: a rescan fills a fresh one and swaps the pointer. Readers
+// take catalog() once per operation and use that pointer throughout, and
+// never keep it past the end of the scheduler task they run in.
+struct Catalog {
+    uint32_t generation; // 1 = boot scan, +1 per rescan
+    uint32_t checksum;   // CRC32 of the file names (MSUM)
+
+    // Bank 1 (flash)
+    SoundFile bank1Sounds[MAX_SOUNDS];
+    int bank1SoundCount;
+    char bank1DirName[64];
+
+    // Banks 2-6 (SD)
+    SDBank sdBanks[MAX_SD_BANKS];
+    int sdBankCount;
+
+    // Root Tracks (Legacy Compatibility)
+    char rootTracks[MAX_ROOT_TRACKS][16]; // "NNN.MP3"
+    int rootTrackCount;
+};
+
+extern const Catalog* currentCatalog;
+inline const Catalog* catalog() {
+    return __atomic_load_n(&currentCatalog, __ATOMIC_ACQUIRE);
+}
+
 // Control I2S Hardware State from Core 0
 extern volatile bool g_allowAudio;
 
@@ -154,39 +313,97 @@ extern volatile bool g_allowAudio;
 // NEW: Flexible Audio Architecture
 // ===================================
 
-#define MAX_STREAMS 3
-#define MAX_MP3_DECODERS 2
-#define STREAM_BUFFER_SIZE (256 * 1024) // 256K samples = 512KB per stream (PSRAM)
+#define MAX_STREAMS BoardProfile::maxStreams
+
+// Mixer voices: the public streams plus one shadow voice that a crossfade
+// starts the incoming track on (swapped into the stream's slot afterwards)
+#define SHADOW_VOICE MAX_STREAMS
+#define MAX_VOICES (MAX_STREAMS + 1)
+
+// Mixer-side gain ramps. Levels are given in Q16 (65536 = unity); the mixer
+// ramps in Q30 so the per-sample step stays exact for long fades.
+#define GAIN_UNITY 65536
+#define GAIN_RAMP_SHIFT 14   // Q16 -> Q30
+#define GAIN_RAMP_MAX_MS 60000 // Longest fade/crossfade (XFAD, FADE, STOP:n,ms)
+#define STREAM_FADE_IN_MS 50 // Anti-pop ramp on start/resume
+
+// Start threshold: audio buffered in the ring before the mixer starts a
+// stream (and restarts it after an underrun). Defaults per source type,
+// #PREBUFFER <RAM|FLASH|WAV|QOA|MP3> <ms> in CHIRP.INI overrides.
+#define PREBUFFER_MS_RAM 0    // Resident: the first refill is a memcpy
+#define PREBUFFER_MS_FLASH 5
+#define PREBUFFER_MS_WAV 20   // SD WAV
+#define PREBUFFER_MS_QOA 20   // Decodes a whole 5120-sample frame at a time anyway
+#define PREBUFFER_MS_MP3 50   // About two MP3 frames
+#define PREBUFFER_MS_MAX 1000
+
+// Underrun concealment: on a dry ring the last frame is faded to silence
+// instead of cutting out, and the stream fades back in once it has rebuffered
+#define UNDERRUN_FADE_OUT_MS 2
+#define UNDERRUN_FADE_IN_MS 10
+
+// Admission control: what a start may add up to, per second of audio
+// (#ADMIT <ON|OFF> <core0 %> <SD KB/s> in CHIRP.INI, see admission.cpp)
+#define ADMIT_CORE0_BUDGET_PCT 75 // Core 0 refill + decode time
+#define ADMIT_SD_BUDGET_KBPS 1200 // SPI SD read rate with headroom for seeks
+
+// MP3 Decoder Pool (decoders live in PSRAM - the "Option 2" fix)
+#define MP3_POOL_SLOTS BoardProfile::mp3Slots                // Most decoder objects that may exist at once
+#define MP3_POOL_PSRAM_BUDGET BoardProfile::mp3PsramBudget   // PSRAM bytes the pool may hold
+#define MP3_POOL_SRAM_SLOTS BoardProfile::mp3SramSlots       // Decoders placed in on-chip SRAM (0 = all PSRAM)
+#define MP3_POOL_SRAM_BUDGET (160 * 1024) // SRAM bytes the pool may hold: SRAM objects plus Helix's own state
+#define MP3_POOL_WARM 2                  // Decoders kept allocated while idle
+#define MP3_POOL_IDLE_MS 30000           // Idle time before an extra decoder is freed
+#define MP3_POOL_WAIT_MS 1500            // How long a start may wait for a free decoder
+
+// Stream priorities (decoder stealing / waiting order)
+#define STREAM_PRIORITY_LOW    0
+#define STREAM_PRIORITY_NORMAL 1
+#define STREAM_PRIORITY_HIGH   2
+#define STREAM_BUFFER_SIZE BoardProfile::ringSamples // 256K samples = 512KB per stream on the PSRAM board
 
 enum StreamType {
     STREAM_TYPE_INACTIVE = 0,
     STREAM_TYPE_WAV_FLASH, // Legacy optimized path (optional, or treat as generic)
     STREAM_TYPE_WAV_SD,
-    STREAM_TYPE_MP3_SD
+    STREAM_TYPE_MP3_SD,
+    STREAM_TYPE_WAV_RAM,   // Bank 1 sound resident in the PSRAM arena
+    STREAM_TYPE_QOA_SD     // QOA compressed (~3.2 bits/sample) from SD
 };
 
-struct RingBuffer {
-    int16_t* buffer; // Pointer to PSRAM
-    volatile int readPos;
-    volatile int writePos;
+// QOA ("Quite OK Audio") frame limits
+#define QOA_FRAME_SAMPLES 5120                         // Per channel, max per frame
+#define QOA_MAX_FRAME_BYTES (8 + 2 * 16 + 256 * 2 * 8) // Stereo worst case
+#define QOA_MAX_FRAME_OUT (QOA_FRAME_SAMPLES * 4)      // Ring samples one frame can expand to
+
+// Single producer (Core 0 refill) / single consumer (Core 1 mixer). Positions
+// are unsigned and wrap with the constexpr mask, so nothing on the mixer's
+// path divides.
+template <uint32_t Size>
+struct RingBufferT {
+    static_assert((Size & (Size - 1)) == 0, "ring size must be a power of two");
+    static constexpr uint32_t mask = Size - 1;
+
+    int16_t* buffer; // PSRAM (or SRAM on a board without it)
+    volatile uint32_t readPos;
+    volatile uint32_t writePos;
     
     // Helper to get available write space
     int availableForWrite() {
         if (!buffer) return 0;
-        int currentLevel = (writePos - readPos + STREAM_BUFFER_SIZE) % STREAM_BUFFER_SIZE;
-        return (STREAM_BUFFER_SIZE - 1) - currentLevel;
+        return (int)(mask - ((writePos - readPos) & mask));
     }
     
     // Helper to get available samples to read
     int availableForRead() {
         if (!buffer) return 0;
-        return (writePos - readPos + STREAM_BUFFER_SIZE) % STREAM_BUFFER_SIZE;
+        return (int)((writePos - readPos) & mask);
     }
     
     bool push(int16_t sample) {
         if (!buffer) return false;
         
-        int nextWrite = (writePos + 1) % STREAM_BUFFER_SIZE;
+        uint32_t nextWrite = (writePos + 1) & mask;
         if (nextWrite == readPos) {
             // Buffer Full - Drop sample
             return false;
@@ -200,33 +417,81 @@ struct RingBuffer {
     int16_t pop() {
         if (!buffer) return 0;
         int16_t sample = buffer[readPos];
-        readPos = (readPos + 1) % STREAM_BUFFER_SIZE;
+        readPos = (readPos + 1) & mask;
         return sample;
     }
-    
+
+    // Block write of whole stereo frames (at most two copies around the wrap).
+    // Only complete L/R pairs go in, so readPos/writePos always stay even and
+    // the mixer can pop a frame as one aligned 32-bit word. Returns samples written.
+    // The copy is a plain word loop rather than memcpy so it inlines into the
+    // SRAM-resident MP3 callback; src must be 4-byte aligned.
+    static inline void copyFrames(int16_t* dst, const int16_t* src, int samples) {
+        uint32_t* d = (uint32_t*)dst;
+        const uint32_t* s = (const uint32_t*)src;
+        for (int i = samples >> 1; i > 0; i--) *d++ = *s++;
+    }
+
+    int writeBlock(const int16_t* src, int count) {
+        if (!buffer) return 0;
+        int space = availableForWrite();
+        if (count > space) count = space;
+        count &= ~1;
+        if (count <= 0) return 0;
+
+        uint32_t wp = writePos;
+        int first = (int)(Size - wp);
+        if (first > count) first = count;
+        copyFrames(&buffer[wp], src, first);
+        if (count > first) copyFrames(buffer, src + first, count - first);
+        writePos = (wp + count) & mask; // Publish after the data is in
+        return count;
+    }
+
+    // Pop one stereo frame packed as L | (R << 16). Caller checks availableForRead() >= 2.
+    uint32_t popFrame() {
+        if (!buffer) return 0;
+        uint32_t rp = readPos;
+        uint32_t frame = *(const uint32_t*)&buffer[rp];
+        readPos = (rp + 2) & mask;
+        return frame;
+    }
+
     void clear() {
         readPos = 0;
         writePos = 0;
-        if (buffer) {
-            // Optional: memset(buffer, 0, STREAM_BUFFER_SIZE * sizeof(int16_t));
-            // But clearing pointers is enough for ring buffer logic usually.
-            // For safety against noise:
-            // memset(buffer, 0, STREAM_BUFFER_SIZE * sizeof(int16_t)); 
-            // (memset on 512KB might be slow, so maybe skip or do partial?)
-        }
+        // No memset: the mixer never reads past writePos, and zeroing 512KB of
+        // PSRAM on every start would cost more than it's worth
     }
 };
 
+typedef RingBufferT<STREAM_BUFFER_SIZE> RingBuffer;
+
 struct AudioStream {
     bool active;
     StreamType type;
     float volume; // 0.0 to 1.0
     int decoderIndex; // -1 if not using MP3 decoder
+    uint8_t priority; // STREAM_PRIORITY_*
+    bool waitingForDecoder; // File open, parked until the pool frees a decoder
+    uint32_t waitStart;
     
     // File Handles
     File flashFile; // For LittleFS
     FsFile sdFile;  // For SdFat
     
+    // Resident (PSRAM) source for STREAM_TYPE_WAV_RAM
+    const uint8_t* ramData;
+    
+    // Pre-roll cache hit (SD WAV/MP3): read these first, the file is already past them
+    const uint8_t* prerollData;
+    uint32_t prerollLeft;
+    
+    // WAV sample layout (all WAV types)
+    uint8_t sampleFormat;   // WavSampleFormat
+    uint16_t blockAlign;
+    uint32_t dataRemaining; // Bytes of the data chunk still to read
+    
     // Buffer
     RingBuffer* ringBuffer;
     
@@ -236,13 +501,65 @@ struct AudioStream {
     bool fileFinished;
     uint8_t channels; // 1 = Mono, 2 = Stereo
     uint32_t sampleRate; // Source sample rate (e.g. 44100 or 22050)
+    uint32_t resampleCarry; // Last frame of the previous block (22.05k interpolation)
     uint32_t startTime; // Debug timestamp
+    
+    Stream* releaseOnFade;     // STOP:n,ms / FADE to 0: stop when silent and report here
+    
+    // Pause (mixer stops reading; file, decoder and ring are kept)
+    volatile bool paused;
+    uint32_t pausedAt;
+    
+    // Play position tracking, for seek-based resume of a reclaimed paused stream
+    uint32_t bytesSkipped;          // Source bytes skipped by a resume seek
+    uint32_t bytesConsumed;         // Source bytes read since (start or resume)
+    uint32_t framesQueued;          // Output frames written into the ring
+
+    // Admission control (admission.cpp): cost charged at start, per second of audio
+    uint32_t costUs;                // Core 0 time
+    uint32_t costBytes;             // SD bytes
+    uint32_t refillUs;              // Core 0 time actually spent refilling since start
 };
 
-extern AudioStream streams[MAX_STREAMS];
-extern RingBuffer streamBuffers[MAX_STREAMS];
-extern MP3DecoderHelix* mp3Decoders[MAX_MP3_DECODERS];
-extern bool mp3DecoderInUse[MAX_MP3_DECODERS];
+extern AudioStream streams[MAX_VOICES];
+extern RingBuffer streamBuffers[MAX_VOICES];
+
+// ===================================
+// Mixer Voice Table (Core 1 hot path)
+// ===================================
+// AudioStream is Core 0's control object (file handles, names, decoder,
+// position). The mixer only touches this table: one array per field, so the
+// per-sample loop walks a few small arrays instead of striding ~200-byte
+// structs, and the fields are grouped by writer with each group on its own
+// MIX_LINE so Core 0's control writes never share a line with the mixer's
+// per-sample writes. Core 0 publishes run/ended/volume with syncMixVoice().
+#define MIX_LINE 32
+
+struct MixerVoices {
+    // Control: written by Core 0, read by the mixer
+    alignas(MIX_LINE) RingBuffer* ring[MAX_VOICES];
+    volatile bool run[MAX_VOICES];          // active && !paused
+    volatile bool ended[MAX_VOICES];        // Source fully read: drain, no underrun
+    volatile int32_t volQ8[MAX_VOICES];     // Stream volume, 256 = 1.0
+    volatile int32_t gainTarget[MAX_VOICES]; // Q30
+    volatile int32_t gainStep[MAX_VOICES];  // Q30 per sample, 0 = hold
+    uint32_t startThreshold[MAX_VOICES];    // Ring samples needed before (re)starting
+    volatile int16_t swapPair;              // (a << 8) | b: mixer swaps these voices between samples, -1 = none
+
+    // Mixer state: written by Core 1 every sample (Core 0 only while !run)
+    alignas(MIX_LINE) volatile int32_t gainQ30[MAX_VOICES]; // Advanced one step per sample towards gainTarget
+    int32_t concealQ16[MAX_VOICES];         // Underrun fade gain, GAIN_UNITY = clear
+    uint32_t lastFrame[MAX_VOICES];         // Held and faded out on an underrun
+    volatile bool primed[MAX_VOICES];       // Threshold reached; cleared by an underrun
+
+    // Counters: written by Core 1, read by Core 0
+    alignas(MIX_LINE) volatile uint32_t framesMixed[MAX_VOICES]; // Output frames played
+    volatile uint32_t firstMixUs[MAX_VOICES];                   // micros() of the first (trigger latency)
+    volatile uint32_t underruns[MAX_VOICES];
+    volatile uint32_t concealedFrames[MAX_VOICES];
+};
+
+extern MixerVoices mixVoices;
 
 // ===================================
 // Function Prototypes
@@ -251,28 +568,154 @@ extern bool mp3DecoderInUse[MAX_MP3_DECODERS];
 // from serial_commands.cpp
 void log_message(const String& msg);
 void processSerialCommands(Stream &serial); // Dual-buffer fix
+void sendSerialResponse(Stream &serial, const char* msg);
+void sendSerialResponseF(Stream &serial, const char* format, ...);
+int getNextAvailableStream();
+const char* resolveSoundPath(int bank, char page, int index, char* fullPath, size_t len);
+int startSoundPath(int stream, const char* fullPath, int volume, uint8_t priority);
+int playSound(int stream, int bank, char page, int index, int volume, uint8_t priority);
 
 // from file_management.cpp
 bool parseIniFile();
-void scanBank1();
+void scanBank1(Catalog* c);
 bool syncBank1ToFlash(bool fwUpdated);
-void scanSDBanks();
-void scanRootTracks();
-SDBank* findSDBank(uint8_t bank, char page);
-const char* getSDFile(uint8_t bank, char page, int index);
+void scanSDBanks(Catalog* c);
+void scanRootTracks(Catalog* c);
+const SDBank* findSDBank(const Catalog* c, uint8_t bank, char page);
+const char* getSDFile(const Catalog* c, uint8_t bank, char page, int index);
+
+// from catalog.cpp
+Catalog* beginCatalogBuild();
+void publishCatalog(Catalog* c);
+bool requestCatalogRescan();
+void serviceCatalog();
+void printCatalogStatus(Print& out);
+
+// from flash_pack.cpp
+bool loadFlashPack();
+const char* getBank1FlashDir();
+int planFlashPackSync(int fileLimit);
+bool beginFlashPackSync();
+PackSyncResult stepFlashPackSync();
+bool isFlashPackSyncing();
+const char* getFlashPackSyncFile();
+void getFlashPackSyncCounts(int* copiedFromSD, int* reusedFromFlash);
+int clearFlashPacks();
+void getFlashPackSyncStats(FlashSyncStats* out);
+void printFlashPackSyncStats(Print& out);
+int getFlashPackEntryCount();
+const FlashPackEntry* getFlashPackEntry(int index);
+
+// from bank1_resident.cpp
+extern bool bank1ResidentEnabled;
+void beginBank1Residency();
+void serviceBank1Residency();
+bool findResidentSound(const char* name, const uint8_t** data, WavInfo* info);
+void printBank1Residency(Print& out);
 
 // from audio_playback.cpp
+extern volatile int currentDecodingStream; // Stream the MP3 callback writes to, -1 = discard
 void mp3DataCallback(MP3FrameInfo &info, int16_t *pcm_buffer, size_t len, void* ref);
-bool startStream(int streamIdx, const char* filename);
+bool startStream(int streamIdx, const char* filename, uint8_t priority = STREAM_PRIORITY_NORMAL);
 void stopStream(int streamIdx);
 void fillStreamBuffers(); // Main loop task
 void initAudioSystem();
 // NEW: Prototype for the Chirp function
 void playChirp(int startFreq, int endFreq, int durationMs, uint8_t vol);
+void runDspSelfTest(Print& out);
+void syncMixVoice(int v);
+void swapMixVoices(int a, int b);
+bool setPrebufferMs(const char* typeName, int ms);
+void writePrebufferIni(Print& out);
+void printBufferStatus(Print& out);
+void resetBufferStats();
+
+// from admission.cpp
+extern bool admissionEnabled;
+bool admitStream(int streamIdx, const char* filename, uint8_t priority);
+uint32_t admissionRejectCount();
+void noteStreamCost(int streamIdx);
+void setAdmissionBudget(int core0Pct, int sdKBps);
+bool setAdmissionFromIni(const char* args);
+void writeAdmissionIni(Print& out);
+void printAdmissionStatus(Print& out, bool listTable);
+void resetAdmissionStats();
+
+// from preroll_cache.cpp
+void initPrerollCache();
+bool requestPreroll(const char* path, bool predicted);
+bool isPrerollBusy();
+void servicePrerollCache();
+bool attachPreroll(AudioStream* s, const char* filename);
+int takePreroll(AudioStream* s, uint8_t* buf, uint32_t n);
+uint32_t skipPreroll(AudioStream* s, uint32_t bytes);
+void printPrerollStatus(Print& out, bool listSlots);
+void resetPrerollStats();
+void flushPrerollCache();
+
+// from predict.cpp
+// Sound identity for trigger history: bank/page/index (root tracks: bank 0,
+// 0-based index). The top bit is always set so 0 can mean "empty".
+#define SOUND_KEY(bank, page, index) \
+    (0x80000000u | ((uint32_t)(bank) << 24) | ((uint32_t)(uint8_t)(page) << 16) | (uint16_t)(index))
+void noteSoundTrigger(int bank, char page, int index);
+bool soundKeyPath(uint32_t key, char* path, size_t len);
+void loadPredictModel();
+void servicePredictModel();
+void clearPredictModel();
+void printPredictStatus(Print& out, bool listModel);
+void resetPredictStats();
+
+// from hot_set.cpp
+void noteHotSound(uint32_t key);
+void loadHotSet();
+void beginWarmup();
+void serviceHotSet();
+void printWarmupStatus(Print& out, bool listHot);
+
+// from mp3_pool.cpp
+void initMp3Pool();
+int acquireMp3Decoder(int streamIdx, uint8_t priority);
+void releaseMp3Decoder(int decoderIdx);
+MP3DecoderHelix* getMp3Decoder(int decoderIdx);
+void noteMp3Frame(int decoderIdx);
+void noteMp3DecodeTime(int decoderIdx, uint32_t us);
+void noteMp3Wait();
+void serviceMp3Pool();
+void setMp3DecoderOwner(int decoderIdx, int owner);
+void printMp3PoolStatus(Print& out);
+void runMp3PoolBench(Print& out, const char* path);
+
+// from stream_control.cpp
+bool pauseStream(int streamIdx);
+int resumeStream(int streamIdx);
+bool reclaimPausedStream(int streamIdx);
+int findReclaimablePausedStream();
+void clearStreamBookmark(int streamIdx);
+bool hasStreamBookmark(int streamIdx);
+void setStreamGainRamp(int streamIdx, int32_t targetQ16, uint32_t ms);
+extern uint32_t crossfadeMs;
+int crossfadeStream(int streamIdx, const char* filename, uint32_t fadeMs, uint8_t priority = STREAM_PRIORITY_NORMAL);
+void cancelCrossfade(int streamIdx);
+void serviceCrossfade();
+bool fadeStream(int streamIdx, int targetVol, uint32_t ms, Stream* notify);
+bool fadeOutStream(int streamIdx, uint32_t ms, Stream* notify);
+void serviceStreamFades();
+
+// from wav_format.cpp
+bool parseWavFile(FsFile& f, WavInfo* info);
+bool parseWavFile(File& f, WavInfo* info);
+const char* wavFormatName(uint8_t sampleFormat);
+
+// from qoa_decoder.cpp
+bool qoaOpen(AudioStream* s);
+int qoaReadFrame(FsFile& f, uint8_t* buf);
+int qoaDecodeFrame(AudioStream* s, const uint8_t* frame, int frameBytes);
 
 // from serial_commands.cpp (MP3 Trigger Compat)
 void action_togglePlayPause();
 void action_playNext();
+void action_restartTrack();
 void action_playPrev();
 void action_playTrackById(int trackNum);
 void action_playTrackByIndex(int trackIndex);
@@ -286,6 +729,78 @@ void trySendQueuedMessages(int maxMessages);
 bool isCpuBusy();
 int getQueuedMessageCount();
 
+// from scheduler.cpp
+#define TASK_PRIO_AUDIO 0        // Ring refill: runs every pass
+#define TASK_PRIO_CONTROL 1      // Serial, buttons, stream service
+#define TASK_PRIO_HOUSEKEEPING 2 // LEDs, background loads
+bool addTask(const char* name, void (*fn)(), uint8_t priority, uint32_t periodUs, uint32_t budgetUs);
+void runScheduler();
+uint32_t schedulerEpoch(); // Passes since boot, never reset
+void printTaskStats(Print& out);
+void resetTaskStats();
+bool audioRefillUrgent();
+
+// from sd_io.cpp
+enum SdIoClass {
+    SDIO_REFILL,   // Most urgent first
+    SDIO_OPEN,
+    SDIO_PREFETCH,
+    SDIO_SCAN,
+    SDIO_SYNC,
+    SDIO_CLASS_COUNT
+};
+void sdBegin(uint8_t cls);
+void sdEnd();
+void sdYield();
+int sdRead(FsFile& f, void* buf, uint32_t n, uint8_t cls);
+void printSdIoStats(Print& out);
+void resetSdIoStats();
+
+// from input_events.cpp
+enum InputGesture {
+    INPUT_PRESS,
+    INPUT_RELEASE,
+    INPUT_CLICK,
+    INPUT_DOUBLE,
+    INPUT_LONG
+};
+typedef void (*InputHandler)(uint8_t input, uint8_t gesture, uint32_t edgeUs);
+int registerInput(uint8_t pin, bool activeLow, InputHandler handler);
+void serviceInputs();
+void printInputStatus(Print& out);
+
+// from trigger_inputs.cpp
+bool addTriggerFromIni(const char* args);
+void writeTriggerIni(Print& out);
+void initTriggerInputs();
+void serviceTriggerLatency();
+void printTriggerStatus(Print& out);
+
+// from mem_tracker.cpp
+enum MemTag {
+    MEM_TAG_RINGS,    // Stream ring buffers
+    MEM_TAG_MP3,      // MP3 decoder pool
+    MEM_TAG_RESIDENT, // Bank 1 PSRAM arena + index
+    MEM_TAG_PREROLL,  // Pre-roll cache slots
+    MEM_TAG_PACK,     // Flash pack manifests and copy buffer
+    MEM_TAG_CATALOG,  // Catalog snapshots from a rescan
+    MEM_TAG_SCRATCH,  // Short-lived work buffers
+    MEM_TAG_COUNT
+};
+void* memAlloc(size_t size, uint8_t tag);      // SRAM
+void* memAllocPsram(size_t size, uint8_t tag); // PSRAM
+void memNoteExternal(uint8_t tag, bool psram, int32_t bytes); // A library's own allocation, measured
+void memFree(void* p);
+void printMemoryReport(Print& out);
+
+// from profiler.cpp
+void profilerInitCore();
+bool startProfiler(uint32_t periodUs);
+void stopProfiler();
+void printProfilerStatus(Print& out);
+void dumpProfile(Print& out);
+void serviceProfilerDump(); // Scheduler task
+
 // from blinkies.cpp
 void initBlinkies();
 void playStartupSequence();
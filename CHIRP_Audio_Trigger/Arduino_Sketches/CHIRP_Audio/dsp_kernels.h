@@ -0,0 +1,252 @@
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include <stdint.h>
+#include <string.h>
+
+// =================================================================================
+//  FIXED-POINT DSP KERNELS
+// =================================================================================
+// Hot loops shared by the decode output stage (MP3 callback, WAV refill) and
+// the mixer. On the RP2350's Cortex-M33 these use the DSP extension (packed
+// 16-bit halfword ops, single-cycle multiply-accumulate and saturate); any
+// other target gets plain C with identical results.
+//
+// Scope: these cover what happens to PCM after it is decoded. The MP3
+// decode itself (Helix's polyphase synthesis and IMDCT) is the external
+// libhelix and is not changed here, so per-frame MP3 decode time is the
+// same as before; MP3P's per-frame timing is the number to watch if that
+// library is ever vendored with an M33 path.
+//
+// Stereo frames are handled as one packed 32-bit word: L in the bottom
+// halfword, R in the top (little-endian interleaved int16 memory layout).
+//
+// The per-sample blends (wavetable oscillator) go through the SIO
+// interpolator: each core has its own INTERP0, set up once per core with
+// dsp_interp_init(). Host builds and other targets use the C blend, which
+// DSPT checks it against.
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include <arm_acle.h>
+#define DSP_HAS_M33_EXT 1
+#else
+#define DSP_HAS_M33_EXT 0
+#endif
+
+#if defined(__has_include)
+#if __has_include("hardware/interp.h")
+#include "hardware/interp.h"
+#define DSP_HAS_INTERP 1
+#endif
+#endif
+#ifndef DSP_HAS_INTERP
+#define DSP_HAS_INTERP 0
+#endif
+
+// Worst case output of one expand call: 1152 stereo samples in, or 576 mono
+// samples at 22.05 kHz (x4), both give 2304 output samples.
+#define DSP_MAX_EXPAND_OUT 2304
+
+// --- Packing ---
+static inline uint32_t dsp_pack_lr(int16_t l, int16_t r) {
+#if DSP_HAS_M33_EXT
+    return __pkhbt((uint16_t)l, r, 16);
+#else
+    return (uint16_t)l | ((uint32_t)(uint16_t)r << 16);
+#endif
+}
+
+// --- Saturate to int16 ---
+static inline int16_t dsp_sat16(int32_t v) {
+#if DSP_HAS_M33_EXT
+    return (int16_t)__ssat(v, 16);
+#else
+    if (v > 32767) return 32767;
+    if (v < -32768) return -32768;
+    return (int16_t)v;
+#endif
+}
+
+// --- Mixer accumulate: acc += sample * gain for both halves of a frame ---
+static inline void dsp_mac_frame(uint32_t lr, int32_t gain, int32_t& accL, int32_t& accR) {
+#if DSP_HAS_M33_EXT
+    accL = __smlabb((int32_t)lr, gain, accL);
+    accR = __smlatb((int32_t)lr, gain, accR);
+#else
+    accL += (int32_t)(int16_t)(lr & 0xFFFF) * (int16_t)gain;
+    accR += (int32_t)(int16_t)(lr >> 16) * (int16_t)gain;
+#endif
+}
+
+// --- Halving add of both halves: ((a + b) >> 1) per channel ---
+static inline uint32_t dsp_avg_frame(uint32_t a, uint32_t b) {
+#if DSP_HAS_M33_EXT
+    return __shadd16(a, b);
+#else
+    int16_t l = (int16_t)(((int32_t)(int16_t)(a & 0xFFFF) + (int16_t)(b & 0xFFFF)) >> 1);
+    int16_t r = (int16_t)(((int32_t)(int16_t)(a >> 16) + (int16_t)(b >> 16)) >> 1);
+    return dsp_pack_lr(l, r);
+#endif
+}
+
+// =================================================================================
+// Interpolator blend (SIO INTERP0, blend mode)
+// =================================================================================
+// Lane 0 in blend mode, lane 1 signed: PEEK1 = BASE0 + (BASE1 - BASE0) * ALPHA / 256,
+// with ALPHA the low 8 bits of lane 1's result (ACCUM1, no shift or mask).
+static inline void dsp_interp_init() {
+#if DSP_HAS_INTERP
+    interp_config cfg = interp_default_config();
+    interp_config_set_blend(&cfg, true);
+    interp_set_config(interp0, 0, &cfg);
+    cfg = interp_default_config();
+    interp_config_set_signed(&cfg, true);
+    interp_set_config(interp0, 1, &cfg);
+#endif
+}
+
+// a + (b - a) * alpha / 256, alpha 0..255
+static inline int32_t dsp_blend_c(int32_t a, int32_t b, uint32_t alpha) {
+    return a + (((b - a) * (int32_t)alpha) >> 8);
+}
+
+static inline int32_t dsp_blend(int32_t a, int32_t b, uint32_t alpha) {
+#if DSP_HAS_INTERP
+    interp0->accum[1] = alpha;
+    interp0->base[0] = a;
+    interp0->base[1] = b;
+    return (int32_t)interp0->peek[1];
+#else
+    return dsp_blend_c(a, b, alpha);
+#endif
+}
+
+// Linear-interpolated read of a 256-entry int8 wavetable at a 32-bit phase
+// (top 8 bits index, next 8 bits blend). Returns the sample scaled << 8.
+static inline int32_t dsp_wavetable_s8(const int8_t* lut, uint32_t phase) {
+    uint32_t idx = phase >> 24;
+    int32_t a = (int32_t)lut[idx] << 8;
+    int32_t b = (int32_t)lut[(idx + 1) & 0xFF] << 8;
+    return dsp_blend(a, b, (phase >> 16) & 0xFF);
+}
+
+// =================================================================================
+// Sample format conversion to int16 (WAV path)
+// =================================================================================
+// Word-at-a-time byte shuffles: four input samples become two packed output
+// words per step, with a scalar tail. Input may be unaligned. Each returns the
+// number of int16 samples written.
+
+// 8-bit unsigned -> 16-bit: flip the sign bit, byte becomes the high byte
+static inline int dsp_u8_to_s16(const uint8_t* in, int n, int16_t* out) {
+    uint32_t* o = (uint32_t*)out;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t w;
+        memcpy(&w, in + i, 4);
+        w ^= 0x80808080;
+        *o++ = ((w & 0x000000FF) << 8) | ((w & 0x0000FF00) << 16);
+        *o++ = ((w & 0x00FF0000) >> 8) | (w & 0xFF000000);
+    }
+    for (; i < n; i++) out[i] = (int16_t)((in[i] ^ 0x80) << 8);
+    return n;
+}
+
+// 24-bit packed -> 16-bit: keep the top two bytes of each sample (12 bytes -> 4 samples)
+static inline int dsp_s24_to_s16(const uint8_t* in, int n, int16_t* out) {
+    uint32_t* o = (uint32_t*)out;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t w0, w1, w2;
+        memcpy(&w0, in + i * 3, 4);
+        memcpy(&w1, in + i * 3 + 4, 4);
+        memcpy(&w2, in + i * 3 + 8, 4);
+        *o++ = ((w0 >> 8) & 0xFFFF) | (w1 << 16);
+        *o++ = (w1 >> 24) | ((w2 & 0xFF) << 8) | (w2 & 0xFFFF0000);
+    }
+    for (; i < n; i++) out[i] = (int16_t)(in[i * 3 + 1] | (in[i * 3 + 2] << 8));
+    return n;
+}
+
+// 32-bit -> 16-bit: top halfword of each sample
+static inline int dsp_s32_to_s16(const uint8_t* in, int n, int16_t* out) {
+    uint32_t* o = (uint32_t*)out;
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        uint32_t w0, w1;
+        memcpy(&w0, in + i * 4, 4);
+        memcpy(&w1, in + i * 4 + 4, 4);
+#if DSP_HAS_M33_EXT
+        *o++ = __pkhtb(w1, w0, 16);
+#else
+        *o++ = (w0 >> 16) | (w1 & 0xFFFF0000);
+#endif
+    }
+    for (; i < n; i++) out[i] = (int16_t)(in[i * 4 + 2] | (in[i * 4 + 3] << 8));
+    return n;
+}
+
+// 32-bit float (-1.0..1.0) -> 16-bit with saturation (single-precision FPU)
+static inline int dsp_f32_to_s16(const uint8_t* in, int n, int16_t* out) {
+    for (int i = 0; i < n; i++) {
+        float f;
+        memcpy(&f, in + i * 4, 4);
+        float scaled = f * 32768.0f;
+        // Clamp in float first so the int conversion can't overflow (NaN -> 0)
+        if (!(scaled > -32768.0f)) scaled = (scaled != scaled) ? 0.0f : -32768.0f;
+        if (scaled > 32767.0f) scaled = 32767.0f;
+        out[i] = (int16_t)(int32_t)scaled;
+    }
+    return n;
+}
+
+// =================================================================================
+// Expand decoded/raw PCM to the engine format (stereo interleaved, 44.1 kHz).
+// 22.05 kHz input is upsampled by linear interpolation: each input frame is
+// preceded by the midpoint from the previous one, which 'carry' holds across
+// calls (per stream; start it at 0). Returns the number of int16 samples
+// written to out (always even).
+// =================================================================================
+static inline int dsp_expand_to_stereo(const int16_t* in, int n, int channels, bool halfRate,
+                                       int16_t* out, uint32_t& carry) {
+    uint32_t* o = (uint32_t*)out;
+    int frames = 0;
+
+    if (channels == 1) {
+        if (halfRate) {
+            // Mono 22.05k -> midpoint frame, then the sample itself
+            uint32_t prev = carry;
+            for (int i = 0; i < n; i++) {
+                uint32_t f = dsp_pack_lr(in[i], in[i]);
+                o[frames++] = dsp_avg_frame(prev, f);
+                o[frames++] = f;
+                prev = f;
+            }
+            carry = prev;
+        } else {
+            for (int i = 0; i < n; i++) {
+                o[frames++] = dsp_pack_lr(in[i], in[i]);
+            }
+        }
+    } else {
+        const int pairs = n / 2; // Drop an orphan half-frame rather than swap L/R
+        if (halfRate) {
+            uint32_t prev = carry;
+            for (int i = 0; i < pairs; i++) {
+                uint32_t f;
+                memcpy(&f, &in[i * 2], 4); // Input may only be 2-byte aligned
+                o[frames++] = dsp_avg_frame(prev, f);
+                o[frames++] = f;
+                prev = f;
+            }
+            carry = prev;
+        } else {
+            for (int i = 0; i < pairs; i++) {
+                memcpy(&o[frames++], &in[i * 2], 4); // Single load/store, no library call
+            }
+        }
+    }
+    return frames * 2;
+}
+
+#endif // DSP_KERNELS_H
@@ -12,7 +12,7 @@ bool parseIniFile() {
     // Need to preserve existing settings if we rewrite
     // We already read activeBank1Page, that's the only other setting currently.
 
-    mutex_enter_blocking(&sd_mutex);
+    sdBegin(SDIO_SCAN);
     FsFile iniFile = sd.open("CHIRP.INI", FILE_READ);
     
     if (iniFile) {
@@ -49,6 +49,30 @@ bool parseIniFile() {
                         }
                     }
                 }
+                // Bank 1 PSRAM residency
+                else if (strncasecmp(command, "BANK1_RESIDENT", 14) == 0) {
+                    char* value = strchr(command, ' ');
+                    if (value) {
+                        while (*(++value) == ' '); // Find first char of value
+                        bank1ResidentEnabled = (strncasecmp(value, "ON", 2) == 0);
+                    }
+                }
+                // Mixer start threshold per source type
+                else if (strncasecmp(command, "PREBUFFER", 9) == 0) {
+                    char typeName[8];
+                    int ms;
+                    if (sscanf(command + 9, "%7s %d", typeName, &ms) == 2) {
+                        setPrebufferMs(typeName, ms);
+                    }
+                }
+                // Admission control budget
+                else if (strncasecmp(command, "ADMIT", 5) == 0) {
+                    setAdmissionFromIni(command + 5);
+                }
+                // Trigger pin -> sound mapping
+                else if (strncasecmp(command, "TRIGGER", 7) == 0) {
+                    addTriggerFromIni(command + 7);
+                }
                 // Check VERSION
                 else if (strncasecmp(command, "VERSION", 7) == 0) {
                     char* value = strchr(command, ' ');
@@ -82,6 +106,19 @@ bool parseIniFile() {
             iniFile.println("# This selects which '1X_...' directory to sync to flash.");
             iniFile.printf("#BANK1_PAGE %c\n", activeBank1Page); 
             iniFile.println();
+            iniFile.println("# Keep Bank 1 in PSRAM for zero-I/O playback (ON/OFF)");
+            iniFile.printf("#BANK1_RESIDENT %s\n", bank1ResidentEnabled ? "ON" : "OFF");
+            iniFile.println();
+            iniFile.println("# Audio buffered (ms) before a stream starts, per source type");
+            writePrebufferIni(iniFile);
+            iniFile.println();
+            iniFile.println("# Admission control: <ON|OFF> <Core 0 budget %> <SD budget KB/s>");
+            writeAdmissionIni(iniFile);
+            iniFile.println();
+            iniFile.println("# Trigger pins: #TRIGGER <pin> <index>,<bank>,<page>[,<volume>] <EDGE|RETRIG|LEVEL>");
+            iniFile.println("# e.g. #TRIGGER 2 5,1,A EDGE  (pin 2 to GND plays Bank 1 sound 5)");
+            writeTriggerIni(iniFile);
+            iniFile.println();
             iniFile.println("# Firmware Version (Last Booted)");
             iniFile.println("# Do not edit this manually unless you want to force voice feedback.");
             iniFile.printf("#VERSION %s\n", VERSION_STRING);
@@ -93,7 +130,7 @@ bool parseIniFile() {
             Serial.println("ERROR: Could not create/update CHIRP.INI!");
         }
     }
-    mutex_exit(&sd_mutex);
+    sdEnd();
     
     return versionMismatch;
 }
@@ -102,35 +139,37 @@ bool parseIniFile() {
 // ===================================
 // Scan Bank 1 (Finds dir matching activeBank1Page)
 // ===================================
-void scanBank1() {
-    bank1SoundCount = 0;
-    bank1DirName[0] = '\0'; // Clear the name
+void scanBank1(Catalog* c) {
+    c->bank1SoundCount = 0;
+    c->bank1DirName[0] = '\0'; // Clear the name
     
     char targetPrefix[4]; // "1A_"
     snprintf(targetPrefix, sizeof(targetPrefix), "1%c_", activeBank1Page);
     
-    mutex_enter_blocking(&sd_mutex);
+    sdBegin(SDIO_SCAN);
     FsFile root = sd.open("/");
     
     if (!root || !root.isDirectory()) {
         Serial.println("ERROR: Could not open root directory");
-        mutex_exit(&sd_mutex);
+        sdEnd();
         return;
     }
 
     FsFile bankDir;
     // Loop 1: Find the *specific* Bank 1 Directory
     while (bankDir.openNext(&root, O_RDONLY)) {
+        sdYield(); // Scans can take a while on a big card; let a low ring refill
         char dirName[64];
         bankDir.getName(dirName, sizeof(dirName));
         
         if (bankDir.isDirectory() && strncmp(dirName, targetPrefix, 3) == 0) {
-            strncpy(bank1DirName, dirName, sizeof(bank1DirName) - 1);
-            Serial.printf("Found Active Bank 1 Directory: %s\n", bank1DirName);
+            strncpy(c->bank1DirName, dirName, sizeof(c->bank1DirName) - 1);
+            Serial.printf("Found Active Bank 1 Directory: %s\n", c->bank1DirName);
             
             // Now, scan files inside this directory
             FsFile file;
             while (file.openNext(&bankDir, O_RDONLY)) {
+                sdYield();
                 char filename[64];
                 file.getName(filename, sizeof(filename));
                 if (!file.isDirectory()) {
@@ -145,28 +184,29 @@ void scanBank1() {
                             basename[baseLen] = '\0';
                             
                             int soundIdx = -1;
-                            for (int i = 0; i < bank1SoundCount; i++) {
-                                if (strcasecmp(bank1Sounds[i].basename, basename) == 0) {
+                            for (int i = 0; i < c->bank1SoundCount; i++) {
+                                if (strcasecmp(c->bank1Sounds[i].basename, basename) == 0) {
                                     soundIdx = i;
                                     break;
                                 }
                             }
                             
                             if (soundIdx == -1) {
-                                if (bank1SoundCount < MAX_SOUNDS) {
-                                     soundIdx = bank1SoundCount++;
-                                     strncpy(bank1Sounds[soundIdx].basename, basename, sizeof(bank1Sounds[soundIdx].basename) - 1);
-                                    bank1Sounds[soundIdx].variantCount = 0;
-                                    bank1Sounds[soundIdx].lastVariantPlayed = -1; // Init non-repeat
+                                if (c->bank1SoundCount < MAX_SOUNDS) {
+                                     soundIdx = c->bank1SoundCount++;
+                                     strncpy(c->bank1Sounds[soundIdx].basename, basename, sizeof(c->bank1Sounds[soundIdx].basename) - 1);
+                                    c->bank1Sounds[soundIdx].variantCount = 0;
                                 }
                             }
                             
-                            if (soundIdx != -1 && bank1Sounds[soundIdx].variantCount < 25) {
+                            if (soundIdx != -1 && c->bank1Sounds[soundIdx].variantCount < 25) {
                                 
-                                 strncpy(bank1Sounds[soundIdx].variants[bank1Sounds[soundIdx].variantCount],
+                                 strncpy(c->bank1Sounds[soundIdx].variants[c->bank1Sounds[soundIdx].variantCount],
                                        filename,
-                                       sizeof(bank1Sounds[soundIdx].variants[0]) - 1);
-                                 bank1Sounds[soundIdx].variantCount++;
+                                       sizeof(c->bank1Sounds[soundIdx].variants[0]) - 1);
+                                 c->bank1Sounds[soundIdx].variantSizes[c->bank1Sounds[soundIdx].variantCount] = file.fileSize();
+                                 c->bank1Sounds[soundIdx].variantStamps[c->bank1Sounds[soundIdx].variantCount] = sdFileStamp(file);
+                                 c->bank1Sounds[soundIdx].variantCount++;
                             }
                         }
                         else {
@@ -174,12 +214,13 @@ void scanBank1() {
                             strncpy(basename, filename, sizeof(basename) - 1);
                             char* dot = strrchr(basename, '.');
                             if (dot) *dot = '\0';
-                            if (bank1SoundCount < MAX_SOUNDS) {
-                                int soundIdx = bank1SoundCount++;
-                                strncpy(bank1Sounds[soundIdx].basename, basename, sizeof(bank1Sounds[soundIdx].basename) - 1);
-                                strncpy(bank1Sounds[soundIdx].variants[0], filename, sizeof(bank1Sounds[soundIdx].variants[0]) - 1);
-                                bank1Sounds[soundIdx].variantCount = 1;
-                                bank1Sounds[soundIdx].lastVariantPlayed = -1; // Init non-repeat
+                            if (c->bank1SoundCount < MAX_SOUNDS) {
+                                int soundIdx = c->bank1SoundCount++;
+                                strncpy(c->bank1Sounds[soundIdx].basename, basename, sizeof(c->bank1Sounds[soundIdx].basename) - 1);
+                                strncpy(c->bank1Sounds[soundIdx].variants[0], filename, sizeof(c->bank1Sounds[soundIdx].variants[0]) - 1);
+                                c->bank1Sounds[soundIdx].variantSizes[0] = file.fileSize();
+                                c->bank1Sounds[soundIdx].variantStamps[0] = sdFileStamp(file);
+                                c->bank1Sounds[soundIdx].variantCount = 1;
                             }
                         }
                     }
@@ -194,9 +235,9 @@ void scanBank1() {
     } // end root loop
     
     root.close();
-    mutex_exit(&sd_mutex);
+    sdEnd();
 
-    if (bank1DirName[0] == '\0') {
+    if (c->bank1DirName[0] == '\0') {
         Serial.printf("WARNING: No Bank 1 directory matching '%s...' found on SD card.\n", targetPrefix);
     }
 }
@@ -215,9 +256,9 @@ void playVoiceFeedback(const char* filename) {
     
     // Check if file exists first
     bool exists = false;
-    mutex_enter_blocking(&sd_mutex);
+    sdBegin(SDIO_SCAN);
     if (sd.exists(fullPath)) exists = true;
-    mutex_exit(&sd_mutex);
+    sdEnd();
     
     if (!exists) return; // Silent fail if file missing (user preference)
 
@@ -274,74 +315,34 @@ void playVoiceNumber(int number) {
 // Sync Bank 1 to Flash
 // ===================================
 bool syncBank1ToFlash(bool fwUpdated) {
-    if (bank1DirName[0] == '\0') {
+    const Catalog* c = catalog();
+    if (c->bank1DirName[0] == '\0') {
         Serial.println("  Skipping sync: No active Bank 1 directory found.");
         return false;
     }
     
     // Check for Voice Feedback Directory
     bool hasVoiceFeedback = false;
-    mutex_enter_blocking(&sd_mutex);
+    sdBegin(SDIO_SCAN);
     if (sd.exists("/0_System")) {
         hasVoiceFeedback = true;
     }
-    mutex_exit(&sd_mutex);
+    sdEnd();
 
     if (hasVoiceFeedback) {
         Serial.println("  Voice Feedback: Enabled");
     }
     
-    if (!LittleFS.exists("/flash")) {
-        LittleFS.mkdir("/flash");
-    }
-
-    // --- Pruning stale files from flash ---
-    Serial.println("  Pruning stale files from flash...");
-    int filesDeleted = 0;
-    Dir dir = LittleFS.openDir("/flash");
-    while (dir.next()) {
-        if (!dir.isDirectory()) {
-            char flashFilename[64];
-            strncpy(flashFilename, dir.fileName().c_str(), sizeof(flashFilename) - 1);
-            
-            bool foundInMasterList = false;
-            // Check if this file exists in the new SD bank (master list)
-            for (int i = 0; i < bank1SoundCount; i++) {
-                for (int v = 0; v < bank1Sounds[i].variantCount; v++) {
-                    if (strcmp(flashFilename, bank1Sounds[i].variants[v]) == 0) {
-                        foundInMasterList = true;
-                        break;
-                    }
-                }
-                if (foundInMasterList) break;
-            }
-            
-            // If the file was NOT found in the master list, delete it.
-            if (!foundInMasterList) {
-                char fullFlashPath[80];
-                snprintf(fullFlashPath, sizeof(fullFlashPath), "/flash/%s", flashFilename);
-                if (LittleFS.remove(fullFlashPath)) {
-                    Serial.printf("    - Deleted stale file: %s\n", flashFilename);
-                    filesDeleted++;
-                } else {
-                    Serial.printf("    - ERROR deleting: %s\n", flashFilename);
-                }
-            }
-        }
-    }
-    if (filesDeleted == 0) {
-        Serial.println("    - No stale files found.");
-    }
-    // --- End of Pruning Feature ---
-
+    // Pick up whichever A/B slot holds the newest committed pack
+    loadFlashPack();
     
     int totalFiles = 0;
-    for (int i = 0; i < bank1SoundCount; i++) {
-        totalFiles += bank1Sounds[i].variantCount;
+    for (int i = 0; i < c->bank1SoundCount; i++) {
+        totalFiles += c->bank1Sounds[i].variantCount;
     }
     
     int syncLimit = DEV_MODE ? min(totalFiles, DEV_SYNC_LIMIT) : totalFiles;
-    Serial.printf("  Syncing %d files from %s", syncLimit, bank1DirName);
+    Serial.printf("  Syncing %d files from %s", syncLimit, c->bank1DirName);
     if (DEV_MODE && totalFiles > syncLimit) {
         Serial.printf(" (DEV MODE: limited to first %d)", DEV_SYNC_LIMIT);
     }
@@ -382,46 +383,17 @@ bool syncBank1ToFlash(bool fwUpdated) {
         }
     }
 
-    // --- Count Actual Files to Sync ---
-    int filesToSync = 0;
-    int preCheckProcessed = 0;
-    
-    // We pre-calculate to provide accurate "Syncing X files" voice prompt.
-    // This allows us to say "Syncing 5 files" when 95 are already synced.
-    
-    for (int i = 0; i < bank1SoundCount; i++) {
-        for (int v = 0; v < bank1Sounds[i].variantCount; v++) {
-            preCheckProcessed++;
-            if (DEV_MODE && preCheckProcessed > DEV_SYNC_LIMIT) break;
-
-            const char* filename = bank1Sounds[i].variants[v];
-            char sdPath[64];
-            char flashPath[64];
-            snprintf(sdPath, sizeof(sdPath), "/%s/%s", bank1DirName, filename);
-            snprintf(flashPath, sizeof(flashPath), "/flash/%s", filename);
-
-            bool needsCopy = true;
-            mutex_enter_blocking(&sd_mutex);
-            FsFile sdFile = sd.open(sdPath, FILE_READ);
-            if (sdFile) {
-                size_t sdSize = sdFile.size();
-                if (LittleFS.exists(flashPath)) {
-                    File flashFile = LittleFS.open(flashPath, "r");
-                    if (flashFile) {
-                        size_t flashSize = flashFile.size();
-                        if (flashSize == sdSize) {
-                            needsCopy = false; 
-                        }
-                        flashFile.close();
-                    }
-                }
-                sdFile.close();
-            }
-            mutex_exit(&sd_mutex);
-
-            if (needsCopy) filesToSync++;
+    // --- Diff SD against the committed pack ---
+    // The manifest diff replaces the old pre-count pass: sizes were recorded
+    // during scanBank1(), so no files need to be opened to know what changed.
+    int filesToSync = planFlashPackSync(syncLimit);
+    if (filesToSync < 0) {
+        if (hasVoiceFeedback) {
+            Serial.println("  System in sync. Silent startup.");
+        } else {
+            Serial.println("  Flash pack in sync.");
         }
-        if (DEV_MODE && preCheckProcessed > DEV_SYNC_LIMIT) break;
+        return true;
     }
     
     // --- Voice Feedback: Start ---
@@ -453,133 +425,53 @@ bool syncBank1ToFlash(bool fwUpdated) {
         // "Files"
         playVoiceFeedback("files.wav");
         delay(200);
-    } else if (hasVoiceFeedback) {
-        Serial.println("  System in sync. Silent startup.");
     }
     
-    int filesCopied = 0;
-    int filesSkipped = 0;
+    // --- Write the new pack into the inactive slot ---
+    if (!beginFlashPackSync()) {
+        Serial.println("  ERROR: Could not start flash pack sync");
+        return false;
+    }
+    
     int filesProcessed = 0;
     int filesSyncedSoFar = 0;
-
-    for (int i = 0; i < bank1SoundCount; i++) {
-        for (int v = 0; v < bank1Sounds[i].variantCount; v++) {
+    PackSyncResult result;
+    
+    do {
+        result = stepFlashPackSync();
+        
+        // Heartbeat for scanning/copying
+        updateSyncLEDs(false);
+        
+        if (result == PACK_SYNC_FILE_STARTED) {
             filesProcessed++;
-            if (DEV_MODE && filesProcessed > DEV_SYNC_LIMIT) {
-                goto sync_complete;
-            }
-            
-            const char* filename = bank1Sounds[i].variants[v];
-            Serial.printf("  [%d/%d] ", filesProcessed, syncLimit);
+            Serial.printf("  [%d/%d] %s... ", filesProcessed, syncLimit, getFlashPackSyncFile());
+        } else if (result == PACK_SYNC_FILE_REUSED) {
+            Serial.println("Kept");
+        } else if (result == PACK_SYNC_FILE_COPIED) {
+            Serial.println("Copied OK");
+            filesSyncedSoFar++;
             
-            char sdPath[64];
-            char flashPath[64];
-            snprintf(sdPath, sizeof(sdPath), "/%s/%s", bank1DirName, filename);
-            snprintf(flashPath, sizeof(flashPath), "/flash/%s", filename);
+            // Sync File Transition Feedback
+            updateSyncLEDs(true);
             
-            // Heartbeat for scanning
-            updateSyncLEDs(false);
-
-            bool needsCopy = true;
-            bool justCopied = false;
-            mutex_enter_blocking(&sd_mutex);
-            FsFile sdFile = sd.open(sdPath, FILE_READ);
-            if (sdFile) {
-                size_t sdSize = sdFile.size();
-                if (LittleFS.exists(flashPath)) {
-                    File flashFile = LittleFS.open(flashPath, "r");
-                    if (flashFile) {
-                        size_t flashSize = flashFile.size();
-                        if (flashSize == sdSize) {
-                            needsCopy = false;
-                            filesSkipped++;
-                            Serial.printf("Skipped: %s\n", filename);
-                        }
-                        
-                        flashFile.close();
-                    }
-                }
-                
-                if (needsCopy) {
-                    // Sync File Transition Feedback
-                    updateSyncLEDs(true);
-                    
-                    sdFile.rewind();
-                    File flashFile = LittleFS.open(flashPath, "w");
-                    if (flashFile) {
-                        const uint16_t CHUNK_SIZE = 512;
-                        uint8_t buffer[CHUNK_SIZE];
-                        uint32_t remaining = sdSize;
-                        bool copySuccess = true;
-                        Serial.printf("Copying: %s (%lu KB)... ", 
-                                     filename, sdSize / 1024);
-                        while (remaining > 0 && copySuccess) {
-                            uint16_t toRead = (remaining > CHUNK_SIZE) ?
-                                              CHUNK_SIZE : remaining;
-                            
-                            int bytesRead = sdFile.read(buffer, toRead);
-                            
-                            // Heartbeat during copy
-                            updateSyncLEDs(false);
-
-                            if (bytesRead <= 0) {
-                                Serial.println(" READ ERROR!");
-                                copySuccess = false;
-                                break;
-                            }
-                            
-                            int bytesWritten = flashFile.write(buffer, bytesRead);
-                            if (bytesWritten != bytesRead) {
-                                Serial.println(" WRITE ERROR!");
-                                copySuccess = false;
-                                break;
-                            }
-                            
-                            remaining -= bytesRead;
-                        }
-                        
-                        flashFile.close();
-                        if (copySuccess) {
-                            Serial.println("OK");
-                            filesCopied++;
-                            filesSyncedSoFar++;
-                            justCopied = true;
-                            
-                            // Success Feedback moved outside mutex to avoid deadlock
-                        }
-                    } else {
-                        Serial.println(" FAILED to create flash file!");
-                    }
-                }
-                
-                sdFile.close();
+            if (hasVoiceFeedback) {
+                playVoiceNumber(filesSyncedSoFar);
             } else {
-                Serial.printf("ERROR: Could not open %s\n", sdPath);
-            }
-            
-            mutex_exit(&sd_mutex);
-
-            if (justCopied) {
-                if (hasVoiceFeedback) {
-                    playVoiceNumber(filesSyncedSoFar);
-                } else {
-                    // Original Beeper Feedback
-                    g_allowAudio = true; 
-                    delay(5); // Wait for I2S to start
-                    playChirp(2000, 500, 60, 50); // fast chirp
-                    delay(60);
-                    playChirp(2000, 4000, 50, 50); // fast chirp
-                    delay(60); // Wait for chirp (blocking Core 0 is fine here)
-                    g_allowAudio = false; // Mute again
-                    delay(5);
-                }
+                // Original Beeper Feedback
+                g_allowAudio = true; 
+                delay(5); // Wait for I2S to start
+                playChirp(2000, 500, 60, 50); // fast chirp
+                delay(60);
+                playChirp(2000, 4000, 50, 50); // fast chirp
+                delay(60); // Wait for chirp (blocking Core 0 is fine here)
+                g_allowAudio = false; // Mute again
+                delay(5);
             }
         }
-    }
-    
-sync_complete:
+    } while (result != PACK_SYNC_DONE && result != PACK_SYNC_FAILED);
     
-    if (hasVoiceFeedback && filesToSync > 0) {
+    if (hasVoiceFeedback && filesToSync > 0 && result == PACK_SYNC_DONE) {
         delay(200);
         // "Transfer"
         playVoiceFeedback("transfer.wav");
@@ -592,28 +484,34 @@ sync_complete:
         playVoiceFeedback("ready.wav");
     }
 
-    Serial.printf("\n  Summary: %d copied, %d skipped, %d pruned\n", 
-                  filesCopied, filesSkipped, filesDeleted);
-    return true;
+    int filesCopied = 0;
+    int filesReused = 0;
+    getFlashPackSyncCounts(&filesCopied, &filesReused);
+    Serial.printf("\n  Summary: %d copied from SD, %d kept from previous pack%s\n", 
+                  filesCopied, filesReused,
+                  result == PACK_SYNC_DONE ? "" : " (FAILED - previous pack still active)");
+    printFlashPackSyncStats(Serial);
+    return result == PACK_SYNC_DONE;
 }
 
 
 // ===================================
 // Scan SD Banks (2-6 with optional pages)
 // ===================================
-void scanSDBanks() {
-    sdBankCount = 0;
-    mutex_enter_blocking(&sd_mutex);
+void scanSDBanks(Catalog* c) {
+    c->sdBankCount = 0;
+    sdBegin(SDIO_SCAN);
     FsFile root = sd.open("/");
     
     if (!root || !root.isDirectory()) {
         Serial.println("ERROR: Could not open root directory");
-        mutex_exit(&sd_mutex);
+        sdEnd();
         return;
     }
     
     FsFile dir;
     while (dir.openNext(&root, O_RDONLY)) {
+        sdYield();
         if (dir.isDirectory()) {
             char dirName[64];
             dir.getName(dirName, sizeof(dirName));
@@ -638,8 +536,8 @@ void scanSDBanks() {
                 }
                 
                 // Create new bank entry
-                if (sdBankCount < MAX_SD_BANKS) {
-                    SDBank* bank = &sdBanks[sdBankCount];
+                if (c->sdBankCount < MAX_SD_BANKS) {
+                    SDBank* bank = &c->sdBanks[c->sdBankCount];
                     bank->bankNum = bankNum;
                     bank->page = page;
                     strncpy(bank->dirName, dirName, sizeof(bank->dirName) - 1);
@@ -653,6 +551,7 @@ void scanSDBanks() {
                     if (bankDir && bankDir.isDirectory()) {
                         FsFile file;
                         while (file.openNext(&bankDir, O_RDONLY)) {
+                            sdYield();
                             if (!file.isDirectory() && bank->fileCount < MAX_FILES_PER_BANK) {
                                 char filename[64];
                                 file.getName(filename, sizeof(filename));
@@ -660,6 +559,7 @@ void scanSDBanks() {
                                 const char* ext = strrchr(filename, '.');
                                 if (ext && (strcasecmp(ext, ".wav") == 0 ||
                                            strcasecmp(ext, ".mp3") == 0 ||
+                                           strcasecmp(ext, ".qoa") == 0 ||
                                            strcasecmp(ext, ".aac") == 0 ||
                                            strcasecmp(ext, ".m4a") == 0)) {
                                     strncpy(bank->files[bank->fileCount], filename,
@@ -672,7 +572,7 @@ void scanSDBanks() {
                         bankDir.close();
                     }
                     
-                    sdBankCount++;
+                    c->sdBankCount++;
                 }
             }
         }
@@ -680,17 +580,17 @@ void scanSDBanks() {
     }
     
     root.close();
-    mutex_exit(&sd_mutex);
+    sdEnd();
 }
 
 
 // ===================================
 // Find SD Bank by number and page
 // ===================================
-SDBank* findSDBank(uint8_t bank, char page) {
-    for (int i = 0; i < sdBankCount; i++) {
-        if (sdBanks[i].bankNum == bank && sdBanks[i].page == page) {
-            return &sdBanks[i];
+const SDBank* findSDBank(const Catalog* c, uint8_t bank, char page) {
+    for (int i = 0; i < c->sdBankCount; i++) {
+        if (c->sdBanks[i].bankNum == bank && c->sdBanks[i].page == page) {
+            return &c->sdBanks[i];
         }
     }
     return nullptr;
@@ -700,8 +600,8 @@ SDBank* findSDBank(uint8_t bank, char page) {
 // ===================================
 // Get File from SD Bank
 // ===================================
-const char* getSDFile(uint8_t bank, char page, int index) {
-    SDBank* sdBank = findSDBank(bank, page);
+const char* getSDFile(const Catalog* c, uint8_t bank, char page, int index) {
+    const SDBank* sdBank = findSDBank(c, bank, page);
     if (!sdBank) return nullptr;
     
     if (index < 1 || index > sdBank->fileCount) return nullptr;
@@ -713,19 +613,20 @@ const char* getSDFile(uint8_t bank, char page, int index) {
 // ===================================
 // Scan Root Tracks (Legacy Compatibility)
 // ===================================
-void scanRootTracks() {
-    rootTrackCount = 0;
-    mutex_enter_blocking(&sd_mutex);
+void scanRootTracks(Catalog* c) {
+    c->rootTrackCount = 0;
+    sdBegin(SDIO_SCAN);
     FsFile root = sd.open("/");
     
     if (!root || !root.isDirectory()) {
         Serial.println("ERROR: Could not open root directory for legacy scan");
-        mutex_exit(&sd_mutex);
+        sdEnd();
         return;
     }
     
     FsFile file;
     while (file.openNext(&root, O_RDONLY)) {
+        sdYield();
         if (!file.isDirectory()) {
             char filename[64];
             file.getName(filename, sizeof(filename));
@@ -734,32 +635,33 @@ void scanRootTracks() {
             const char* ext = strrchr(filename, '.');
             if (ext && (strcasecmp(ext, ".wav") == 0 ||
                        strcasecmp(ext, ".mp3") == 0 ||
+                       strcasecmp(ext, ".qoa") == 0 ||
                        strcasecmp(ext, ".aac") == 0 ||
                        strcasecmp(ext, ".m4a") == 0)) {
                 
-                if (rootTrackCount < MAX_ROOT_TRACKS) {
-                    strncpy(rootTracks[rootTrackCount], filename, sizeof(rootTracks[0]) - 1);
-                    rootTrackCount++;
+                if (c->rootTrackCount < MAX_ROOT_TRACKS) {
+                    strncpy(c->rootTracks[c->rootTrackCount], filename, sizeof(c->rootTracks[0]) - 1);
+                    c->rootTrackCount++;
                 }
             }
         }
         file.close();
     }
     root.close();
-    mutex_exit(&sd_mutex);
+    sdEnd();
     
     // Sort the tracks alphabetically to ensure deterministic order
     // (Bubble sort is fine for < 255 items)
-    for (int i = 0; i < rootTrackCount - 1; i++) {
-        for (int j = 0; j < rootTrackCount - i - 1; j++) {
-            if (strcasecmp(rootTracks[j], rootTracks[j+1]) > 0) {
+    for (int i = 0; i < c->rootTrackCount - 1; i++) {
+        for (int j = 0; j < c->rootTrackCount - i - 1; j++) {
+            if (strcasecmp(c->rootTracks[j], c->rootTracks[j+1]) > 0) {
                 char temp[16];
-                strncpy(temp, rootTracks[j], sizeof(temp));
-                strncpy(rootTracks[j], rootTracks[j+1], sizeof(rootTracks[j]));
-                strncpy(rootTracks[j+1], temp, sizeof(temp));
+                strncpy(temp, c->rootTracks[j], sizeof(temp));
+                strncpy(c->rootTracks[j], c->rootTracks[j+1], sizeof(c->rootTracks[j]));
+                strncpy(c->rootTracks[j+1], temp, sizeof(temp));
             }
         }
     }
     
-    Serial.printf("Found %d root tracks for legacy compatibility.\n", rootTrackCount);
+    Serial.printf("Found %d root tracks for legacy compatibility.\n", c->rootTrackCount);
 }
\ No newline at end of file
@@ -0,0 +1,605 @@
+#include "config.h"
+#include <CRC32.h>
+
+// =================================================================================
+//  FLASH SOUND PACK (A/B SLOTS)
+// =================================================================================
+// Bank 1 lives on LittleFS as a "sound pack" in one of two slots:
+//
+//   /flash/0/...   Slot 0 audio files
+//   /flash/1/...   Slot 1 audio files
+//   /flash/man.N   Manifest for slot N (name, size, CRC32, SD modify time per file)
+//   /flash/hdr.N   Commit header for slot N (generation, manifest CRC)
+//
+// A new pack is always written into the slot that is NOT active. Every file is
+// CRC-checked by reading it back, then the manifest is written, and only then
+// is the slot's header written with generation+1. That single header write is
+// the commit: on boot the valid header with the highest generation wins, so a
+// power cut at any point leaves either the old pack or the new one - never a
+// half-written set that looks complete.
+
+#define PACK_MAGIC       0x33504843 // "CHP3": manifest entries carry the SD modify time
+
+// Copy staging block. Files are read from SD in one large request into a
+// PSRAM block and handed to LittleFS in a single write, so flash sees whole
+// erase blocks being programmed instead of a stream of 512-byte writes (each
+// of which could trigger its own cache flush and metadata update).
+// Must be a multiple of the 4 KB flash erase block.
+#define PACK_COPY_BLOCK  (64 * 1024)
+#define PACK_FALLBACK_CHUNK 4096 // SRAM buffer if PSRAM allocation fails
+
+// Typical rated program/erase endurance of the QSPI NOR flash
+#define FLASH_RATED_CYCLES 100000UL
+
+struct FlashPackHeader {
+    uint32_t magic;
+    uint32_t generation;
+    uint32_t entryCount;
+    uint32_t totalBytes;
+    uint32_t manifestCrc;
+    char dirName[64];     // Bank 1 SD directory the pack was built from
+    uint32_t wearBlocks;  // Lifetime erase blocks programmed by pack syncs
+    uint32_t headerCrc;   // CRC32 of everything above
+};
+
+// Currently committed pack
+static FlashPackHeader activeHeader;
+static FlashPackEntry* activeEntries = nullptr;
+static int activeSlot = -1; // -1 = no valid pack
+
+// Carried across a dropped pack so the wear estimate survives a rebuild
+static uint32_t lifetimeWearBlocks = 0;
+
+// In-progress sync job
+enum PackJobPhase {
+    JOB_IDLE = 0,
+    JOB_OPEN_FILE,
+    JOB_COPY,
+    JOB_VERIFY,
+    JOB_COMMIT
+};
+
+struct PackSyncJob {
+    PackJobPhase phase;
+    int targetSlot;
+    FlashPackEntry* entries; // New manifest (PSRAM)
+    bool* fromSD;            // true = copy from SD, false = reuse from active slot
+    int entryCount;
+    int current;
+    uint32_t remaining;
+    CRC32 crc;
+    FsFile sdSrc;
+    File flashSrc;
+    File dst;
+    int copiedFromSD;
+    int reusedFromFlash;
+
+    // Copy staging
+    uint8_t* block;
+    uint32_t blockSize;
+    FlashSyncStats stats;
+    uint32_t startMs;
+};
+
+static PackSyncJob job;
+
+// ===================================
+// Path Helpers
+// ===================================
+static void slotDir(int slot, char* out, size_t len) {
+    snprintf(out, len, "/flash/%d", slot);
+}
+
+static void slotFilePath(int slot, const char* name, char* out, size_t len) {
+    snprintf(out, len, "/flash/%d/%s", slot, name);
+}
+
+static void headerPath(int slot, char* out, size_t len) {
+    snprintf(out, len, "/flash/hdr.%d", slot);
+}
+
+static void manifestPath(int slot, char* out, size_t len) {
+    snprintf(out, len, "/flash/man.%d", slot);
+}
+
+const char* getBank1FlashDir() {
+    static char dir[16];
+    slotDir(activeSlot < 0 ? 0 : activeSlot, dir, sizeof(dir));
+    return dir;
+}
+
+static uint32_t headerCrc(const FlashPackHeader& h) {
+    return CRC32::calculate((const uint8_t*)&h, offsetof(FlashPackHeader, headerCrc));
+}
+
+// Remove every file in a slot directory (and its header/manifest)
+static void clearSlot(int slot) {
+    char path[80];
+    headerPath(slot, path, sizeof(path));
+    LittleFS.remove(path); // Header first: slot is invalid from here on
+    manifestPath(slot, path, sizeof(path));
+    LittleFS.remove(path);
+
+    char dirPath[16];
+    slotDir(slot, dirPath, sizeof(dirPath));
+    Dir dir = LittleFS.openDir(dirPath);
+    while (dir.next()) {
+        if (!dir.isDirectory()) {
+            slotFilePath(slot, dir.fileName().c_str(), path, sizeof(path));
+            LittleFS.remove(path);
+        }
+    }
+}
+
+// ===================================
+// Load & Validate a Slot
+// ===================================
+static bool readSlot(int slot, FlashPackHeader& h, FlashPackEntry** entriesOut) {
+    char path[80];
+    headerPath(slot, path, sizeof(path));
+    File f = LittleFS.open(path, "r");
+    if (!f) return false;
+    bool ok = (f.read((uint8_t*)&h, sizeof(h)) == sizeof(h));
+    f.close();
+    if (!ok || h.magic != PACK_MAGIC || h.headerCrc != headerCrc(h)) return false;
+    if (h.entryCount > MAX_SOUNDS * 25) return false;
+
+    FlashPackEntry* entries = nullptr;
+    if (h.entryCount > 0) {
+        entries = (FlashPackEntry*)memAllocPsram(h.entryCount * sizeof(FlashPackEntry), MEM_TAG_PACK);
+        if (!entries) return false;
+
+        manifestPath(slot, path, sizeof(path));
+        f = LittleFS.open(path, "r");
+        size_t want = h.entryCount * sizeof(FlashPackEntry);
+        ok = f && (f.read((uint8_t*)entries, want) == (int)want);
+        if (f) f.close();
+        if (!ok || CRC32::calculate((const uint8_t*)entries, want) != h.manifestCrc) {
+            memFree(entries);
+            return false;
+        }
+
+        // Cheap content check: every file present with the committed size.
+        // (Full CRCs were verified at write time; re-reading 14MB every boot is too slow.)
+        for (uint32_t i = 0; i < h.entryCount && ok; i++) {
+            slotFilePath(slot, entries[i].name, path, sizeof(path));
+            File af = LittleFS.open(path, "r");
+            if (!af || af.size() != entries[i].size) ok = false;
+            if (af) af.close();
+        }
+        if (!ok) {
+            memFree(entries);
+            return false;
+        }
+    }
+
+    *entriesOut = entries;
+    return true;
+}
+
+bool loadFlashPack() {
+    if (!LittleFS.exists("/flash")) {
+        LittleFS.mkdir("/flash");
+    }
+
+    if (activeEntries) {
+        memFree(activeEntries);
+        activeEntries = nullptr;
+    }
+    activeSlot = -1;
+
+    for (int slot = 0; slot < FLASH_PACK_SLOTS; slot++) {
+        FlashPackHeader h;
+        FlashPackEntry* entries = nullptr;
+        if (!readSlot(slot, h, &entries)) continue;
+
+        if (h.wearBlocks > lifetimeWearBlocks) lifetimeWearBlocks = h.wearBlocks;
+        if (activeSlot < 0 || h.generation > activeHeader.generation) {
+            if (activeEntries) memFree(activeEntries);
+            activeHeader = h;
+            activeEntries = entries;
+            activeSlot = slot;
+        } else if (entries) {
+            memFree(entries);
+        }
+    }
+
+    if (activeSlot >= 0) {
+        Serial.printf("  Flash pack: slot %d, gen %lu, %lu files (%lu KB) from %s\n",
+                      activeSlot, activeHeader.generation, activeHeader.entryCount,
+                      activeHeader.totalBytes / 1024, activeHeader.dirName);
+    } else {
+        Serial.println("  Flash pack: no valid pack committed");
+    }
+    return activeSlot >= 0;
+}
+
+// ===================================
+// Clear All Packs (CCRC)
+// ===================================
+int clearFlashPacks() {
+    int count = 0;
+    for (int slot = 0; slot < FLASH_PACK_SLOTS; slot++) {
+        char dirPath[16];
+        slotDir(slot, dirPath, sizeof(dirPath));
+        Dir dir = LittleFS.openDir(dirPath);
+        while (dir.next()) {
+            if (!dir.isDirectory()) count++;
+        }
+        clearSlot(slot);
+    }
+    if (activeEntries) {
+        memFree(activeEntries);
+        activeEntries = nullptr;
+    }
+    activeSlot = -1;
+    return count;
+}
+
+// ===================================
+// Plan a Sync
+// ===================================
+// Builds the new manifest from the catalog's Bank 1 (sizes were recorded by scanBank1(),
+// so no per-file pre-count pass is needed) and diffs it against the active pack.
+// Returns the number of files that have to come from SD, or -1 if the active
+// pack already matches and nothing needs doing.
+static const FlashPackEntry* findActiveEntry(const char* name) {
+    if (activeSlot < 0) return nullptr;
+    for (uint32_t i = 0; i < activeHeader.entryCount; i++) {
+        if (strcmp(activeEntries[i].name, name) == 0) return &activeEntries[i];
+    }
+    return nullptr;
+}
+
+int planFlashPackSync(int fileLimit) {
+    if (job.entries) memFree(job.entries);
+    if (job.fromSD) memFree(job.fromSD);
+    job.phase = JOB_IDLE;
+    job.entries = nullptr;
+    job.fromSD = nullptr;
+    job.entryCount = 0;
+    job.current = 0;
+    job.copiedFromSD = 0;
+    job.reusedFromFlash = 0;
+    memset(&job.stats, 0, sizeof(job.stats));
+
+    const Catalog* cat = catalog();
+    int count = 0;
+    for (int i = 0; i < cat->bank1SoundCount; i++) {
+        count += cat->bank1Sounds[i].variantCount;
+    }
+    if (count > fileLimit) count = fileLimit;
+
+    job.entries = (FlashPackEntry*)memAllocPsram((count ? count : 1) * sizeof(FlashPackEntry), MEM_TAG_PACK);
+    job.fromSD = (bool*)memAllocPsram((count ? count : 1) * sizeof(bool), MEM_TAG_PACK);
+    if (!job.entries || !job.fromSD) {
+        Serial.println("  ERROR: Could not allocate pack manifest");
+        return 0;
+    }
+
+    int n = 0;
+    for (int i = 0; i < cat->bank1SoundCount && n < count; i++) {
+        for (int v = 0; v < cat->bank1Sounds[i].variantCount && n < count; v++) {
+            FlashPackEntry* e = &job.entries[n];
+            memset(e, 0, sizeof(*e));
+            strncpy(e->name, cat->bank1Sounds[i].variants[v], sizeof(e->name) - 1);
+            e->size = cat->bank1Sounds[i].variantSizes[v];
+            e->modified = cat->bank1Sounds[i].variantStamps[v];
+            n++;
+        }
+    }
+    job.entryCount = n;
+
+    // Same directory, same names, sizes and modify times, same order -> nothing
+    // to do. The size alone misses a WAV edited in place to the same length;
+    // the modify time catches that without reading every file on each boot.
+    bool inSync = (activeSlot >= 0 &&
+                   strcmp(activeHeader.dirName, cat->bank1DirName) == 0 &&
+                   activeHeader.entryCount == (uint32_t)n);
+    for (int i = 0; i < n && inSync; i++) {
+        if (strcmp(activeEntries[i].name, job.entries[i].name) != 0 ||
+            activeEntries[i].size != job.entries[i].size ||
+            activeEntries[i].modified != job.entries[i].modified) {
+            inSync = false;
+        }
+    }
+    if (inSync) return -1;
+
+    int fromSD = 0;
+    for (int i = 0; i < n; i++) {
+        const FlashPackEntry* old = findActiveEntry(job.entries[i].name);
+        job.fromSD[i] = !(old && old->size == job.entries[i].size && old->modified == job.entries[i].modified);
+        if (job.fromSD[i]) fromSD++;
+    }
+    return fromSD;
+}
+
+// ===================================
+// Begin a Sync into the Inactive Slot
+// ===================================
+bool beginFlashPackSync() {
+    if (!job.entries) return false;
+
+    // Staging block in PSRAM; fall back to a small SRAM chunk if it's not there
+    static uint8_t fallback[PACK_FALLBACK_CHUNK];
+    if (!job.block) {
+        job.block = (uint8_t*)memAllocPsram(PACK_COPY_BLOCK, MEM_TAG_PACK);
+        job.blockSize = PACK_COPY_BLOCK;
+    }
+    if (!job.block) {
+        Serial.println("  Flash pack: PSRAM staging unavailable, using 4 KB chunks");
+        job.block = fallback;
+        job.blockSize = sizeof(fallback);
+    }
+
+    job.targetSlot = (activeSlot == 0) ? 1 : 0;
+    clearSlot(job.targetSlot);
+
+    char dirPath[16];
+    slotDir(job.targetSlot, dirPath, sizeof(dirPath));
+    if (!LittleFS.exists(dirPath)) LittleFS.mkdir(dirPath);
+
+    // Files from the pre-A/B layout sitting directly in /flash are dead weight
+    Dir dir = LittleFS.openDir("/flash");
+    while (dir.next()) {
+        if (dir.isDirectory()) continue;
+        String name = dir.fileName();
+        if (name.startsWith("hdr.") || name.startsWith("man.")) continue;
+        LittleFS.remove(String("/flash/") + name);
+    }
+
+    // Does the new pack fit next to the active one?
+    uint32_t needed = 0;
+    for (int i = 0; i < job.entryCount; i++) needed += job.entries[i].size;
+
+    FSInfo info;
+    LittleFS.info(info);
+    uint32_t freeBytes = info.totalBytes - info.usedBytes;
+    // Leave headroom for LittleFS metadata blocks
+    uint32_t margin = info.blockSize * 16;
+    job.stats.flashBlockSize = info.blockSize ? info.blockSize : 4096;
+    job.stats.flashTotalBlocks = info.totalBytes / job.stats.flashBlockSize;
+
+    if (activeSlot >= 0 && needed + margin > freeBytes) {
+        // Not enough room for both. Drop the active pack (header first, so a
+        // crash mid-sync boots with no pack rather than a damaged one) and
+        // take everything from SD.
+        Serial.println("  Flash pack: not enough room for A/B, replacing active pack");
+        clearSlot(activeSlot);
+        memFree(activeEntries);
+        activeEntries = nullptr;
+        activeSlot = -1;
+        for (int i = 0; i < job.entryCount; i++) job.fromSD[i] = true;
+    }
+
+    job.current = 0;
+    job.startMs = millis();
+    job.phase = (job.entryCount > 0) ? JOB_OPEN_FILE : JOB_COMMIT;
+    return true;
+}
+
+// ===================================
+// Step the Sync Job
+// ===================================
+// Does a bounded amount of work per call so it can run from the boot sequence
+// or from the main loop in the background.
+static void closeJobFiles() {
+    if (job.sdSrc) {
+        sdBegin(SDIO_SYNC);
+        job.sdSrc.close();
+        sdEnd();
+    }
+    if (job.flashSrc) job.flashSrc.close();
+    if (job.dst) job.dst.close();
+}
+
+static void releaseStaging() {
+    if (job.block && job.blockSize == PACK_COPY_BLOCK) memFree(job.block);
+    job.block = nullptr;
+    job.blockSize = 0;
+    job.stats.elapsedMs = millis() - job.startMs;
+}
+
+static PackSyncResult failJob(const char* why) {
+    Serial.printf("  Flash pack: %s (%s)\n", why, getFlashPackSyncFile());
+    closeJobFiles();
+    clearSlot(job.targetSlot);
+    releaseStaging();
+    job.phase = JOB_IDLE;
+    return PACK_SYNC_FAILED;
+}
+
+PackSyncResult stepFlashPackSync() {
+    uint8_t* buffer = job.block;
+    char path[80];
+
+    switch (job.phase) {
+        case JOB_IDLE:
+            return PACK_SYNC_DONE;
+
+        case JOB_OPEN_FILE: {
+            FlashPackEntry* e = &job.entries[job.current];
+            if (job.fromSD[job.current]) {
+                snprintf(path, sizeof(path), "/%s/%s", catalog()->bank1DirName, e->name);
+                sdBegin(SDIO_SYNC);
+                job.sdSrc = sd.open(path, FILE_READ);
+                sdEnd();
+                if (!job.sdSrc) return failJob("could not open SD file");
+            } else {
+                slotFilePath(activeSlot, e->name, path, sizeof(path));
+                job.flashSrc = LittleFS.open(path, "r");
+                if (!job.flashSrc) return failJob("could not open active pack file");
+            }
+
+            slotFilePath(job.targetSlot, e->name, path, sizeof(path));
+            job.dst = LittleFS.open(path, "w");
+            if (!job.dst) return failJob("could not create flash file");
+
+            job.remaining = e->size;
+            job.crc.reset();
+            job.phase = JOB_COPY;
+            return PACK_SYNC_FILE_STARTED;
+        }
+
+        case JOB_COPY: {
+            if (job.remaining > 0) {
+                // One large read-ahead into the staging block...
+                uint32_t toRead = job.remaining > job.blockSize ? job.blockSize : job.remaining;
+                uint32_t filled = 0;
+                while (filled < toRead) {
+                    int bytesRead;
+                    if (job.sdSrc) {
+                        // Bounded pieces, so a refill can get in between
+                        bytesRead = sdRead(job.sdSrc, buffer + filled, toRead - filled, SDIO_SYNC);
+                    } else {
+                        bytesRead = job.flashSrc.read(buffer + filled, toRead - filled);
+                    }
+                    if (bytesRead <= 0) return failJob("read error");
+                    filled += bytesRead;
+                }
+                job.stats.bytesRead += filled;
+
+                // ...then program it in a single write of whole erase blocks
+                if (job.dst.write(buffer, filled) != filled) return failJob("write error");
+                job.stats.bytesWritten += filled;
+                job.stats.blocksProgrammed += (filled + job.stats.flashBlockSize - 1) / job.stats.flashBlockSize;
+
+                job.crc.update(buffer, filled);
+                job.remaining -= filled;
+                return PACK_SYNC_BUSY;
+            }
+
+            job.entries[job.current].crc = job.crc.finalize();
+            closeJobFiles();
+            job.phase = JOB_VERIFY;
+            return PACK_SYNC_BUSY;
+        }
+
+        case JOB_VERIFY: {
+            // Read back what landed in flash and compare with what we wrote
+            FlashPackEntry* e = &job.entries[job.current];
+            slotFilePath(job.targetSlot, e->name, path, sizeof(path));
+            File f = LittleFS.open(path, "r");
+            if (!f || f.size() != e->size) {
+                if (f) f.close();
+                return failJob("size mismatch after write");
+            }
+            CRC32 check;
+            int n;
+            while ((n = f.read(buffer, job.blockSize)) > 0) {
+                check.update(buffer, n);
+            }
+            f.close();
+            if (check.finalize() != e->crc) return failJob("CRC mismatch after write");
+
+            if (job.fromSD[job.current]) job.copiedFromSD++;
+            else job.reusedFromFlash++;
+
+            bool wasFromSD = job.fromSD[job.current];
+            job.current++;
+            job.phase = (job.current < job.entryCount) ? JOB_OPEN_FILE : JOB_COMMIT;
+            return wasFromSD ? PACK_SYNC_FILE_COPIED : PACK_SYNC_FILE_REUSED;
+        }
+
+        case JOB_COMMIT: {
+            size_t manBytes = job.entryCount * sizeof(FlashPackEntry);
+
+            manifestPath(job.targetSlot, path, sizeof(path));
+            File f = LittleFS.open(path, "w");
+            if (!f) return failJob("could not write manifest");
+            bool ok = (manBytes == 0) || (f.write((const uint8_t*)job.entries, manBytes) == manBytes);
+            f.close();
+            if (!ok) return failJob("manifest write error");
+
+            FlashPackHeader h;
+            memset(&h, 0, sizeof(h));
+            h.magic = PACK_MAGIC;
+            h.generation = (activeSlot >= 0) ? activeHeader.generation + 1 : 1;
+            h.entryCount = job.entryCount;
+            for (int i = 0; i < job.entryCount; i++) h.totalBytes += job.entries[i].size;
+            h.manifestCrc = CRC32::calculate((const uint8_t*)job.entries, manBytes);
+            strncpy(h.dirName, catalog()->bank1DirName, sizeof(h.dirName) - 1);
+            h.wearBlocks = ((activeSlot >= 0) ? activeHeader.wearBlocks : lifetimeWearBlocks) +
+                           job.stats.blocksProgrammed;
+            h.headerCrc = headerCrc(h);
+
+            // --- The commit point ---
+            headerPath(job.targetSlot, path, sizeof(path));
+            f = LittleFS.open(path, "w");
+            if (!f) return failJob("could not write header");
+            ok = (f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h));
+            f.close();
+            if (!ok) return failJob("header write error");
+
+            // Promote: new slot is live, old slot stays as the fallback copy
+            if (activeEntries) memFree(activeEntries);
+            activeHeader = h;
+            activeEntries = job.entries;
+            activeSlot = job.targetSlot;
+            job.entries = nullptr;
+            memFree(job.fromSD);
+            job.fromSD = nullptr;
+            job.phase = JOB_IDLE;
+            lifetimeWearBlocks = h.wearBlocks;
+            releaseStaging();
+
+            Serial.printf("  Flash pack: committed slot %d (gen %lu)\n", activeSlot, h.generation);
+            return PACK_SYNC_DONE;
+        }
+    }
+    return PACK_SYNC_FAILED;
+}
+
+bool isFlashPackSyncing() {
+    return job.phase != JOB_IDLE;
+}
+
+const char* getFlashPackSyncFile() {
+    if (job.phase == JOB_IDLE || !job.entries || job.current >= job.entryCount) return "";
+    return job.entries[job.current].name;
+}
+
+void getFlashPackSyncCounts(int* copiedFromSD, int* reusedFromFlash) {
+    *copiedFromSD = job.copiedFromSD;
+    *reusedFromFlash = job.reusedFromFlash;
+}
+
+// ===================================
+// Sync Throughput & Wear
+// ===================================
+void getFlashPackSyncStats(FlashSyncStats* out) {
+    *out = job.stats;
+    if (job.phase != JOB_IDLE) out->elapsedMs = millis() - job.startMs;
+    out->lifetimeBlocks = lifetimeWearBlocks;
+    if (job.phase != JOB_IDLE) out->lifetimeBlocks += job.stats.blocksProgrammed;
+}
+
+void printFlashPackSyncStats(Print& out) {
+    FlashSyncStats st;
+    getFlashPackSyncStats(&st);
+
+    float seconds = st.elapsedMs / 1000.0f;
+    float mbps = seconds > 0 ? (st.bytesWritten / (1024.0f * 1024.0f)) / seconds : 0;
+    out.printf("  Throughput: %lu KB in %.1f s (%.2f MB/s)\n",
+               st.bytesWritten / 1024, seconds, mbps);
+
+    // LittleFS wear-levels across the whole partition, so the average erase
+    // count per block is roughly total blocks programmed / blocks available.
+    if (st.flashTotalBlocks > 0) {
+        float cycles = (float)st.lifetimeBlocks / st.flashTotalBlocks;
+        out.printf("  Flash wear: %lu blocks this sync, ~%.2f avg erase cycles lifetime (%.4f%% of %lu rated)\n",
+                   st.blocksProgrammed, cycles, cycles * 100.0f / FLASH_RATED_CYCLES, FLASH_RATED_CYCLES);
+    }
+}
+
+// ===================================
+// Active Pack Contents
+// ===================================
+int getFlashPackEntryCount() {
+    return activeSlot >= 0 ? (int)activeHeader.entryCount : 0;
+}
+
+const FlashPackEntry* getFlashPackEntry(int index) {
+    if (index < 0 || index >= getFlashPackEntryCount()) return nullptr;
+    return &activeEntries[index];
+}
@@ -12,27 +12,13 @@ I2S i2s(OUTPUT, I2S_BCLK, I2S_DATA, I2S_LRCK);
 // We pre-calculate (attenuation_0_100 * 256 / 100) -> 0-256
 volatile int16_t masterAttenMultiplier = (97 * 256) / 100; // Default 97%
 
-// Bank 1 File List (Flash)
-SoundFile bank1Sounds[MAX_SOUNDS];
-int bank1SoundCount = 0;
-char bank1DirName[64] = "";
+// Bank 1 Page (the file lists live in the catalog, see catalog.cpp)
 char activeBank1Page = 'A'; 
 
-// SD Banks Structure (Banks 2-6)
-SDBank sdBanks[MAX_SD_BANKS];
-int sdBankCount = 0;
-
-// Root Tracks (Legacy Compatibility)
-char rootTracks[MAX_ROOT_TRACKS][16];
-int rootTrackCount = 0;
-
 // Test Tone State
 volatile bool testToneActive = false;
 volatile uint32_t testTonePhase = 0;
 
-// Filename Checksum
-uint32_t globalFilenameChecksum = 0;
-
 
 // ===================================
 // Global Mutex Definitions
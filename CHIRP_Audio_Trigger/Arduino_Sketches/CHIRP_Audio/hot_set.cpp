@@ -0,0 +1,205 @@
+#include "config.h"
+
+// =================================================================================
+//  HOT SET AND BOOT WARM-UP (WARM command)
+// =================================================================================
+// After a reboot the pre-roll cache is empty, so the first triggers of a show
+// all start from the card. To avoid that, every trigger bumps the sound's play
+// count and recency here (noteSoundTrigger calls noteHotSound), and the table
+// is saved to flash (HOT_FILE) in batches: when it has changed, at most every
+// HOT_SAVE_MS, and only while nothing is playing (a flash write stalls both
+// cores).
+//
+// At boot, once the catalog is scanned, beginWarmup() ranks the saved sounds
+// by score and the warm-up hands them to the pre-roll cache one at a time,
+// hottest first. It only queues the next one when the cache loader is idle,
+// so live predictions (queued on each trigger) go first and the loads
+// themselves already wait out any playing ring that is running low. A few
+// slots are left for predictions.
+//
+// score = plays, halved for every HOT_HALF_LIFE triggers since the last play.
+// Bank 1 isn't warmed here: residency (#BANK1_RESIDENT) loads it whole.
+
+#define HOT_FILE "/hotset.bin"
+#define HOT_MAGIC 0x54534F48       // "HOST"
+#define HOT_VERSION 1
+#define HOT_SOUNDS 128
+#define HOT_SAVE_MS 600000         // 10 min
+#define HOT_HALF_LIFE 200          // Triggers
+#define HOT_WARM_MAX (PREROLL_SLOTS - PREDICT_TOPK)
+
+struct HotSound {
+    uint32_t key;       // SOUND_KEY, 0 = empty
+    uint32_t lastPlay;  // hotClock at the last trigger
+    uint16_t plays;
+    uint16_t pad;
+};
+
+struct HotFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t clock;
+};
+
+static HotSound hotSounds[HOT_SOUNDS];
+static uint32_t hotClock = 0; // Triggers, persisted
+static bool hotDirty = false;
+static uint32_t hotLastSave = 0;
+static uint32_t hotSaves = 0;
+
+// Warm-up
+static uint32_t warmList[HOT_WARM_MAX]; // Keys, hottest first
+static int warmCount = 0;
+static int warmNext = 0;         // Next to queue
+static int warmQueued = 0;
+static int warmSkipped = 0;      // Not on SD, or already cached/queued
+static uint32_t warmStartMs = 0;
+static uint32_t warmDoneMs = 0;  // 0 = running (or never started)
+
+static uint32_t hotScore(const HotSound* h) {
+    uint32_t halvings = (hotClock - h->lastPlay) / HOT_HALF_LIFE;
+    return halvings >= 16 ? 0 : ((uint32_t)h->plays << 8) >> halvings;
+}
+
+// ===================================
+// Record (noteSoundTrigger)
+// ===================================
+void noteHotSound(uint32_t key) {
+    hotClock++;
+    HotSound* h = nullptr;
+    HotSound* weakest = &hotSounds[0];
+    for (int i = 0; i < HOT_SOUNDS; i++) {
+        if (hotSounds[i].key == key) {
+            h = &hotSounds[i];
+            break;
+        }
+        if (hotSounds[i].key == 0) {
+            if (weakest->key) weakest = &hotSounds[i];
+        } else if (weakest->key && hotScore(&hotSounds[i]) < hotScore(weakest)) {
+            weakest = &hotSounds[i];
+        }
+    }
+    if (!h) {
+        h = weakest;
+        h->key = key;
+        h->plays = 0;
+    }
+    if (h->plays < 0xFFFF) h->plays++;
+    h->lastPlay = hotClock;
+    hotDirty = true;
+}
+
+// ===================================
+// Persistence (flash, batched)
+// ===================================
+void loadHotSet() {
+    mutex_enter_blocking(&flash_mutex);
+    File f = LittleFS.open(HOT_FILE, "r");
+    if (f) {
+        HotFileHeader h;
+        if (f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && h.magic == HOT_MAGIC &&
+            h.version == HOT_VERSION && h.count == HOT_SOUNDS &&
+            f.read((uint8_t*)hotSounds, sizeof(hotSounds)) == sizeof(hotSounds)) {
+            hotClock = h.clock;
+        } else {
+            memset(hotSounds, 0, sizeof(hotSounds)); // Old format or torn write
+        }
+        f.close();
+    }
+    mutex_exit(&flash_mutex);
+}
+
+static bool saveHotSet() {
+    HotFileHeader h = { HOT_MAGIC, HOT_VERSION, HOT_SOUNDS, hotClock };
+    mutex_enter_blocking(&flash_mutex);
+    File f = LittleFS.open(HOT_FILE, "w");
+    bool ok = f && f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+              f.write((const uint8_t*)hotSounds, sizeof(hotSounds)) == sizeof(hotSounds);
+    if (f) f.close();
+    mutex_exit(&flash_mutex);
+    if (!ok) log_message("WARM: ERROR - could not save the hot set");
+    return ok;
+}
+
+// ===================================
+// Warm-up (setup, then Core 0 housekeeping)
+// ===================================
+// Rank the saved sounds (after the catalog scan, so paths resolve)
+void beginWarmup() {
+    warmCount = 0;
+    warmNext = 0;
+    warmQueued = 0;
+    warmSkipped = 0;
+    warmStartMs = millis();
+    warmDoneMs = 0;
+
+    // Selection of the top HOT_WARM_MAX by score (small table, runs once)
+    bool taken[HOT_SOUNDS] = { false };
+    while (warmCount < HOT_WARM_MAX) {
+        int best = -1;
+        uint32_t bestScore = 0;
+        for (int i = 0; i < HOT_SOUNDS; i++) {
+            if (taken[i] || !hotSounds[i].key || ((hotSounds[i].key >> 24) & 0x7F) == 1) continue;
+            uint32_t score = hotScore(&hotSounds[i]);
+            if (score > bestScore) {
+                best = i;
+                bestScore = score;
+            }
+        }
+        if (best < 0) break;
+        taken[best] = true;
+        warmList[warmCount++] = hotSounds[best].key;
+    }
+    Serial.printf("  Warm-up: %d hot sounds to pre-roll (%lu triggers recorded)\n", warmCount, hotClock);
+    if (warmCount == 0) warmDoneMs = millis();
+}
+
+static void serviceWarmup() {
+    if (warmDoneMs || isPrerollBusy()) return;
+    if (warmNext >= warmCount) {
+        warmDoneMs = millis();
+        log_message(String("WARM: Done, ") + warmQueued + " sounds cached in " + (warmDoneMs - warmStartMs) + "ms");
+        return;
+    }
+    char path[128];
+    uint32_t key = warmList[warmNext++];
+    if (soundKeyPath(key, path, sizeof(path)) && requestPreroll(path, false)) warmQueued++;
+    else warmSkipped++;
+}
+
+void serviceHotSet() {
+    serviceWarmup();
+
+    if (!hotDirty || millis() - hotLastSave < HOT_SAVE_MS) return;
+    for (int i = 0; i < MAX_VOICES; i++) {
+        if (streams[i].active || streams[i].waitingForDecoder) return;
+    }
+    if (saveHotSet()) {
+        hotDirty = false;
+        hotSaves++;
+    }
+    hotLastSave = millis();
+}
+
+// ===================================
+// Status (WARM command)
+// ===================================
+void printWarmupStatus(Print& out, bool listHot) {
+    int used = 0;
+    for (int i = 0; i < HOT_SOUNDS; i++) {
+        if (hotSounds[i].key) used++;
+    }
+    uint32_t elapsed = (warmDoneMs ? warmDoneMs : millis()) - warmStartMs;
+    out.printf("WARM:%s %d/%d,queued %d,skipped %d,%lums\n", warmDoneMs ? "done" : "warming",
+               warmNext, warmCount, warmQueued, warmSkipped, elapsed);
+    out.printf("WARM:hot set %d/%d sounds,triggers %lu,saves %lu%s\n", used, HOT_SOUNDS, hotClock, hotSaves,
+               hotDirty ? ",unsaved" : "");
+    if (!listHot) return;
+    for (int i = 0; i < warmCount; i++) {
+        char path[128];
+        uint32_t key = warmList[i];
+        out.printf("WARM:%2d %s %s\n", i, i < warmNext ? "sent" : "wait",
+                   soundKeyPath(key, path, sizeof(path)) ? path : "(not on SD)");
+    }
+}
@@ -0,0 +1,191 @@
+#include "config.h"
+
+// =================================================================================
+//  INPUT EVENTS (buttons and trigger pins)
+// =================================================================================
+// Every input gets a GPIO edge interrupt. The ISR debounces (an edge is only
+// taken if the level actually changed and the last accepted edge is at least
+// INPUT_DEBOUNCE_US old) and pushes {input, pressed, micros()} onto a small
+// lock-free ring. serviceInputs() (a scheduler task) drains the ring and turns
+// the edges into gestures for each input's handler:
+//
+//   INPUT_PRESS   on the press edge, no extra delay (use this for triggers)
+//   INPUT_CLICK   released before INPUT_LONG_MS, and no second press within
+//                 INPUT_DOUBLE_MS (so it arrives INPUT_DOUBLE_MS after release)
+//   INPUT_DOUBLE  second press within INPUT_DOUBLE_MS of the first release
+//   INPUT_LONG    held for INPUT_LONG_MS (fires while still held)
+//   INPUT_RELEASE on the release edge
+//
+// The ring has one producer context (the GPIO ISR on Core 0; the service's
+// stuck-level fix-up runs with interrupts off) and one consumer, so head and
+// tail need no lock. Up to INPUT_MAX inputs can be registered, enough for the
+// three panel buttons plus the 18 trigger pins of the original MP3 Trigger.
+
+#define INPUT_QUEUE_SIZE 64 // Power of two
+
+struct InputEdge {
+    uint8_t input;
+    bool pressed;
+    uint32_t timeUs;
+};
+
+struct InputState {
+    uint8_t pin;
+    bool activeLow;
+    InputHandler handler;
+
+    // ISR side
+    volatile bool level;          // Last accepted state (true = pressed)
+    volatile uint32_t lastEdgeUs;
+
+    // Gesture state (service side)
+    bool held;
+    bool longSent;
+    uint8_t clicks;               // Clicks waiting for the double window
+    uint32_t pressUs;
+    uint32_t releaseUs;
+};
+
+static InputState inputs[INPUT_MAX];
+static int inputCount = 0;
+
+static InputEdge edgeQueue[INPUT_QUEUE_SIZE];
+static volatile uint32_t edgeHead = 0; // Written by the producer
+static volatile uint32_t edgeTail = 0; // Written by the consumer
+static volatile uint32_t edgeDrops = 0;
+
+static uint32_t gestureCount = 0;
+static uint32_t maxDispatchUs = 0; // Worst delay from when a gesture was certain to its handler
+
+static inline bool readPressed(InputState* in) {
+    return digitalRead(in->pin) == (in->activeLow ? LOW : HIGH);
+}
+
+// Producer: GPIO ISR, or the service with interrupts disabled
+static void acceptEdge(uint8_t idx, bool pressed, uint32_t now) {
+    InputState* in = &inputs[idx];
+    if (pressed == in->level) return;
+    if (now - in->lastEdgeUs < INPUT_DEBOUNCE_US) return;
+    in->level = pressed;
+    in->lastEdgeUs = now;
+
+    uint32_t head = edgeHead;
+    if (head - edgeTail >= INPUT_QUEUE_SIZE) {
+        edgeDrops++;
+        return;
+    }
+    InputEdge* e = &edgeQueue[head & (INPUT_QUEUE_SIZE - 1)];
+    e->input = idx;
+    e->pressed = pressed;
+    e->timeUs = now;
+    edgeHead = head + 1; // Publish after the entry is written
+}
+
+static void inputIsr(void* param) {
+    uint8_t idx = (uint8_t)(uintptr_t)param;
+    acceptEdge(idx, readPressed(&inputs[idx]), micros());
+}
+
+// ===================================
+// Registration (setup)
+// ===================================
+// Returns the input id, or -1 if the table is full
+int registerInput(uint8_t pin, bool activeLow, InputHandler handler) {
+    if (inputCount >= INPUT_MAX) {
+        Serial.printf("Inputs: ERROR - no room for pin %d\n", pin);
+        return -1;
+    }
+    int idx = inputCount++;
+    InputState* in = &inputs[idx];
+    memset(in, 0, sizeof(*in));
+    in->pin = pin;
+    in->activeLow = activeLow;
+    in->handler = handler;
+
+    pinMode(pin, activeLow ? INPUT_PULLUP : INPUT_PULLDOWN);
+    in->level = readPressed(in);
+    in->lastEdgeUs = micros();
+    attachInterruptParam(digitalPinToInterrupt(pin), inputIsr, CHANGE, (void*)(uintptr_t)idx);
+    return idx;
+}
+
+// edgeUs goes to the handler; dueUs is when the gesture was decided (the
+// edge itself, or the end of the long/double wait), and is what the
+// service latency is measured from: the wait is by design, not a delay
+static void dispatch(uint8_t idx, uint8_t gesture, uint32_t edgeUs, uint32_t dueUs) {
+    InputState* in = &inputs[idx];
+    uint32_t delay = micros() - dueUs;
+    if (delay > maxDispatchUs) maxDispatchUs = delay;
+    gestureCount++;
+    if (in->handler) in->handler(idx, gesture, edgeUs);
+}
+
+// ===================================
+// Service (Core 0 scheduler task)
+// ===================================
+void serviceInputs() {
+    uint32_t now = micros();
+
+    // A bounce right after an accepted edge can leave the pin settled in the
+    // other state with no further interrupt; catch it up here
+    for (int i = 0; i < inputCount; i++) {
+        InputState* in = &inputs[i];
+        if (now - in->lastEdgeUs < INPUT_DEBOUNCE_US) continue;
+        bool pressed = readPressed(in);
+        if (pressed != in->level) {
+            noInterrupts();
+            acceptEdge(i, pressed, now);
+            interrupts();
+        }
+    }
+
+    // Edges -> press / release / double
+    while (edgeTail != edgeHead) {
+        InputEdge e = edgeQueue[edgeTail & (INPUT_QUEUE_SIZE - 1)];
+        edgeTail = edgeTail + 1;
+        InputState* in = &inputs[e.input];
+
+        if (e.pressed) {
+            in->held = true;
+            in->longSent = false;
+            in->pressUs = e.timeUs;
+            dispatch(e.input, INPUT_PRESS, e.timeUs, e.timeUs);
+            if (in->clicks > 0 && e.timeUs - in->releaseUs <= INPUT_DOUBLE_MS * 1000UL) {
+                in->clicks = 0;
+                in->longSent = true; // This press is spent; no click or long from it
+                dispatch(e.input, INPUT_DOUBLE, e.timeUs, e.timeUs);
+            }
+        } else {
+            in->held = false;
+            in->releaseUs = e.timeUs;
+            dispatch(e.input, INPUT_RELEASE, e.timeUs, e.timeUs);
+            if (!in->longSent) in->clicks = 1;
+        }
+    }
+
+    // Timed gestures: long press while held, single click once the double window closes
+    now = micros();
+    for (int i = 0; i < inputCount; i++) {
+        InputState* in = &inputs[i];
+        if (in->held && !in->longSent && now - in->pressUs >= INPUT_LONG_MS * 1000UL) {
+            in->longSent = true;
+            uint32_t due = in->pressUs + INPUT_LONG_MS * 1000UL;
+            dispatch(i, INPUT_LONG, due, due);
+        }
+        if (!in->held && in->clicks > 0 && now - in->releaseUs > INPUT_DOUBLE_MS * 1000UL) {
+            in->clicks = 0;
+            dispatch(i, INPUT_CLICK, in->releaseUs, in->releaseUs + INPUT_DOUBLE_MS * 1000UL);
+        }
+    }
+}
+
+// ===================================
+// Status (INPT command)
+// ===================================
+void printInputStatus(Print& out) {
+    out.printf("INPT:inputs %d,gestures %lu,dropped %lu,max dispatch %luus\n",
+               inputCount, gestureCount, (uint32_t)edgeDrops, maxDispatchUs);
+    for (int i = 0; i < inputCount; i++) {
+        out.printf("INPT:%d pin %d %s\n", i, inputs[i].pin, inputs[i].level ? "pressed" : "released");
+    }
+}
@@ -0,0 +1,157 @@
+#include "config.h"
+
+// =================================================================================
+//  MEMORY ACCOUNTING (MEM command)
+// =================================================================================
+// Every firmware heap allocation goes through memAlloc()/memAllocPsram() with
+// a subsystem tag, and back through memFree(). An 8-byte header in front of
+// the block records size, tag and region, so memFree() needs no size and the
+// returned pointer keeps malloc's 8-byte alignment (the MP3 decoders rely on it).
+//
+// MEM prints:
+//   - per tag and region: bytes held now, peak, live blocks, failed requests
+//   - the big static tables (catalog arrays, stream state), from sizeof
+//   - SRAM and PSRAM heap totals from the core, with "untracked" being what
+//     libraries and Arduino String use outside the tagged allocators
+//   - fragmentation: largest block we can still get vs. total free
+//
+// Allocation is Core 0 only (setup and loop); nothing here is called from Core 1.
+
+#define MEM_MAGIC 0xC4
+#define MEM_REGION_SRAM 0
+#define MEM_REGION_PSRAM 1
+
+struct MemHeader {
+    uint32_t size;
+    uint8_t tag;
+    uint8_t region;
+    uint8_t magic;
+    uint8_t pad;
+};
+
+struct MemCounter {
+    uint32_t bytes;
+    uint32_t peak;
+    uint32_t blocks;
+    uint32_t failures;
+};
+
+static MemCounter counters[MEM_TAG_COUNT][2];
+
+static const char* tagNames[MEM_TAG_COUNT] = {
+    "rings", "mp3", "resident", "preroll", "pack", "catalog", "scratch"
+};
+
+static void* track(void* raw, size_t size, uint8_t tag, uint8_t region) {
+    if (tag >= MEM_TAG_COUNT) tag = MEM_TAG_SCRATCH;
+    MemCounter* c = &counters[tag][region];
+    if (!raw) {
+        c->failures++;
+        return nullptr;
+    }
+    MemHeader* h = (MemHeader*)raw;
+    h->size = size;
+    h->tag = tag;
+    h->region = region;
+    h->magic = MEM_MAGIC;
+
+    c->bytes += size;
+    c->blocks++;
+    if (c->bytes > c->peak) c->peak = c->bytes;
+    return h + 1;
+}
+
+// ===================================
+// Allocate / Free
+// ===================================
+void* memAlloc(size_t size, uint8_t tag) {
+    return track(malloc(size + sizeof(MemHeader)), size, tag, MEM_REGION_SRAM);
+}
+
+void* memAllocPsram(size_t size, uint8_t tag) {
+    if (!BoardProfile::hasPsram) return memAlloc(size, tag); // Board without PSRAM
+    return track(psramMalloc(size + sizeof(MemHeader)), size, tag, MEM_REGION_PSRAM);
+}
+
+void memFree(void* p) {
+    if (!p) return;
+    MemHeader* h = (MemHeader*)p - 1;
+    if (h->magic != MEM_MAGIC || h->tag >= MEM_TAG_COUNT || h->region > MEM_REGION_PSRAM) {
+        log_message("MEM: ERROR - free of an untracked block");
+        return; // Leak it rather than corrupt the heap
+    }
+    MemCounter* c = &counters[h->tag][h->region];
+    c->bytes -= h->size;
+    c->blocks--;
+    h->magic = 0;
+    free(h);
+}
+
+// Bytes a library allocated for a tagged owner with its own malloc (Helix's
+// decoder state), measured by the caller as heap growth. Negative on release.
+// Shows under the tag instead of "untracked"; counted as one block.
+void memNoteExternal(uint8_t tag, bool psram, int32_t bytes) {
+    if (bytes == 0) return;
+    if (tag >= MEM_TAG_COUNT) tag = MEM_TAG_SCRATCH;
+    MemCounter* c = &counters[tag][psram ? MEM_REGION_PSRAM : MEM_REGION_SRAM];
+    c->bytes += bytes;
+    if (bytes > 0) c->blocks++;
+    else c->blocks--;
+    if (c->bytes > c->peak) c->peak = c->bytes;
+}
+
+// ===================================
+// Report
+// ===================================
+// Largest block the allocator will still hand out (binary search, Core 0,
+// momentary). Returns bytes.
+static uint32_t largestFree(bool psram, uint32_t freeBytes) {
+    uint32_t lo = 0, hi = freeBytes;
+    while (hi - lo > 256) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        void* p = psram ? psramMalloc(mid) : malloc(mid);
+        if (p) {
+            free(p);
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void printHeap(Print& out, const char* name, bool psram, uint32_t total, uint32_t used, uint32_t freeBytes) {
+    uint32_t tracked = 0;
+    for (int t = 0; t < MEM_TAG_COUNT; t++) {
+        tracked += counters[t][psram ? MEM_REGION_PSRAM : MEM_REGION_SRAM].bytes;
+    }
+    uint32_t largest = largestFree(psram, freeBytes);
+    uint32_t frag = freeBytes ? 100 - (uint32_t)((uint64_t)largest * 100 / freeBytes) : 0;
+    out.printf("MEM:%s heap total %luK,used %luK,free %luK,largest %luK,frag %lu%%,tagged %luK,untracked %luK\n",
+               name, total / 1024, used / 1024, freeBytes / 1024, largest / 1024, frag,
+               tracked / 1024, used > tracked ? (used - tracked) / 1024 : 0);
+}
+
+void printMemoryReport(Print& out) {
+    // Heaps
+    printHeap(out, "sram ", false, rp2040.getTotalHeap(), rp2040.getUsedHeap(), rp2040.getFreeHeap());
+    if (BoardProfile::hasPsram) printHeap(out, "psram", true, psramTotalHeap(), psramUsedHeap(), psramFreeHeap());
+
+    // Tagged allocations
+    for (int t = 0; t < MEM_TAG_COUNT; t++) {
+        for (int r = 0; r < 2; r++) {
+            MemCounter* c = &counters[t][r];
+            if (c->peak == 0 && c->failures == 0) continue;
+            out.printf("MEM:%-8s %-5s now %7luB peak %7luB blocks %lu fail %lu\n",
+                       tagNames[t], r ? "psram" : "sram", c->bytes, c->peak, c->blocks, c->failures);
+        }
+    }
+
+    // Static sections (linker symbols) and the big tables in them
+    extern char __data_start__, __data_end__, __bss_start__, __bss_end__;
+    out.printf("MEM:sections data %uB,bss %uB\n",
+               (unsigned)(&__data_end__ - &__data_start__), (unsigned)(&__bss_end__ - &__bss_start__));
+    out.printf("MEM:static streams %uB,rings %uB,catalog %uB,serial2 queue %uB\n",
+               (unsigned)sizeof(streams), (unsigned)sizeof(streamBuffers), (unsigned)sizeof(Catalog),
+               (unsigned)sizeof(serial2Queue));
+}
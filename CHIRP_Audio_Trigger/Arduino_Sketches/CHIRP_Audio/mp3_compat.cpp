@@ -9,29 +9,31 @@ int lastPlayedRootIndex = 0; // 0-based index in rootTracks array
 
 // Helper to play a root track by index
 void playRootTrack(int index) {
-    if (rootTrackCount == 0) return;
+    const Catalog* cat = catalog();
+    if (cat->rootTrackCount == 0) return;
     
     // Wrap or Clamp? 
     // Sparkfun "Next" wraps.
-    if (index < 0) index = rootTrackCount - 1;
-    if (index >= rootTrackCount) index = 0;
+    if (index < 0) index = cat->rootTrackCount - 1;
+    if (index >= cat->rootTrackCount) index = 0;
     
-    const char* filename = rootTracks[index];
+    const char* filename = cat->rootTracks[index];
     
     // Construct path
     char fullPath[128];
     snprintf(fullPath, sizeof(fullPath), "/%s", filename);
     
-    // Stop Stream 1 (SD Stream) and Play
-    stopStream(1);
-    if (startStream(1, fullPath)) {
+    // Replace Stream 1 (SD Stream), crossfading if XFAD is set
+    noteSoundTrigger(0, 0, index); // Root tracks are bank 0 to the prediction model
+    if (crossfadeStream(1, fullPath, crossfadeMs) >= 0) {
         lastPlayedRootIndex = index;
-        Serial.printf("COMPAT: Playing Root Track %d/%d (%s)\n", index + 1, rootTrackCount, filename);
+        Serial.printf("COMPAT: Playing Root Track %d/%d (%s)\n", index + 1, cat->rootTrackCount, filename);
     }
 }
 
 void action_togglePlayPause() {
     if (streams[1].active) {
+        cancelCrossfade(1);
         stopStream(1);
         Serial.println("COMPAT: Stop");
     } else {
@@ -40,6 +42,13 @@ void action_togglePlayPause() {
     }
 }
 
+// From the top, no crossfade
+void action_restartTrack() {
+    cancelCrossfade(1);
+    stopStream(1);
+    playRootTrack(lastPlayedRootIndex);
+}
+
 void action_playNext() {
     playRootTrack(lastPlayedRootIndex + 1);
 }
@@ -54,12 +63,13 @@ void action_playTrackById(int trackNum) {
     // Sparkfun is strict about "NNN.MP3" usually.
     // But since we indexed ALL files, we can search our index.
     
+    const Catalog* cat = catalog();
     char prefix[8];
     snprintf(prefix, sizeof(prefix), "%03d", trackNum); // "001"
     
     // Search for file starting with "001"
-    for (int i = 0; i < rootTrackCount; i++) {
-        if (strncmp(rootTracks[i], prefix, 3) == 0) {
+    for (int i = 0; i < cat->rootTrackCount; i++) {
+        if (strncmp(cat->rootTracks[i], prefix, 3) == 0) {
             playRootTrack(i);
             return;
         }
@@ -67,8 +77,8 @@ void action_playTrackById(int trackNum) {
     
     // Fallback: Try strict number match if filename is just "1.mp3"
     snprintf(prefix, sizeof(prefix), "%d.", trackNum); // "1."
-    for (int i = 0; i < rootTrackCount; i++) {
-        if (strncmp(rootTracks[i], prefix, strlen(prefix)) == 0) {
+    for (int i = 0; i < cat->rootTrackCount; i++) {
+        if (strncmp(cat->rootTracks[i], prefix, strlen(prefix)) == 0) {
             playRootTrack(i);
             return;
         }
@@ -80,7 +90,8 @@ void action_playTrackById(int trackNum) {
 void action_playTrackByIndex(int trackIndex) {
     // trackIndex is raw 1-based index from 'p' command
     // Just play the file at that index in our sorted list
-    if (trackIndex >= 1 && trackIndex <= rootTrackCount) {
+    const Catalog* cat = catalog();
+    if (trackIndex >= 1 && trackIndex <= cat->rootTrackCount) {
         playRootTrack(trackIndex - 1);
     }
 }
@@ -94,6 +105,7 @@ void action_setSparkfunVolume(uint8_t sfVol) {
     // Apply to ALL streams for global volume control effect
     for (int i = 0; i < MAX_STREAMS; i++) {
         streams[i].volume = vol;
+        syncMixVoice(i);
     }
     Serial.printf("COMPAT: Volume set to %.2f\n", vol);
 }
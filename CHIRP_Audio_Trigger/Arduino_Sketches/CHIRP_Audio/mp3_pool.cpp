@@ -0,0 +1,501 @@
+#include "config.h"
+
+// =================================================================================
+//  MP3 DECODER POOL
+// =================================================================================
+// Decoders are created on demand in PSRAM (the "Option 2" placement-new fix)
+// up to MP3_POOL_SLOTS objects and MP3_POOL_PSRAM_BUDGET bytes. Extra warm
+// decoders are destroyed again after sitting idle for MP3_POOL_IDLE_MS.
+//
+// The object is the small part: Helix mallocs its real decoder state (main
+// data, IMDCT and synthesis buffers, frame/PCM buffers, tens of KB) inside
+// begin(). That happens once, when the decoder is created, and is measured
+// as the heap growth across that begin(); it is charged to the pool
+// (MP3_POOL_SRAM_BUDGET, MEM "mp3") like the object. A released decoder
+// stays begun ("warm"): only its stream state is reset, by running a block
+// of zeros through it with the output discarded, which completes and drops
+// any partial frame the old stream left buffered. The next MP3 start just
+// takes it, no re-init.
+//
+// Placement: the first MP3_POOL_SRAM_SLOTS decoder objects are put in on-chip
+// SRAM instead of PSRAM. The object's frame/sync state is touched on every
+// write(), and in PSRAM those accesses go through the QMI cache where they
+// compete with ring buffer traffic (and with flash XIP). Overflow decoders
+// still go to PSRAM. Only the object can be placed: Helix has no allocator
+// hook, and its hot work buffers come from malloc, which is the SRAM heap on
+// this core, whichever way the object went. MP3P reports the measured state
+// and MP3P:B,<file> times both placements on the same file; the live
+// per-placement timings are per stream mix and only a rough guide. Set
+// MP3_POOL_SRAM_SLOTS to 0 to get the old all-PSRAM layout.
+//
+// When the pool is exhausted, a start first reclaims the decoder of a paused
+// stream, then steals the decoder of a strictly lower priority MP3 stream, or
+// waits (stream parked with its file open) for up to MP3_POOL_WAIT_MS.
+// Waiters are served highest priority first.
+
+struct DecoderSlot {
+    MP3DecoderHelix* decoder; // nullptr = not allocated
+    bool inUse;
+    int owner;                // Stream index, -1 when idle
+    uint32_t releasedAt;      // millis() when it went idle
+    bool inSram;              // Object placed in on-chip SRAM rather than PSRAM
+    uint32_t stateSram;       // Helix's own allocations in begin(), by heap
+    uint32_t statePsram;
+};
+
+#define MP3_DRAIN_BYTES 2048 // > one max-size frame (1441B): completes any partial frame
+static const uint8_t mp3Zeros[MP3_DRAIN_BYTES] = { 0 };
+
+// Per-placement decode timing (0 = PSRAM, 1 = SRAM)
+struct FrameTiming {
+    uint32_t us;
+    uint32_t frames;
+    uint32_t maxFrameUs;
+};
+static FrameTiming frameTiming[2];
+static uint32_t pendingFrames[MP3_POOL_SLOTS]; // Frames emitted during the current write()
+
+static DecoderSlot slots[MP3_POOL_SLOTS];
+static uint32_t poolBytes = 0; // PSRAM bytes held (objects + Helix state)
+static uint32_t sramBytes = 0; // SRAM bytes held (objects + Helix state)
+static uint32_t helixStateBytes = 0; // Largest state seen per decoder, 0 = not measured yet
+static uint32_t streamResets = 0;
+
+// Stats
+static int peakInUse = 0;
+static uint32_t steals = 0;
+static uint32_t waits = 0;
+static uint32_t waitTimeouts = 0;
+static uint32_t allocFailures = 0;
+
+// Core 0 decode load meter: time spent inside decoder write() per second.
+// peakLoadAt[n] is the worst 1s window seen with n decoders running, which
+// gives the practical decoder limit at the current clock speed.
+static uint32_t decodeUsWindow = 0;
+static uint32_t windowStart = 0;
+static uint8_t lastLoadPct = 0;
+static uint8_t peakLoadAt[MP3_POOL_SLOTS + 1];
+
+static int countInUse() {
+    int n = 0;
+    for (int i = 0; i < MP3_POOL_SLOTS; i++) {
+        if (slots[i].inUse) n++;
+    }
+    return n;
+}
+
+static int countSram() {
+    int n = 0;
+    for (int i = 0; i < MP3_POOL_SLOTS; i++) {
+        if (slots[i].decoder && slots[i].inSram) n++;
+    }
+    return n;
+}
+
+static bool allocateSlot(int i) {
+    void* mem = nullptr;
+    bool inSram = false;
+    uint32_t obj = sizeof(MP3DecoderHelix);
+
+    // Helix puts its state on the SRAM heap (malloc), wherever the object goes
+    if (sramBytes + helixStateBytes > MP3_POOL_SRAM_BUDGET) return false;
+
+    // Hot placement first
+    if (countSram() < MP3_POOL_SRAM_SLOTS && sramBytes + obj + helixStateBytes <= MP3_POOL_SRAM_BUDGET) {
+        mem = memAlloc(obj, MEM_TAG_MP3);
+        inSram = (mem != nullptr);
+    }
+    if (!mem) {
+        if (poolBytes + obj > MP3_POOL_PSRAM_BUDGET) return false;
+        mem = memAllocPsram(obj, MEM_TAG_MP3);
+    }
+    if (!mem) {
+        allocFailures++;
+        return false;
+    }
+
+    // The one full init: measure what Helix allocates for itself
+    MP3DecoderHelix* d = new (mem) MP3DecoderHelix(mp3DataCallback);
+    uint32_t sramBefore = rp2040.getUsedHeap();
+    uint32_t psramBefore = psramUsedHeap();
+    bool ok = d->begin();
+    uint32_t sramAfter = rp2040.getUsedHeap();
+    uint32_t psramAfter = psramUsedHeap();
+    if (!ok) {
+        d->end();
+        d->~MP3DecoderHelix();
+        memFree(mem);
+        allocFailures++;
+        return false;
+    }
+
+    DecoderSlot* sl = &slots[i];
+    sl->decoder = d;
+    sl->inSram = inSram;
+    sl->stateSram = sramAfter > sramBefore ? sramAfter - sramBefore : 0;
+    sl->statePsram = psramAfter > psramBefore ? psramAfter - psramBefore : 0;
+    if (sl->stateSram + sl->statePsram > helixStateBytes) helixStateBytes = sl->stateSram + sl->statePsram;
+    memNoteExternal(MEM_TAG_MP3, false, sl->stateSram);
+    memNoteExternal(MEM_TAG_MP3, true, sl->statePsram);
+
+    if (inSram) sramBytes += obj;
+    else poolBytes += obj;
+    sramBytes += sl->stateSram;
+    poolBytes += sl->statePsram;
+    return true;
+}
+
+static void destroySlot(int i) {
+    DecoderSlot* sl = &slots[i];
+    if (!sl->decoder) return;
+    sl->decoder->end();
+    sl->decoder->~MP3DecoderHelix(); // Frees Helix's state
+    memFree(sl->decoder);
+    sl->decoder = nullptr;
+    if (sl->inSram) sramBytes -= sizeof(MP3DecoderHelix);
+    else poolBytes -= sizeof(MP3DecoderHelix);
+    sramBytes -= sl->stateSram;
+    poolBytes -= sl->statePsram;
+    memNoteExternal(MEM_TAG_MP3, false, -(int32_t)sl->stateSram);
+    memNoteExternal(MEM_TAG_MP3, true, -(int32_t)sl->statePsram);
+    sl->stateSram = 0;
+    sl->statePsram = 0;
+    sl->inSram = false;
+}
+
+// Drop whatever the last stream left in the decoder (a partial frame, its
+// bit reservoir) without a re-init: zeros complete the frame, hold no sync
+// word, and their output goes nowhere (no current stream)
+static void resetDecoderStream(int i) {
+    int saved = currentDecodingStream;
+    currentDecodingStream = -1;
+    slots[i].decoder->write(mp3Zeros, sizeof(mp3Zeros));
+    currentDecodingStream = saved;
+    pendingFrames[i] = 0;
+    streamResets++;
+}
+
+// ===================================
+// Init (setup)
+// ===================================
+void initMp3Pool() {
+    for (int i = 0; i < MP3_POOL_SLOTS; i++) {
+        slots[i].decoder = nullptr;
+        slots[i].inUse = false;
+        slots[i].owner = -1;
+        slots[i].releasedAt = 0;
+        slots[i].inSram = false;
+        slots[i].stateSram = 0;
+        slots[i].statePsram = 0;
+        pendingFrames[i] = 0;
+    }
+    memset(frameTiming, 0, sizeof(frameTiming));
+    memset(peakLoadAt, 0, sizeof(peakLoadAt));
+    windowStart = millis();
+
+    // Pre-warm so the first MP3 doesn't pay for the allocation
+    for (int i = 0; i < MP3_POOL_WARM && i < MP3_POOL_SLOTS; i++) {
+        if (allocateSlot(i)) {
+            Serial.printf("Decoder %d OK (%s, +%luB state). ", i, slots[i].inSram ? "SRAM" : "PSRAM",
+                          slots[i].stateSram + slots[i].statePsram);
+        } else {
+            Serial.printf("Decoder %d FAILED! ", i);
+        }
+    }
+}
+
+// ===================================
+// Acquire / Release
+// ===================================
+// Warm decoders were begun when created and reset on release: nothing to do
+static int takeSlot(int i, int streamIdx) {
+    slots[i].inUse = true;
+    slots[i].owner = streamIdx;
+
+    int n = countInUse();
+    if (n > peakInUse) peakInUse = n;
+    return i;
+}
+
+int acquireMp3Decoder(int streamIdx, uint8_t priority) {
+    // 1. Warm idle decoder
+    for (int i = 0; i < MP3_POOL_SLOTS; i++) {
+        if (slots[i].decoder && !slots[i].inUse) return takeSlot(i, streamIdx);
+    }
+
+    // 2. Grow within budget
+    for (int i = 0; i < MP3_POOL_SLOTS; i++) {
+        if (!slots[i].decoder) {
+            if (allocateSlot(i)) return takeSlot(i, streamIdx);
+            break;
+        }
+    }
+
+    // 3. Reclaim from a paused MP3 stream (it gets bookmarked for a seek-based resume).
+    // The crossfade shadow is held paused while it prebuffers; it isn't a
+    // paused track and can't be reclaimed, so it's skipped.
+    int paused = -1;
+    for (int i = 0; i < MP3_POOL_SLOTS; i++) {
+        int owner = slots[i].owner;
+        if (!slots[i].inUse || owner < 0 || owner >= MAX_STREAMS || owner == streamIdx) continue;
+        if (!streams[owner].paused) continue;
+        if (paused < 0 || (int32_t)(streams[owner].pausedAt - streams[paused].pausedAt) < 0) paused = owner;
+    }
+    if (paused >= 0 && reclaimPausedStream(paused)) {
+        steals++;
+        for (int i = 0; i < MP3_POOL_SLOTS; i++) {
+            if (slots[i].decoder && !slots[i].inUse) return takeSlot(i, streamIdx);
+        }
+    }
+
+    // 4. Steal from the lowest priority (then oldest) MP3 stream below ours
+    int victim = -1;
+    for (int i = 0; i < MP3_POOL_SLOTS; i++) {
+        int owner = slots[i].owner;
+        if (!slots[i].inUse || owner < 0 || owner == streamIdx) continue;
+        if (streams[owner].priority >= priority) continue;
+        if (victim < 0 ||
+            streams[owner].priority < streams[victim].priority ||
+            (streams[owner].priority == streams[victim].priority &&
+             (int32_t)(streams[owner].startTime - streams[victim].startTime) < 0)) {
+            victim = owner;
+        }
+    }
+    if (victim >= 0) {
+        log_message(String("MP3 pool: stream ") + victim + " pre-empted by stream " + streamIdx);
+        steals++;
+        stopStream(victim); // Releases its decoder back to the pool
+        for (int i = 0; i < MP3_POOL_SLOTS; i++) {
+            if (slots[i].decoder && !slots[i].inUse) return takeSlot(i, streamIdx);
+        }
+    }
+
+    return -1;
+}
+
+void releaseMp3Decoder(int decoderIdx) {
+    if (decoderIdx < 0 || decoderIdx >= MP3_POOL_SLOTS || !slots[decoderIdx].decoder) return;
+    resetDecoderStream(decoderIdx);
+    slots[decoderIdx].inUse = false;
+    slots[decoderIdx].owner = -1;
+    slots[decoderIdx].releasedAt = millis();
+}
+
+// A crossfade moved the stream to another voice slot
+void setMp3DecoderOwner(int decoderIdx, int owner) {
+    if (decoderIdx < 0 || decoderIdx >= MP3_POOL_SLOTS || !slots[decoderIdx].inUse) return;
+    slots[decoderIdx].owner = owner;
+}
+
+MP3DecoderHelix* getMp3Decoder(int decoderIdx) {
+    if (decoderIdx < 0 || decoderIdx >= MP3_POOL_SLOTS) return nullptr;
+    return slots[decoderIdx].decoder;
+}
+
+// Called from the decoder callback, once per decoded frame
+void __not_in_flash_func(noteMp3Frame)(int decoderIdx) { // From the SRAM callback
+    if (decoderIdx >= 0 && decoderIdx < MP3_POOL_SLOTS) pendingFrames[decoderIdx]++;
+}
+
+// Called after each decoder write() with the time it took
+void noteMp3DecodeTime(int decoderIdx, uint32_t us) {
+    decodeUsWindow += us;
+    if (decoderIdx < 0 || decoderIdx >= MP3_POOL_SLOTS) return;
+
+    // write() only buffers until a whole frame is available, so charge the
+    // time to the frames it actually produced
+    uint32_t frames = pendingFrames[decoderIdx];
+    if (frames == 0) return;
+    pendingFrames[decoderIdx] = 0;
+
+    FrameTiming* t = &frameTiming[slots[decoderIdx].inSram ? 1 : 0];
+    t->us += us;
+    t->frames += frames;
+    uint32_t perFrame = us / frames;
+    if (perFrame > t->maxFrameUs) t->maxFrameUs = perFrame;
+}
+
+void noteMp3Wait() {
+    waits++;
+}
+
+// ===================================
+// Service (Core 0 loop)
+// ===================================
+void serviceMp3Pool() {
+    uint32_t now = millis();
+
+    // Hand freed decoders to waiting streams, highest priority first
+    while (true) {
+        int best = -1;
+        for (int i = 0; i < MAX_VOICES; i++) {
+            if (!streams[i].waitingForDecoder) continue;
+            if (now - streams[i].waitStart > MP3_POOL_WAIT_MS) {
+                log_message(String("Stream ") + i + ": ERROR - Timed out waiting for MP3 decoder");
+                waitTimeouts++;
+                streams[i].waitingForDecoder = false;
+                stopStream(i);
+                continue;
+            }
+            if (best < 0 || streams[i].priority > streams[best].priority ||
+                (streams[i].priority == streams[best].priority &&
+                 (int32_t)(streams[i].waitStart - streams[best].waitStart) < 0)) {
+                best = i;
+            }
+        }
+        if (best < 0) break;
+
+        int d = acquireMp3Decoder(best, streams[best].priority);
+        if (d < 0) break;
+
+        AudioStream* s = &streams[best];
+        s->decoderIndex = d;
+        s->waitingForDecoder = false;
+        s->startTime = millis();
+        s->active = true;
+        syncMixVoice(best);
+        log_message(String("Stream ") + best + ": MP3 decoder " + d + " granted after " +
+                    (now - s->waitStart) + "ms wait");
+    }
+
+    // Shrink: free extra idle decoders, keep MP3_POOL_WARM allocated
+    int allocated = 0;
+    for (int i = 0; i < MP3_POOL_SLOTS; i++) {
+        if (slots[i].decoder) allocated++;
+    }
+    for (int i = MP3_POOL_SLOTS - 1; i >= 0 && allocated > MP3_POOL_WARM; i--) {
+        if (slots[i].decoder && !slots[i].inUse && now - slots[i].releasedAt > MP3_POOL_IDLE_MS) {
+            destroySlot(i);
+            allocated--;
+        }
+    }
+
+    // Roll the 1s load window
+    if (now - windowStart >= 1000) {
+        uint32_t pct = decodeUsWindow / ((now - windowStart) * 10);
+        lastLoadPct = pct > 100 ? 100 : pct;
+        int n = countInUse();
+        if (lastLoadPct > peakLoadAt[n]) peakLoadAt[n] = lastLoadPct;
+        decodeUsWindow = 0;
+        windowStart = now;
+    }
+}
+
+// ===================================
+// Placement benchmark (MP3P:B,<file>)
+// ===================================
+// The live SRAM/PSRAM frame timings come from whatever streams happened to
+// run on each placement, so they aren't comparable. This decodes the same
+// bytes (the first MP3_BENCH_BYTES of an SD file, read into SRAM first) on
+// a temporary decoder of each placement, nothing else playing, and also
+// reports where that decoder's Helix state landed.
+#define MP3_BENCH_BYTES (32 * 1024)
+#define MP3_BENCH_CHUNK 512 // Same write size as the refill
+
+static uint32_t benchFrames = 0;
+static void mp3BenchCallback(MP3FrameInfo& info, int16_t* pcm_buffer, size_t len, void* ref) {
+    benchFrames++;
+}
+
+static void benchPlacement(Print& out, bool inSram, const uint8_t* data, uint32_t len) {
+    const char* where = inSram ? "SRAM " : "PSRAM";
+    void* mem = inSram ? memAlloc(sizeof(MP3DecoderHelix), MEM_TAG_SCRATCH)
+                       : memAllocPsram(sizeof(MP3DecoderHelix), MEM_TAG_SCRATCH);
+    if (!mem) {
+        out.printf("MP3P:bench %s - no memory\n", where);
+        return;
+    }
+
+    MP3DecoderHelix* d = new (mem) MP3DecoderHelix(mp3BenchCallback);
+    uint32_t sramBefore = rp2040.getUsedHeap();
+    uint32_t psramBefore = psramUsedHeap();
+    bool ok = d->begin();
+    uint32_t stateSram = rp2040.getUsedHeap() - sramBefore;
+    uint32_t statePsram = psramUsedHeap() - psramBefore;
+    if (!ok) {
+        d->end();
+        d->~MP3DecoderHelix();
+        memFree(mem);
+        out.printf("MP3P:bench %s - decoder init failed (no heap for Helix state?)\n", where);
+        return;
+    }
+
+    benchFrames = 0;
+    uint32_t us = 0;
+    for (uint32_t pos = 0; pos < len; pos += MP3_BENCH_CHUNK) {
+        uint32_t n = len - pos < MP3_BENCH_CHUNK ? len - pos : MP3_BENCH_CHUNK;
+        uint32_t t0 = micros();
+        d->write(data + pos, n);
+        us += micros() - t0;
+    }
+
+    d->end();
+    d->~MP3DecoderHelix();
+    memFree(mem);
+
+    if (benchFrames == 0) {
+        out.printf("MP3P:bench %s - no frames decoded (not an MP3?)\n", where);
+        return;
+    }
+    out.printf("MP3P:bench %s object: avg %lu us/frame (%lu frames), Helix state +%luB SRAM +%luB PSRAM\n",
+               where, us / benchFrames, benchFrames, stateSram, statePsram);
+}
+
+void runMp3PoolBench(Print& out, const char* path) {
+    for (int i = 0; i < MAX_VOICES; i++) {
+        if (streams[i].active || streams[i].waitingForDecoder) {
+            out.println("ERR:MP3P - stop playback first");
+            return;
+        }
+    }
+
+    uint8_t* data = (uint8_t*)memAlloc(MP3_BENCH_BYTES, MEM_TAG_SCRATCH);
+    if (!data) {
+        out.println("ERR:MP3P - no memory");
+        return;
+    }
+    sdBegin(SDIO_OPEN);
+    FsFile f = sd.open(path, FILE_READ);
+    int len = f ? f.read(data, MP3_BENCH_BYTES) : -1;
+    if (f) f.close();
+    sdEnd();
+    if (len <= 0) {
+        out.println("ERR:MP3P - could not read file");
+        memFree(data);
+        return;
+    }
+
+    out.printf("MP3P:bench %s, first %dB, %lu MHz\n", path, len, rp2040.f_cpu() / 1000000);
+    benchPlacement(out, true, data, len);
+    if (BoardProfile::hasPsram) benchPlacement(out, false, data, len);
+    memFree(data);
+}
+
+// ===================================
+// Status (MP3P command)
+// ===================================
+void printMp3PoolStatus(Print& out) {
+    int allocated = 0;
+    for (int i = 0; i < MP3_POOL_SLOTS; i++) {
+        if (slots[i].decoder) allocated++;
+    }
+    out.printf("MP3P:inuse %d,alloc %d/%d (%d SRAM),psram %luB/%luB,sram %luB/%luB,peak %d\n",
+               countInUse(), allocated, MP3_POOL_SLOTS, countSram(),
+               poolBytes, (uint32_t)MP3_POOL_PSRAM_BUDGET, sramBytes, (uint32_t)MP3_POOL_SRAM_BUDGET, peakInUse);
+    out.printf("MP3P:decoder object %uB + Helix state %luB,stream resets %lu\n",
+               (unsigned)sizeof(MP3DecoderHelix), helixStateBytes, streamResets);
+    for (int p = 1; p >= 0; p--) {
+        FrameTiming* t = &frameTiming[p];
+        if (t->frames == 0) continue;
+        out.printf("MP3P:frame decode %s avg %lu us, max %lu us (%lu frames)\n",
+                   p ? "SRAM " : "PSRAM", t->us / t->frames, t->maxFrameUs, t->frames);
+    }
+    out.printf("MP3P:steals %lu,waits %lu,timeouts %lu,allocfail %lu\n",
+               steals, waits, waitTimeouts, allocFailures);
+    out.printf("MP3P:cpu %lu MHz,decode load %d%%\n", rp2040.f_cpu() / 1000000, lastLoadPct);
+    for (int n = 1; n <= MP3_POOL_SLOTS; n++) {
+        if (peakLoadAt[n] > 0) {
+            out.printf("MP3P:  %d decoder%s -> peak load %d%%\n", n, n == 1 ? " " : "s", peakLoadAt[n]);
+        }
+    }
+}
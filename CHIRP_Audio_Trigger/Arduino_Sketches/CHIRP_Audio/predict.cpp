@@ -0,0 +1,253 @@
+#include "config.h"
+
+// =================================================================================
+//  NEXT-SOUND PREDICTION (PRED command)
+// =================================================================================
+// Droid sessions repeat themselves: a given vocal tends to be followed by the
+// same few others, and music follows a playlist. Every trigger (PLAY, trigger
+// pins, the MP3 Trigger track commands) is recorded as a transition from the
+// previous one, and for each sound the model keeps its PREDICT_TOPK most
+// frequent successors. On a trigger, the likeliest successors that live on
+// SD are handed to the pre-roll cache (preroll_cache.cpp), which loads them
+// in idle I/O time, so the next trigger of one of them starts from PSRAM.
+//
+// Sounds are keyed by bank/page/index (SOUND_KEY, root tracks are bank 0), so the model
+// stays valid across SD edits that keep the numbering. Counts are 8-bit and a
+// row is halved when one saturates, which also lets old habits fade.
+//
+// The model is saved to flash (PREDICT_FILE) so it survives a reboot. Writing
+// flash stalls XIP on both cores, so a save only happens when nothing is
+// playing, and at most every PREDICT_SAVE_MS.
+
+#define PREDICT_FILE "/predict.bin"
+#define PREDICT_MAGIC 0x44455250  // "PRED"
+#define PREDICT_VERSION 1
+#define PREDICT_SAVE_MS 300000    // 5 min
+#define PREDICT_SESSION_GAP_MS 600000 // Triggers further apart aren't a transition
+#define PREDICT_MIN_COUNT 2       // Seen at least this often before it's prefetched
+
+struct PredictRow {
+    uint32_t key;            // SOUND_KEY, 0 = empty
+    uint32_t lastSeen;       // Trigger counter, for row replacement
+    uint32_t next[PREDICT_TOPK];
+    uint8_t count[PREDICT_TOPK];
+};
+
+struct PredictFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t rows;
+    uint32_t triggers;
+};
+
+static PredictRow rows[PREDICT_SOUNDS];
+static uint32_t triggers = 0;       // Also the model's clock
+static uint32_t prevKey = 0;
+static uint32_t prevAt = 0;         // millis() of the previous trigger
+static bool dirty = false;
+static uint32_t lastSave = 0;
+
+// Stats
+static uint32_t predictedRight = 0; // Trigger was among the previous sound's top-k
+static uint32_t transitions = 0;
+static uint32_t prefetches = 0;
+
+static PredictRow* findRow(uint32_t key) {
+    for (int i = 0; i < PREDICT_SOUNDS; i++) {
+        if (rows[i].key == key) return &rows[i];
+    }
+    return nullptr;
+}
+
+static PredictRow* getRow(uint32_t key) {
+    PredictRow* r = findRow(key);
+    if (r) return r;
+
+    // Empty row, else the one triggered longest ago
+    r = &rows[0];
+    for (int i = 0; i < PREDICT_SOUNDS; i++) {
+        if (rows[i].key == 0) {
+            r = &rows[i];
+            break;
+        }
+        if ((int32_t)(rows[i].lastSeen - r->lastSeen) < 0) r = &rows[i];
+    }
+    memset(r, 0, sizeof(*r));
+    r->key = key;
+    return r;
+}
+
+static void addTransition(PredictRow* r, uint32_t next) {
+    int slot = -1;
+    for (int k = 0; k < PREDICT_TOPK; k++) {
+        if (r->next[k] == next) {
+            slot = k;
+            break;
+        }
+    }
+    if (slot < 0) {
+        // Replace the weakest successor
+        slot = 0;
+        for (int k = 1; k < PREDICT_TOPK; k++) {
+            if (r->count[k] < r->count[slot]) slot = k;
+        }
+        r->next[slot] = next;
+        r->count[slot] = 0;
+    }
+    if (r->count[slot] == 255) {
+        for (int k = 0; k < PREDICT_TOPK; k++) r->count[k] >>= 1;
+    }
+    r->count[slot]++;
+}
+
+// SD path of a sound, or false (Bank 1 lives on flash, nothing to prefetch)
+bool soundKeyPath(uint32_t key, char* path, size_t len) {
+    int bank = (key >> 24) & 0x7F;
+    char page = (char)((key >> 16) & 0xFF);
+    int index = key & 0xFFFF;
+    if (bank == 0) {
+        const Catalog* cat = catalog();
+        if (index >= cat->rootTrackCount) return false;
+        snprintf(path, len, "/%s", cat->rootTracks[index]);
+        return true;
+    }
+    if (bank < 2) return false;
+    return resolveSoundPath(bank, page, index, path, len) == nullptr;
+}
+
+// ===================================
+// Record (PLAY, trigger pins, root tracks)
+// ===================================
+// bank 0 = root track (index 0-based), else bank/page/index as PLAY takes them
+void noteSoundTrigger(int bank, char page, int index) {
+    uint32_t key = SOUND_KEY(bank, page, index);
+    triggers++;
+    noteHotSound(key);
+
+    if (prevKey && prevKey != key && millis() - prevAt < PREDICT_SESSION_GAP_MS) {
+        PredictRow* prev = getRow(prevKey);
+        for (int k = 0; k < PREDICT_TOPK; k++) {
+            if (prev->next[k] == key && prev->count[k] >= PREDICT_MIN_COUNT) {
+                predictedRight++;
+                break;
+            }
+        }
+        transitions++;
+        prev->lastSeen = triggers;
+        addTransition(prev, key);
+        dirty = true;
+    }
+    prevKey = key;
+    prevAt = millis();
+
+    // Prefetch this sound's likeliest successors, best first
+    PredictRow* r = findRow(key);
+    if (!r) return;
+    r->lastSeen = triggers;
+    bool done[PREDICT_TOPK] = { false };
+    for (int n = 0; n < PREDICT_TOPK; n++) {
+        int best = -1;
+        for (int k = 0; k < PREDICT_TOPK; k++) {
+            if (done[k] || r->count[k] < PREDICT_MIN_COUNT) continue;
+            if (best < 0 || r->count[k] > r->count[best]) best = k;
+        }
+        if (best < 0) break;
+        done[best] = true;
+        char path[128];
+        if (soundKeyPath(r->next[best], path, sizeof(path)) && requestPreroll(path, true)) prefetches++;
+    }
+}
+
+// ===================================
+// Persistence (flash)
+// ===================================
+void loadPredictModel() {
+    mutex_enter_blocking(&flash_mutex);
+    File f = LittleFS.open(PREDICT_FILE, "r");
+    if (f) {
+        PredictFileHeader h;
+        if (f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && h.magic == PREDICT_MAGIC &&
+            h.version == PREDICT_VERSION && h.rows == PREDICT_SOUNDS &&
+            f.read((uint8_t*)rows, sizeof(rows)) == sizeof(rows)) {
+            triggers = h.triggers;
+        } else {
+            memset(rows, 0, sizeof(rows)); // Old format or torn write: start over
+        }
+        f.close();
+    }
+    mutex_exit(&flash_mutex);
+
+    int used = 0;
+    for (int i = 0; i < PREDICT_SOUNDS; i++) {
+        if (rows[i].key) used++;
+    }
+    Serial.printf("  Prediction model: %d/%d sounds, %lu triggers\n", used, PREDICT_SOUNDS, triggers);
+}
+
+static bool savePredictModel() {
+    PredictFileHeader h = { PREDICT_MAGIC, PREDICT_VERSION, PREDICT_SOUNDS, triggers };
+    mutex_enter_blocking(&flash_mutex);
+    File f = LittleFS.open(PREDICT_FILE, "w");
+    bool ok = f && f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+              f.write((const uint8_t*)rows, sizeof(rows)) == sizeof(rows);
+    if (f) f.close();
+    mutex_exit(&flash_mutex);
+    if (!ok) log_message("PRED: ERROR - could not save the model");
+    return ok;
+}
+
+// Core 0 housekeeping: save when changed, and only while silent
+void servicePredictModel() {
+    if (!dirty || millis() - lastSave < PREDICT_SAVE_MS) return;
+    for (int i = 0; i < MAX_VOICES; i++) {
+        if (streams[i].active || streams[i].waitingForDecoder) return;
+    }
+    if (savePredictModel()) dirty = false;
+    lastSave = millis();
+}
+
+// PRED:C. The empty model is saved by servicePredictModel() as soon as
+// nothing is playing (not after the usual PREDICT_SAVE_MS), so it stays
+// cleared without a flash write during playback.
+void clearPredictModel() {
+    memset(rows, 0, sizeof(rows));
+    triggers = 0;
+    prevKey = 0;
+    dirty = true;
+    lastSave = millis() - PREDICT_SAVE_MS;
+}
+
+// ===================================
+// Status (PRED command)
+// ===================================
+void printPredictStatus(Print& out, bool listModel) {
+    int used = 0;
+    for (int i = 0; i < PREDICT_SOUNDS; i++) {
+        if (rows[i].key) used++;
+    }
+    out.printf("PRED:model %d/%d sounds,triggers %lu,transitions %lu,predicted %lu (%lu%%),prefetches %lu%s\n",
+               used, PREDICT_SOUNDS, triggers, transitions, predictedRight,
+               transitions ? predictedRight * 100 / transitions : 0, prefetches, dirty ? ",unsaved" : "");
+    printPrerollStatus(out, listModel);
+    if (!listModel) return;
+    for (int i = 0; i < PREDICT_SOUNDS; i++) {
+        PredictRow* r = &rows[i];
+        if (!r->key) continue;
+        out.printf("PRED:%d,%c,%d ->", (int)((r->key >> 24) & 0x7F), (r->key >> 16) & 0xFF ? (char)((r->key >> 16) & 0xFF) : '0',
+                   (int)(r->key & 0xFFFF));
+        for (int k = 0; k < PREDICT_TOPK; k++) {
+            uint32_t n = r->next[k];
+            if (!r->count[k]) continue;
+            out.printf(" %d,%c,%d x%u", (int)((n >> 24) & 0x7F), (n >> 16) & 0xFF ? (char)((n >> 16) & 0xFF) : '0',
+                       (int)(n & 0xFFFF), r->count[k]);
+        }
+        out.println();
+    }
+}
+
+void resetPredictStats() {
+    predictedRight = 0;
+    transitions = 0;
+    prefetches = 0;
+    resetPrerollStats();
+}
@@ -0,0 +1,311 @@
+#include "config.h"
+
+// =================================================================================
+//  PSRAM PRE-ROLL CACHE
+// =================================================================================
+// Holds the first PREROLL_SLOT_KB of SD sounds that are likely to be played
+// next (predict.cpp picks them). When one of them is started, startStream()
+// still opens the file (the stream carries on from SD), but the refill takes
+// the cached bytes from PSRAM first and the file is seeked past them. So the
+// prebuffer, and the first few hundred ms of a WAV or seconds of an MP3,
+// need no card reads at all, and a trigger doesn't queue behind other
+// streams' refills for its first data.
+//
+// Slots are filled a chunk at a time from a housekeeping task, at
+// SDIO_PREFETCH, and only while no playing ring is low. A slot that a stream
+// is still reading from is never reused. WAV and MP3 on SD only: QOA reads
+// whole frames straight from the file, and Bank 1 is on flash or resident.
+//
+// A slot is matched by path, and then by the file's size and modify time as
+// they were when it was filled: a file replaced under the same name is a
+// miss (and the slot is dropped), so a cached head is never spliced onto
+// another file's body. A catalog rescan that finds the card changed flushes
+// the whole cache.
+
+#define PREROLL_SLOT_BYTES (PREROLL_SLOT_KB * 1024)
+#define PREROLL_LOAD_CHUNK 8192  // Bytes read per service call
+#define PREROLL_QUEUE 4          // Requests waiting for a slot
+
+struct PrerollSlot {
+    uint32_t hash;      // FNV-1a of the path, 0 = empty
+    char path[64];
+    uint32_t bytes;     // Loaded so far (whole file if shorter than a slot)
+    uint32_t fileSize;  // The file it came from, checked at attach
+    uint32_t modified;  // FAT modify date << 16 | time
+    bool ready;
+    bool predicted;     // Requested by the model rather than a warm-up
+    bool used;          // Hit since it was filled
+    uint32_t lastUsed;  // millis()
+};
+
+static uint8_t* cacheArena = nullptr;
+static PrerollSlot cacheSlots[PREROLL_SLOTS];
+
+// Loader
+static int loadSlot = -1;
+static FsFile loadFile;
+static char queuePaths[PREROLL_QUEUE][64];
+static bool queuePredicted[PREROLL_QUEUE];
+static int queueCount = 0;
+
+// Stats (PRED)
+static uint32_t lookups = 0;        // WAV/MP3 starts from SD
+static uint32_t hits = 0;
+static uint32_t predictedHits = 0;  // Hits on slots the model asked for
+static uint32_t fills = 0;
+static uint32_t wasted = 0;         // Predicted slots evicted without a hit
+static uint32_t fillFailures = 0;
+static uint32_t staleMisses = 0;    // Path matched, file had changed
+
+static uint8_t* slotData(int i) {
+    return cacheArena + (uint32_t)i * PREROLL_SLOT_BYTES;
+}
+
+static bool slotInUse(int i) {
+    if (i == loadSlot) return true;
+    const uint8_t* start = slotData(i);
+    for (int v = 0; v < MAX_VOICES; v++) {
+        const uint8_t* p = streams[v].prerollData;
+        if (streams[v].prerollLeft && p >= start && p < start + PREROLL_SLOT_BYTES) return true;
+    }
+    return false;
+}
+
+static int findSlot(uint32_t hash) {
+    for (int i = 0; i < PREROLL_SLOTS; i++) {
+        if (cacheSlots[i].hash == hash) return i;
+    }
+    return -1;
+}
+
+// ===================================
+// Init (setup)
+// ===================================
+void initPrerollCache() {
+    if (!BoardProfile::hasPsram) {
+        Serial.println("  Pre-roll cache: needs PSRAM, disabled");
+        return;
+    }
+    cacheArena = (uint8_t*)memAllocPsram(PREROLL_SLOTS * PREROLL_SLOT_BYTES, MEM_TAG_PREROLL);
+    if (!cacheArena) {
+        Serial.println("  Pre-roll cache: PSRAM allocation failed, disabled");
+        return;
+    }
+    Serial.printf("  Pre-roll cache: %d x %dKB in PSRAM\n", PREROLL_SLOTS, PREROLL_SLOT_KB);
+}
+
+// ===================================
+// Request (model / warm-up)
+// ===================================
+// Queue an SD path to be cached. Returns false if there is no cache, the
+// path is already cached or queued, or the queue is full.
+bool requestPreroll(const char* path, bool predicted) {
+    if (!cacheArena || strncmp(path, "/flash/", 7) == 0) return false;
+    const char* ext = strrchr(path, '.');
+    if (!ext || !(strcasecmp(ext, ".wav") == 0 || strcasecmp(ext, ".mp3") == 0)) return false;
+
+    int slot = findSlot(pathHash(path));
+    if (slot >= 0) {
+        cacheSlots[slot].lastUsed = millis(); // Wanted again: keep it
+        return false;
+    }
+    for (int i = 0; i < queueCount; i++) {
+        if (strcmp(queuePaths[i], path) == 0) return false;
+    }
+    if (queueCount >= PREROLL_QUEUE) return false;
+    strncpy(queuePaths[queueCount], path, sizeof(queuePaths[0]) - 1);
+    queuePaths[queueCount][sizeof(queuePaths[0]) - 1] = '\0';
+    queuePredicted[queueCount] = predicted;
+    queueCount++;
+    return true;
+}
+
+bool isPrerollBusy() {
+    return loadSlot >= 0 || queueCount > 0;
+}
+
+// ===================================
+// Service (Core 0 housekeeping task)
+// ===================================
+static void finishLoad(bool ok) {
+    sdBegin(SDIO_PREFETCH);
+    loadFile.close();
+    sdEnd();
+    PrerollSlot* sl = &cacheSlots[loadSlot];
+    if (ok) {
+        sl->ready = true;
+        fills++;
+    } else {
+        sl->hash = 0;
+        fillFailures++;
+    }
+    loadSlot = -1;
+}
+
+static void startNextLoad() {
+    char path[64];
+    strcpy(path, queuePaths[0]);
+    bool predicted = queuePredicted[0];
+    queueCount--;
+    memmove(queuePaths[0], queuePaths[1], queueCount * sizeof(queuePaths[0]));
+    memmove(&queuePredicted[0], &queuePredicted[1], queueCount * sizeof(queuePredicted[0]));
+
+    // Empty slot, else the least recently used one nobody is reading
+    int victim = -1;
+    for (int i = 0; i < PREROLL_SLOTS; i++) {
+        if (slotInUse(i)) continue; // Even if flushed: a stream is still reading it
+        if (cacheSlots[i].hash == 0) {
+            victim = i;
+            break;
+        }
+        if (victim < 0 || (int32_t)(cacheSlots[i].lastUsed - cacheSlots[victim].lastUsed) < 0) victim = i;
+    }
+    if (victim < 0) return;
+    PrerollSlot* sl = &cacheSlots[victim];
+    if (sl->hash && sl->predicted && !sl->used) wasted++;
+
+    sdBegin(SDIO_PREFETCH);
+    loadFile = sd.open(path, FILE_READ);
+    sdEnd();
+    if (!loadFile) {
+        sl->hash = 0;
+        fillFailures++;
+        return;
+    }
+
+    sl->hash = pathHash(path);
+    strcpy(sl->path, path);
+    sl->bytes = 0;
+    sl->fileSize = loadFile.fileSize();
+    sl->modified = sdFileStamp(loadFile);
+    sl->ready = false;
+    sl->predicted = predicted;
+    sl->used = false;
+    sl->lastUsed = millis();
+    loadSlot = victim;
+}
+
+void servicePrerollCache() {
+    if (!cacheArena) return;
+    if (audioRefillUrgent()) return; // Idle I/O only
+
+    if (loadSlot < 0) {
+        if (queueCount > 0) startNextLoad();
+        return;
+    }
+
+    PrerollSlot* sl = &cacheSlots[loadSlot];
+    uint32_t want = PREROLL_SLOT_BYTES - sl->bytes;
+    if (want > PREROLL_LOAD_CHUNK) want = PREROLL_LOAD_CHUNK;
+    int r = sdRead(loadFile, slotData(loadSlot) + sl->bytes, want, SDIO_PREFETCH);
+    if (r < 0) {
+        finishLoad(false);
+        return;
+    }
+    sl->bytes += r;
+    if ((uint32_t)r < want || sl->bytes == PREROLL_SLOT_BYTES) finishLoad(true);
+}
+
+// ===================================
+// Attach / Read (startStream, refill)
+// ===================================
+// Called by startStream with the SD file open, positioned at the first audio
+// byte, and the card held. On a hit the stream reads the cached part first
+// and the file is moved past it.
+bool attachPreroll(AudioStream* s, const char* filename) {
+    if (!cacheArena || (s->type != STREAM_TYPE_WAV_SD && s->type != STREAM_TYPE_MP3_SD)) return false;
+    lookups++;
+
+    int i = findSlot(pathHash(filename));
+    if (i < 0 || !cacheSlots[i].ready || strcmp(cacheSlots[i].path, filename) != 0) return false;
+    PrerollSlot* sl = &cacheSlots[i];
+    if (sl->fileSize != s->sdFile.fileSize() || sl->modified != sdFileStamp(s->sdFile)) {
+        staleMisses++;
+        sl->hash = 0; // Another file now; slotInUse() still guards any reader
+        return false;
+    }
+
+    uint32_t pos = s->sdFile.curPosition();
+    if (pos >= sl->bytes) return false;
+    uint32_t avail = sl->bytes - pos;
+    if (s->type == STREAM_TYPE_WAV_SD) {
+        if (avail > s->dataRemaining) avail = s->dataRemaining;
+        avail -= avail % s->blockAlign; // Refill reads whole frames
+    }
+    if (avail == 0 || !s->sdFile.seekSet(pos + avail)) return false;
+
+    s->prerollData = slotData(i) + pos;
+    s->prerollLeft = avail;
+    sl->used = true;
+    sl->lastUsed = millis();
+    hits++;
+    if (sl->predicted) predictedHits++;
+    return true;
+}
+
+// Drop every slot (catalog rescan found the card changed). Streams already
+// reading a slot carry on; the slot isn't reused until they're done.
+void flushPrerollCache() {
+    if (!cacheArena) return;
+    if (loadSlot >= 0) {
+        sdBegin(SDIO_PREFETCH);
+        loadFile.close();
+        sdEnd();
+        loadSlot = -1;
+    }
+    for (int i = 0; i < PREROLL_SLOTS; i++) cacheSlots[i].hash = 0;
+    log_message("Pre-roll: cache flushed (card changed)");
+}
+
+// Up to n cached bytes for the refill (no locks, no I/O)
+int takePreroll(AudioStream* s, uint8_t* buf, uint32_t n) {
+    if (n > s->prerollLeft) n = s->prerollLeft;
+    memcpy(buf, s->prerollData, n);
+    s->prerollData += n;
+    s->prerollLeft -= n;
+    return n;
+}
+
+// Skip cached bytes (resume seek); returns how many were skipped
+uint32_t skipPreroll(AudioStream* s, uint32_t bytes) {
+    if (bytes > s->prerollLeft) bytes = s->prerollLeft;
+    s->prerollData += bytes;
+    s->prerollLeft -= bytes;
+    return bytes;
+}
+
+// ===================================
+// Status (PRED command)
+// ===================================
+void printPrerollStatus(Print& out, bool listSlots) {
+    if (!cacheArena) {
+        out.println("PRED:cache off (no PSRAM)");
+        return;
+    }
+    int ready = 0;
+    for (int i = 0; i < PREROLL_SLOTS; i++) {
+        if (cacheSlots[i].hash && cacheSlots[i].ready) ready++;
+    }
+    out.printf("PRED:cache %d/%d slots x %dKB,loading %s,queued %d\n", ready, PREROLL_SLOTS, PREROLL_SLOT_KB,
+               loadSlot >= 0 ? cacheSlots[loadSlot].path : "-", queueCount);
+    out.printf("PRED:hit rate %lu/%lu (%lu%%),predicted hits %lu,fills %lu,wasted %lu,failed %lu,stale %lu\n",
+               hits, lookups, lookups ? hits * 100 / lookups : 0, predictedHits, fills, wasted, fillFailures,
+               staleMisses);
+    if (!listSlots) return;
+    for (int i = 0; i < PREROLL_SLOTS; i++) {
+        PrerollSlot* sl = &cacheSlots[i];
+        if (!sl->hash) continue;
+        out.printf("PRED:slot %2d %5luB %s%s%s %s\n", i, sl->bytes, sl->ready ? "ready" : "loading",
+                   sl->predicted ? ",predicted" : "", sl->used ? ",hit" : "", sl->path);
+    }
+}
+
+void resetPrerollStats() {
+    lookups = 0;
+    hits = 0;
+    predictedHits = 0;
+    fills = 0;
+    wasted = 0;
+    fillFailures = 0;
+    staleMisses = 0;
+}
@@ -0,0 +1,229 @@
+#include "config.h"
+#include "hardware/timer.h"
+#include "hardware/irq.h"
+
+// =================================================================================
+//  SAMPLING PROFILER (PROF command)
+// =================================================================================
+// A statistical profiler that needs no special firmware build. Each core
+// claims a spare timer alarm at boot (profilerInitCore()) and enables its IRQ
+// on that core only. While PROF is on, the alarm fires every periodUs and the
+// handler records the interrupted PC and LR from the exception frame into
+// that core's sample buffer. PROF:D dumps the raw addresses and
+// tools/chirp_prof.py maps them onto the ELF's symbols, giving a flat
+// profile (where the PC was) and a caller profile (who called it, from LR).
+//
+// Off costs nothing: the alarms are disarmed and the buffers are freed. On,
+// each sample is a few dozen cycles (handler time is measured with the cycle
+// counter and shown by PROF). Sampling stops by itself when a buffer fills
+// (PROF then says "full").
+//
+//   PROF:ON[,us]   clear and start (default PROF_DEFAULT_PERIOD_US)
+//   PROF:OFF       stop (samples are kept for PROF:D)
+//   PROF           status
+//   PROF:D         dump "PROF:core,pc,lr" lines, then "PROF:END,n" (and free)
+//
+// Two full buffers are ~8k lines, far too much to print in one go without
+// starving the refill, so PROF:D only starts the dump: the "profdump" task
+// prints PROF_DUMP_LINES per run until it's done.
+
+#define PROF_SAMPLES_PER_CORE 4096
+#define PROF_DEFAULT_PERIOD_US 500  // 2kHz: a full buffer is ~2s
+#define PROF_MIN_PERIOD_US 50
+#define PROF_DUMP_LINES 32          // Per profdump run (~1KB of serial)
+
+struct ProfSample {
+    uint32_t pc;
+    uint32_t lr;
+};
+
+struct ProfCore {
+    int alarm;                   // -1 = none claimed
+    ProfSample* samples;
+    volatile uint32_t count;
+    volatile uint32_t dropped;   // Buffer full
+    volatile uint32_t handlerCycles;
+};
+
+static ProfCore profCores[2] = { { -1, nullptr, 0, 0, 0 }, { -1, nullptr, 0, 0, 0 } };
+static volatile bool profRunning = false;
+static volatile uint32_t profPeriodUs = PROF_DEFAULT_PERIOD_US;
+static uint32_t profStartMs = 0;
+static uint32_t profStopMs = 0;
+
+// PROF:D in progress
+static Print* dumpOut = nullptr;
+static int dumpCore = 0;
+static uint32_t dumpIdx = 0;
+static uint32_t dumpTotal = 0;
+
+// ===================================
+// Interrupt
+// ===================================
+// frame = the hardware-stacked r0-r3, r12, lr, pc, xpsr of the interrupted code
+extern "C" void __not_in_flash_func(profSample)(uint32_t* frame) {
+    uint32_t c0 = rp2040.getCycleCount();
+    ProfCore* pc = &profCores[get_core_num()];
+    int alarm = pc->alarm;
+    timer_hw->intr = 1u << alarm; // Acknowledge
+
+    if (!profRunning) return;
+    uint32_t n = pc->count;
+    if (n < PROF_SAMPLES_PER_CORE) {
+        pc->samples[n].pc = frame[6];
+        pc->samples[n].lr = frame[5];
+        pc->count = n + 1;
+        timer_hw->alarm[alarm] = timer_hw->timerawl + profPeriodUs; // Re-arm
+    } else {
+        pc->dropped++; // Full: leave the alarm disarmed
+    }
+    pc->handlerCycles += rp2040.getCycleCount() - c0;
+}
+
+// Pick the stack the interrupted code was using (EXC_RETURN bit 2) and hand
+// its frame to profSample; LR still holds EXC_RETURN, so its return is ours.
+extern "C" void __attribute__((naked)) __not_in_flash_func(profIrqEntry)() {
+    __asm volatile(
+        "tst lr, #4      \n"
+        "ite eq          \n"
+        "mrseq r0, msp   \n"
+        "mrsne r0, psp   \n"
+        "b profSample    \n");
+}
+
+// ===================================
+// Init (setup on Core 0, setup1 on Core 1)
+// ===================================
+void profilerInitCore() {
+    ProfCore* pc = &profCores[get_core_num()];
+    if (pc->alarm >= 0) return;
+    int alarm = hardware_alarm_claim_unused(false);
+    if (alarm < 0) {
+        Serial.printf("Profiler: no free timer alarm for core %d\n", get_core_num());
+        return;
+    }
+    uint irq = hardware_alarm_get_irq_num(alarm);
+    irq_set_exclusive_handler(irq, profIrqEntry);
+    hw_set_bits(&timer_hw->inte, 1u << alarm);
+    irq_set_enabled(irq, true); // NVIC of the calling core only
+    pc->alarm = alarm;
+}
+
+// ===================================
+// Control (PROF command)
+// ===================================
+bool startProfiler(uint32_t periodUs) {
+    if (dumpOut) {
+        log_message("PROF: ERROR - dump in progress");
+        return false;
+    }
+    stopProfiler();
+    if (periodUs == 0) periodUs = PROF_DEFAULT_PERIOD_US;
+    if (periodUs < PROF_MIN_PERIOD_US) periodUs = PROF_MIN_PERIOD_US;
+    profPeriodUs = periodUs;
+
+    for (int c = 0; c < 2; c++) {
+        ProfCore* pc = &profCores[c];
+        if (pc->alarm < 0) continue;
+        if (!pc->samples) {
+            pc->samples = (ProfSample*)memAllocPsram(PROF_SAMPLES_PER_CORE * sizeof(ProfSample), MEM_TAG_SCRATCH);
+            if (!pc->samples) {
+                log_message("PROF: ERROR - no memory for samples");
+                return false;
+            }
+        }
+        pc->count = 0;
+        pc->dropped = 0;
+        pc->handlerCycles = 0;
+    }
+
+    profStartMs = millis();
+    profRunning = true;
+    uint32_t now = timer_hw->timerawl;
+    for (int c = 0; c < 2; c++) {
+        // Stagger the cores so the two handlers don't always collide
+        if (profCores[c].samples) timer_hw->alarm[profCores[c].alarm] = now + periodUs + c * (periodUs / 2);
+    }
+    return true;
+}
+
+void stopProfiler() {
+    if (!profRunning) return;
+    profRunning = false;
+    for (int c = 0; c < 2; c++) {
+        if (profCores[c].alarm >= 0) timer_hw->armed = 1u << profCores[c].alarm; // Disarm
+    }
+    profStopMs = millis();
+}
+
+// Free the sample buffers (after a dump)
+static void releaseProfiler() {
+    stopProfiler();
+    for (int c = 0; c < 2; c++) {
+        memFree(profCores[c].samples);
+        profCores[c].samples = nullptr;
+        profCores[c].count = 0;
+    }
+}
+
+// Every core that samples has filled its buffer (its alarm is no longer re-armed)
+static bool profilerFull() {
+    bool any = false;
+    for (int c = 0; c < 2; c++) {
+        ProfCore* pc = &profCores[c];
+        if (!pc->samples) continue;
+        if (pc->count < PROF_SAMPLES_PER_CORE) return false;
+        any = true;
+    }
+    return any;
+}
+
+void printProfilerStatus(Print& out) {
+    bool full = profRunning && profilerFull();
+    const char* state = dumpOut ? "dumping" : full ? "full" : profRunning ? "running" : "stopped";
+    uint32_t ms = (profRunning ? millis() : profStopMs) - profStartMs;
+    if (full) ms = PROF_SAMPLES_PER_CORE * profPeriodUs / 1000; // Until it filled, not until now
+    out.printf("PROF:%s,period %luus,for %lums\n", state, profPeriodUs,
+               profCores[0].samples || profCores[1].samples ? ms : 0);
+    for (int c = 0; c < 2; c++) {
+        ProfCore* pc = &profCores[c];
+        if (pc->alarm < 0) {
+            out.printf("PROF:core %d no alarm\n", c);
+            continue;
+        }
+        uint32_t avg = pc->count ? pc->handlerCycles / pc->count : 0;
+        out.printf("PROF:core %d alarm %d,samples %lu/%d,full %lu,handler avg %lu cyc\n",
+                   c, pc->alarm, pc->count, PROF_SAMPLES_PER_CORE, pc->dropped, avg);
+    }
+}
+
+// PROF:D: stops sampling and starts the dump; serviceProfilerDump() prints
+// it and frees the buffers at the end
+void dumpProfile(Print& out) {
+    if (dumpOut) return; // Already dumping
+    stopProfiler(); // Don't write into what we're reading
+    dumpOut = &out;
+    dumpCore = 0;
+    dumpIdx = 0;
+    dumpTotal = 0;
+}
+
+// Scheduler task ("profdump")
+void serviceProfilerDump() {
+    if (!dumpOut) return;
+    for (int lines = 0; lines < PROF_DUMP_LINES; lines++) {
+        while (dumpCore < 2 && (!profCores[dumpCore].samples || dumpIdx >= profCores[dumpCore].count)) {
+            dumpCore++;
+            dumpIdx = 0;
+        }
+        if (dumpCore >= 2) {
+            dumpOut->printf("PROF:END,%lu\n", dumpTotal);
+            dumpOut = nullptr;
+            releaseProfiler();
+            return;
+        }
+        ProfSample* s = &profCores[dumpCore].samples[dumpIdx++];
+        dumpOut->printf("PROF:%d,%08lx,%08lx\n", dumpCore, s->pc, s->lr);
+        dumpTotal++;
+    }
+}
@@ -0,0 +1,174 @@
+#include "config.h"
+#include "dsp_kernels.h"
+
+// =================================================================================
+//  QOA DECODER
+// =================================================================================
+// QOA ("Quite OK Audio", qoaformat.org) is a fixed 3.2 bits/sample lossy
+// format: roughly 5x smaller than 16-bit WAV on the card, but decoding is just
+// a 4-tap LMS predictor plus a table lookup per sample, so CPU cost stays close
+// to WAV. Files are made with tools/wav2qoa.py.
+//
+// Layout (all values big-endian):
+//   file header : "qoaf", uint32 samples per channel
+//   frame header: uint8 channels, uint24 samplerate, uint16 samples per channel,
+//                 uint16 frame size in bytes (including this header)
+//   LMS state   : per channel, 4x int16 history then 4x int16 weights
+//   slices      : 64-bit words interleaved by channel, each a 4-bit scalefactor
+//                 followed by 20 x 3-bit quantized residuals
+// Every frame carries its own predictor state, so frames decode independently.
+
+#define QOA_MAGIC 0x716f6166 // "qoaf"
+#define QOA_SLICE_LEN 20
+#define QOA_ROWS_PER_CHUNK 16 // Slice rows decoded before each ring write
+
+struct QoaLms {
+    int32_t history[4];
+    int32_t weights[4];
+};
+
+// round(scalefactor * {0.75, -0.75, 2.5, -2.5, 4.5, -4.5, 7, -7}),
+// scalefactor = round((sf + 1) ^ 2.75)
+static const int16_t qoaDequantTab[16][8] = {
+    {1, -1, 3, -3, 5, -5, 7, -7},
+    {5, -5, 18, -18, 32, -32, 49, -49},
+    {16, -16, 53, -53, 95, -95, 147, -147},
+    {34, -34, 113, -113, 203, -203, 315, -315},
+    {63, -63, 210, -210, 378, -378, 588, -588},
+    {104, -104, 345, -345, 621, -621, 966, -966},
+    {158, -158, 528, -528, 950, -950, 1477, -1477},
+    {228, -228, 760, -760, 1368, -1368, 2128, -2128},
+    {316, -316, 1053, -1053, 1895, -1895, 2947, -2947},
+    {422, -422, 1405, -1405, 2529, -2529, 3934, -3934},
+    {548, -548, 1828, -1828, 3290, -3290, 5117, -5117},
+    {696, -696, 2320, -2320, 4176, -4176, 6496, -6496},
+    {868, -868, 2893, -2893, 5207, -5207, 8099, -8099},
+    {1064, -1064, 3548, -3548, 6386, -6386, 9933, -9933},
+    {1286, -1286, 4288, -4288, 7718, -7718, 12005, -12005},
+    {1536, -1536, 5120, -5120, 9216, -9216, 14336, -14336},
+};
+
+// Core 0 scratch: decoded interleaved PCM for a chunk of slice rows, and its
+// stereo 44.1k expansion
+static int16_t qoaPcm[QOA_ROWS_PER_CHUNK * QOA_SLICE_LEN * 2];
+alignas(4) static int16_t qoaOut[DSP_MAX_EXPAND_OUT]; // Word-copied into the ring
+
+static inline uint32_t readU32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint64_t readU64(const uint8_t* p) {
+    return ((uint64_t)readU32(p) << 32) | readU32(p + 4);
+}
+
+// ===================================
+// Open (startStream, card held as SDIO_OPEN)
+// ===================================
+// Checks the file header and takes channels/rate from the first frame,
+// leaving the file positioned at that frame.
+bool qoaOpen(AudioStream* s) {
+    uint8_t hdr[16];
+    if (s->sdFile.read(hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+    if (readU32(hdr) != QOA_MAGIC) return false;
+
+    uint8_t channels = hdr[8];
+    uint32_t rate = readU32(hdr + 8) & 0xFFFFFF;
+    if (channels < 1 || channels > 2 || rate == 0) return false;
+
+    s->channels = channels;
+    s->sampleRate = rate;
+    s->sdFile.seek(8);
+    return true;
+}
+
+// ===================================
+// Read One Frame (fillStreamBuffers, card held as SDIO_REFILL)
+// ===================================
+// Returns frame size in bytes, 0 at end of file, -1 if the frame is corrupt.
+int qoaReadFrame(FsFile& f, uint8_t* buf) {
+    int n = f.read(buf, 8);
+    if (n == 0) return 0;
+    if (n != 8) return -1;
+
+    uint8_t channels = buf[0];
+    int frameSize = (buf[6] << 8) | buf[7];
+    if (channels < 1 || channels > 2 || frameSize < 8 + 16 * channels || frameSize > QOA_MAX_FRAME_BYTES) {
+        return -1;
+    }
+    int rest = frameSize - 8;
+    if (f.read(buf + 8, rest) != rest) return -1;
+    return frameSize;
+}
+
+// ===================================
+// Decode One Frame into the Ring (fillStreamBuffers)
+// ===================================
+// Caller makes sure the ring has QOA_MAX_FRAME_OUT samples free.
+// Returns ring samples written, or -1 if the frame doesn't match the stream.
+int qoaDecodeFrame(AudioStream* s, const uint8_t* frame, int frameBytes) {
+    int channels = frame[0];
+    int samples = (frame[4] << 8) | frame[5];
+    if (channels != s->channels) return -1;
+
+    const uint8_t* p = frame + 8;
+    const uint8_t* end = frame + frameBytes;
+
+    // Predictor state for this frame
+    QoaLms lms[2];
+    for (int c = 0; c < channels; c++) {
+        for (int i = 0; i < 4; i++) lms[c].history[i] = (int16_t)((p[i * 2] << 8) | p[i * 2 + 1]);
+        for (int i = 0; i < 4; i++) lms[c].weights[i] = (int16_t)((p[8 + i * 2] << 8) | p[8 + i * 2 + 1]);
+        p += 16;
+    }
+
+    // Whole slices per channel (a partial last slice still takes one), and
+    // never more than a frame's worth: the caller only reserved that much
+    int numSlices = (end - p) / 8;
+    if (samples > QOA_FRAME_SAMPLES || (samples + QOA_SLICE_LEN - 1) / QOA_SLICE_LEN * channels > numSlices) return -1;
+
+    bool halfRate = (s->sampleRate == 22050);
+    int written = 0;
+    int rows = 0;
+    int pcmCount = 0;
+
+    for (int sampleIndex = 0; sampleIndex < samples; sampleIndex += QOA_SLICE_LEN) {
+        int rowLen = samples - sampleIndex;
+        if (rowLen > QOA_SLICE_LEN) rowLen = QOA_SLICE_LEN;
+
+        for (int c = 0; c < channels; c++) {
+            uint64_t slice = readU64(p);
+            p += 8;
+            const int16_t* dq = qoaDequantTab[(slice >> 60) & 0xF];
+            slice <<= 4;
+
+            QoaLms* l = &lms[c];
+            int16_t* out = &qoaPcm[pcmCount + c];
+            for (int k = 0; k < rowLen; k++) {
+                int32_t predicted = (l->history[0] * l->weights[0] + l->history[1] * l->weights[1] +
+                                     l->history[2] * l->weights[2] + l->history[3] * l->weights[3]) >> 13;
+                int32_t dequantized = dq[(slice >> 61) & 0x7];
+                int16_t reconstructed = dsp_sat16(predicted + dequantized);
+                slice <<= 3;
+
+                out[k * channels] = reconstructed;
+
+                int32_t delta = dequantized >> 4;
+                for (int i = 0; i < 4; i++) l->weights[i] += l->history[i] < 0 ? -delta : delta;
+                l->history[0] = l->history[1];
+                l->history[1] = l->history[2];
+                l->history[2] = l->history[3];
+                l->history[3] = reconstructed;
+            }
+        }
+        pcmCount += rowLen * channels;
+
+        // Hand a chunk of rows to the ring
+        if (++rows == QOA_ROWS_PER_CHUNK || sampleIndex + QOA_SLICE_LEN >= samples) {
+            int n = dsp_expand_to_stereo(qoaPcm, pcmCount, channels, halfRate, qoaOut, s->resampleCarry);
+            written += s->ringBuffer->writeBlock(qoaOut, n);
+            rows = 0;
+            pcmCount = 0;
+        }
+    }
+    return written;
+}
@@ -0,0 +1,164 @@
+#include "config.h"
+
+// =================================================================================
+//  CORE 0 COOPERATIVE SCHEDULER
+// =================================================================================
+// loop() used to call every job in a fixed order, so one slow job (a long LIST
+// dump, a blocking Serial2 write) pushed the next SD refill back by however
+// long it took. Now each job is a task with a priority class, a period and a
+// time budget, and runScheduler() is called from loop():
+//
+//   1. Every due TASK_PRIO_AUDIO task runs (the ring refill).
+//   2. If a playing stream's ring is below SCHED_LOW_WATER, that's it for this
+//      pass: audio keeps the core until it has caught up (housekeeping is
+//      still let through every SCHED_MAX_DEFER_MS so serial never starves).
+//   3. Otherwise ONE other due task runs, highest class first and the longest
+//      waiting within a class, and we go back to 1.
+//
+// Tasks can't be interrupted, so the budget is a contract, not a limit: a run
+// that takes longer than budgetUs is counted as an overrun (see TASK).
+
+#define SCHED_MAX_TASKS 12
+// Ring samples (~250ms stereo, or half the ring on a board with small rings)
+#define SCHED_LOW_WATER (SAMPLE_RATE / 2 < STREAM_BUFFER_SIZE / 2 ? SAMPLE_RATE / 2 : STREAM_BUFFER_SIZE / 2)
+#define SCHED_MAX_DEFER_MS 20              // Longest housekeeping may be held off
+
+struct SchedTask {
+    const char* name;
+    void (*fn)();
+    uint8_t priority;     // TASK_PRIO_*
+    uint32_t periodUs;    // 0 = every pass
+    uint32_t budgetUs;    // Expected worst case per run
+
+    uint32_t lastRun;     // micros() of the last start
+    uint32_t runs;
+    uint64_t totalUs;
+    uint32_t maxUs;
+    uint32_t overruns;
+    uint32_t maxLateUs;   // Worst start delay past its period
+};
+
+static SchedTask tasks[SCHED_MAX_TASKS];
+static int taskCount = 0;
+static uint32_t lastHousekeeping = 0; // millis()
+static uint32_t audioHolds = 0;       // Passes where low rings held housekeeping off
+static uint32_t passes = 0;                // Stat, TASK:R clears it
+static uint32_t epoch = 0;                 // Same count, never cleared (catalog grace period)
+
+// ===================================
+// Registration (setup)
+// ===================================
+bool addTask(const char* name, void (*fn)(), uint8_t priority, uint32_t periodUs, uint32_t budgetUs) {
+    if (taskCount >= SCHED_MAX_TASKS) {
+        Serial.printf("Scheduler: ERROR - no room for task %s\n", name);
+        return false;
+    }
+    SchedTask* t = &tasks[taskCount++];
+    memset(t, 0, sizeof(*t));
+    t->name = name;
+    t->fn = fn;
+    t->priority = priority;
+    t->periodUs = periodUs;
+    t->budgetUs = budgetUs;
+    t->lastRun = micros();
+    return true;
+}
+
+static bool isDue(SchedTask* t, uint32_t now) {
+    return t->periodUs == 0 || now - t->lastRun >= t->periodUs;
+}
+
+static void runTask(SchedTask* t) {
+    uint32_t start = micros();
+    if (t->periodUs > 0 && t->runs > 0) {
+        uint32_t late = start - t->lastRun - t->periodUs;
+        if ((int32_t)late > 0 && late > t->maxLateUs) t->maxLateUs = late;
+    }
+    t->lastRun = start;
+
+    t->fn();
+
+    uint32_t us = micros() - start;
+    t->runs++;
+    t->totalUs += us;
+    if (us > t->maxUs) t->maxUs = us;
+    if (t->budgetUs > 0 && us > t->budgetUs) t->overruns++;
+}
+
+// Any playing stream about to run dry? (also used by sd_io.cpp)
+bool audioRefillUrgent() {
+    for (int i = 0; i < MAX_VOICES; i++) {
+        AudioStream* s = &streams[i];
+        if (!s->active || s->paused || s->fileFinished) continue;
+        if (s->ringBuffer->availableForRead() < SCHED_LOW_WATER) return true;
+    }
+    return false;
+}
+
+// ===================================
+// Run (loop)
+// ===================================
+void runScheduler() {
+    passes++;
+    epoch++;
+
+    // 1. Audio first, every pass
+    uint32_t now = micros();
+    for (int i = 0; i < taskCount; i++) {
+        if (tasks[i].priority == TASK_PRIO_AUDIO && isDue(&tasks[i], now)) runTask(&tasks[i]);
+    }
+
+    // 2. Rings low: keep refilling unless housekeeping has waited too long
+    if (audioRefillUrgent() && millis() - lastHousekeeping < SCHED_MAX_DEFER_MS) {
+        audioHolds++;
+        return;
+    }
+    lastHousekeeping = millis();
+
+    // 3. One other task: best class, then longest waiting
+    now = micros();
+    SchedTask* pick = nullptr;
+    for (int i = 0; i < taskCount; i++) {
+        SchedTask* t = &tasks[i];
+        if (t->priority == TASK_PRIO_AUDIO || !isDue(t, now)) continue;
+        if (!pick || t->priority < pick->priority ||
+            (t->priority == pick->priority && (int32_t)(t->lastRun - pick->lastRun) < 0)) {
+            pick = t;
+        }
+    }
+    if (pick) runTask(pick);
+}
+
+// Monotonic pass counter for the catalog's grace period (catalog.cpp): no
+// task keeps a catalog pointer across passes. Not the TASK stat, which
+// TASK:R resets and could make a retired catalog look already waited out.
+uint32_t schedulerEpoch() {
+    return epoch;
+}
+
+// ===================================
+// Stats (TASK command)
+// ===================================
+void printTaskStats(Print& out) {
+    static const char* prioNames[] = { "audio", "ctrl", "house" };
+    out.printf("TASK:passes %lu,audio holds %lu\n", passes, audioHolds);
+    for (int i = 0; i < taskCount; i++) {
+        SchedTask* t = &tasks[i];
+        uint32_t avg = t->runs ? (uint32_t)(t->totalUs / t->runs) : 0;
+        out.printf("TASK:%-8s %-5s period %6luus budget %6luus runs %8lu avg %5luus max %6luus over %lu late %luus\n",
+                   t->name, prioNames[t->priority < 3 ? t->priority : 2], t->periodUs, t->budgetUs,
+                   t->runs, avg, t->maxUs, t->overruns, t->maxLateUs);
+    }
+}
+
+void resetTaskStats() {
+    for (int i = 0; i < taskCount; i++) {
+        tasks[i].runs = 0;
+        tasks[i].totalUs = 0;
+        tasks[i].maxUs = 0;
+        tasks[i].overruns = 0;
+        tasks[i].maxLateUs = 0;
+    }
+    passes = 0;
+    audioHolds = 0;
+}
@@ -0,0 +1,160 @@
+#include "config.h"
+
+// =================================================================================
+//  SD I/O ARBITRATION
+// =================================================================================
+// All SD access goes through sdBegin(class)/sdEnd() instead of taking
+// sd_mutex directly. Classes, most urgent first:
+//
+//   SDIO_REFILL    stream ring refill (fillStreamBuffers)
+//   SDIO_OPEN      stream start/stop, trigger opens, seeks
+//   SDIO_PREFETCH  cache / pre-roll fills
+//   SDIO_SCAN      catalog scans, CHIRP.INI
+//   SDIO_SYNC      Bank 1 -> flash copy
+//
+// Everything that touches the card runs on Core 0, so a higher class can
+// never be stuck behind the mutex itself; what hurts is a low class holding
+// the card (and the core) for a long stretch. So the low classes work in
+// bounded pieces:
+//   - sdRead() splits PREFETCH/SCAN/SYNC reads into SDIO_LOW_CHUNK pieces
+//   - sdYield() is called between steps of long jobs (directory walks)
+// and after each piece, if a playing ring is running low, the refill runs
+// right there before the low-priority job carries on.
+//
+// Per class: requests, time spent waiting for the card, time holding it,
+// bytes read, and how often the class stepped aside for a refill (SDIO).
+
+#define SDIO_LOW_CHUNK (8 * 1024)   // Largest single read for the low classes
+#define SDIO_MAX_HOLD_US 2000       // Low classes give the card up after this
+
+struct SdIoStats {
+    uint32_t requests;
+    uint64_t waitUs;
+    uint32_t maxWaitUs;
+    uint64_t holdUs;
+    uint32_t maxHoldUs;
+    uint32_t bytes;
+    uint32_t yields;
+};
+
+static SdIoStats ioStats[SDIO_CLASS_COUNT];
+static uint32_t refillGapMaxUs = 0; // Longest stretch between two refill reads with a ring low
+static uint32_t lastRefillEnd = 0;
+static int8_t heldClass = -1;
+static uint32_t holdStart = 0;
+static bool inAudioYield = false;
+
+static const char* classNames[SDIO_CLASS_COUNT] = {
+    "refill", "open", "prefetch", "scan", "sync"
+};
+
+// ===================================
+// Begin / End
+// ===================================
+void sdBegin(uint8_t cls) {
+    if (cls >= SDIO_CLASS_COUNT) cls = SDIO_SYNC;
+    uint32_t t0 = micros();
+    mutex_enter_blocking(&sd_mutex);
+    uint32_t now = micros();
+
+    SdIoStats* s = &ioStats[cls];
+    uint32_t wait = now - t0;
+    s->requests++;
+    s->waitUs += wait;
+    if (wait > s->maxWaitUs) s->maxWaitUs = wait;
+
+    // Only counts while a ring is low (a full ring needs no reads)
+    if (cls == SDIO_REFILL && lastRefillEnd != 0 && audioRefillUrgent()) {
+        uint32_t gap = now - lastRefillEnd;
+        if (gap > refillGapMaxUs) refillGapMaxUs = gap;
+    }
+
+    heldClass = cls;
+    holdStart = now;
+}
+
+void sdEnd() {
+    if (heldClass >= 0) {
+        SdIoStats* s = &ioStats[heldClass];
+        uint32_t hold = micros() - holdStart;
+        s->holdUs += hold;
+        if (hold > s->maxHoldUs) s->maxHoldUs = hold;
+        if (heldClass == SDIO_REFILL) lastRefillEnd = micros();
+        heldClass = -1;
+    }
+    mutex_exit(&sd_mutex);
+}
+
+// Card released: let a starving ring refill before the low class goes on
+static void serviceUrgentRefill(uint8_t cls) {
+    if (inAudioYield || !audioRefillUrgent()) return;
+    inAudioYield = true;
+    ioStats[cls].yields++;
+    fillStreamBuffers();
+    inAudioYield = false;
+}
+
+// ===================================
+// Yield (between steps of a long low-priority job, card held)
+// ===================================
+void sdYield() {
+    int8_t cls = heldClass;
+    if (cls < SDIO_PREFETCH) return; // Realtime classes never step aside
+    if (micros() - holdStart < SDIO_MAX_HOLD_US) return;
+    sdEnd();
+    serviceUrgentRefill(cls);
+    sdBegin(cls);
+}
+
+// ===================================
+// Bounded Read
+// ===================================
+// Reads up to n bytes. Low classes take the card once per SDIO_LOW_CHUNK.
+// Returns bytes read (short at end of file), or -1 on error.
+int sdRead(FsFile& f, void* buf, uint32_t n, uint8_t cls) {
+    if (cls < SDIO_PREFETCH) {
+        sdBegin(cls);
+        int r = f.read(buf, n);
+        sdEnd();
+        if (r > 0) ioStats[cls].bytes += r;
+        return r;
+    }
+
+    uint8_t* p = (uint8_t*)buf;
+    uint32_t done = 0;
+    while (done < n) {
+        uint32_t want = n - done;
+        if (want > SDIO_LOW_CHUNK) want = SDIO_LOW_CHUNK;
+        sdBegin(cls);
+        int r = f.read(p + done, want);
+        sdEnd();
+        if (r < 0) return -1;
+        ioStats[cls].bytes += r;
+        done += r;
+        if ((uint32_t)r < want) break; // End of file
+        if (done < n) serviceUrgentRefill(cls);
+    }
+    return done;
+}
+
+// ===================================
+// Status (SDIO command)
+// ===================================
+void printSdIoStats(Print& out) {
+    out.printf("SDIO:refill gap max %luus (longest wait for a refill read with a ring low)\n", refillGapMaxUs);
+    for (int c = 0; c < SDIO_CLASS_COUNT; c++) {
+        SdIoStats* s = &ioStats[c];
+        if (s->requests == 0) continue;
+        out.printf("SDIO:%-8s req %8lu wait avg %4luus max %6luus hold avg %5luus max %7luus %8luKB yields %lu\n",
+                   classNames[c], s->requests,
+                   (uint32_t)(s->waitUs / s->requests), s->maxWaitUs,
+                   (uint32_t)(s->holdUs / s->requests), s->maxHoldUs,
+                   s->bytes / 1024, s->yields);
+    }
+}
+
+void resetSdIoStats() {
+    memset(ioStats, 0, sizeof(ioStats));
+    refillGapMaxUs = 0;
+    lastRefillEnd = 0;
+}
@@ -23,16 +23,83 @@ void sendSerialResponseF(Stream &serial, const char* format, ...) {
     sendSerialResponse(serial, buffer);
 }
 
+// ===================================
+// Sound Lookup / Start (PLAY and trigger inputs)
+// ===================================
+// Last variant played per Bank 1 sound, +1 (0 = none yet). Kept here rather
+// than in the catalog, which is read-only once published.
+static uint8_t bank1LastVariant[MAX_SOUNDS];
+
+// Bank/page/index -> full path. Returns nullptr, or the error line for the caller.
+const char* resolveSoundPath(int bank, char page, int index, char* fullPath, size_t len) {
+    const Catalog* cat = catalog();
+    if (bank == 1) {
+        if (index < 1 || index > cat->bank1SoundCount) return "ERR:PARAM - Invalid sound index";
+
+        // Pick random variant, avoiding the last-played one
+        const SoundFile& sound = cat->bank1Sounds[index - 1];
+        int variantIdx;
+
+        if (sound.variantCount == 1) {
+            variantIdx = 0; // Only one choice
+        } else {
+            variantIdx = random(sound.variantCount);
+            if (variantIdx + 1 == bank1LastVariant[index - 1]) {
+                variantIdx = (variantIdx + 1) % sound.variantCount;
+            }
+        }
+        
+        bank1LastVariant[index - 1] = variantIdx + 1;
+
+        // Prefix with the active flash pack slot ("/flash/N/") for startStream to know it's flash
+        snprintf(fullPath, len, "%s/%s", getBank1FlashDir(), sound.variants[variantIdx]);
+        return nullptr;
+    }
+    if (bank >= 2 && bank <= 6) {
+        const char* filename = getSDFile(cat, bank, page, index);
+        if (!filename) return "ERR:PARAM - Invalid file index";
+        const SDBank* sdBank = findSDBank(cat, bank, page);
+        snprintf(fullPath, len, "/%s/%s", sdBank->dirName, filename);
+        return nullptr;
+    }
+    return "ERR:PARAM - Invalid bank";
+}
+
+// Start (or crossfade to, when XFAD is set) a resolved sound; volume 0-99,
+// -1 keeps the stream's current volume. Returns the voice it plays on, or -1.
+int startSoundPath(int stream, const char* fullPath, int volume, uint8_t priority) {
+    int voice = crossfadeStream(stream, fullPath, crossfadeMs, priority);
+    if (voice >= 0 && volume >= 0) {
+        if (volume > 99) volume = 99;
+        streams[voice].volume = (float)volume / 99.0f;
+        syncMixVoice(voice);
+    }
+    return voice;
+}
+
+int playSound(int stream, int bank, char page, int index, int volume, uint8_t priority) {
+    char fullPath[128];
+    if (resolveSoundPath(bank, page, index, fullPath, sizeof(fullPath))) return -1;
+    noteSoundTrigger(bank, page, index);
+    return startSoundPath(stream, fullPath, volume, priority);
+}
+
 // Helper to find the next available stream
 int getNextAvailableStream() {
     // 1. Try to find an inactive stream
     for (int i = 0; i < MAX_STREAMS; i++) {
-        if (!streams[i].active) {
+        if (!streams[i].active && !streams[i].waitingForDecoder) {
             return i;
         }
     }
     
-    // 2. All busy? Steal Stream 0.
+    // 2. Reclaim a paused stream (it can still be resumed from a bookmark)
+    int paused = findReclaimablePausedStream();
+    if (paused >= 0 && reclaimPausedStream(paused)) {
+        return paused;
+    }
+    
+    // 3. All busy? Steal Stream 0.
     return 0;
 }
 
@@ -79,19 +146,17 @@ void processSerialCommands(Stream &serial) {
 
                 // PLAY Command
                 if (strncmp(cmdBuffer, "PLAY:", 5) == 0) {
-                    int stream, bank, volume, index;
+                    int stream, bank, volume, index, priority;
                     char page;
                     
                     char* ptr = cmdBuffer + 5;
                     
-                    // NEW FORMAT: PLAY:index,bank,page,volume
+                    // NEW FORMAT: PLAY:index,bank,page,volume[,priority]
                     // Defaults
                     bank = 1;
                     page = 'A';
                     volume = -1; // Use current volume
-                    
-                    // Auto-select stream
-                    stream = getNextAvailableStream();
+                    priority = STREAM_PRIORITY_NORMAL;
                     
                     // 1. Index (Required)
                     if (*ptr == '\0' || *ptr == '\r' || *ptr == '\n') goto play_error;
@@ -129,83 +194,52 @@ void processSerialCommands(Stream &serial) {
                                 ptr++; // Skip comma
                                 
                                 // 4. Volume (Optional)
-                                if (*ptr != '\0' && *ptr != '\r' && *ptr != '\n') {
+                                if (*ptr != ',' && *ptr != '\0' && *ptr != '\r' && *ptr != '\n') {
                                     volume = atoi(ptr);
                                 }
+                                
+                                // 5. Priority (Optional, 0=low 1=normal 2=high)
+                                ptr = strchr(ptr, ',');
+                                if (ptr) {
+                                    priority = constrain(atoi(ptr + 1), STREAM_PRIORITY_LOW, STREAM_PRIORITY_HIGH);
+                                }
                             }
                         }
                     }
                     
-                    if (stream < 0 || stream >= MAX_STREAMS) {
-                        serial.println("ERR:PARAM - Invalid stream");
-                        goto play_done;
-                    }
-
-                    if (bank == 1) {
-                        if (index >= 1 && index <= bank1SoundCount) {
-                            
-                            // Pick random variant, avoiding the last-played one
-                            SoundFile& sound = bank1Sounds[index - 1];
-                            int variantIdx;
+                    {
+                        char fullPath[128];
+                        const char* err = resolveSoundPath(bank, page, index, fullPath, sizeof(fullPath));
+                        if (err) {
+                            serial.println(err);
+                            goto play_done;
+                        }
 
-                            if (sound.variantCount == 1) {
-                                variantIdx = 0; // Only one choice
-                            } else {
-                                variantIdx = random(sound.variantCount);
-                                if (variantIdx == sound.lastVariantPlayed) {
-                                    variantIdx = (variantIdx + 1) % sound.variantCount;
-                                }
-                            }
-                            
-                            sound.lastVariantPlayed = variantIdx;
-                            const char* filename = sound.variants[variantIdx];
-                            
-                            // Prefix with /flash/ for startStream to know it's flash
-                            char fullPath[80];
-                            snprintf(fullPath, sizeof(fullPath), "/flash/%s", filename);
-                            
-                            // Send acknowledgement (queued for Serial2)
-                            sendSerialResponse(serial, "PACK:PLAY");
-                            sendSerialResponseF(serial, "S:%d,ply,%d", stream, volume);
-
-                            if (startStream(stream, fullPath)) {
-                                if (volume >= 0) {
-                                    if (volume > 99) volume = 99;
-                                    streams[stream].volume = (float)volume / 99.0f;
-                                }
-                            } else {
-                                serial.println("ERR:NOFILE");
-                            }
-                        } else {
-                            serial.println("ERR:PARAM - Invalid sound index");
+                        // Auto-select stream, only once the sound is known to exist:
+                        // picking one may reclaim (bookmark and release) a paused track
+                        stream = getNextAvailableStream();
+                        if (stream < 0 || stream >= MAX_STREAMS) {
+                            serial.println("ERR:PARAM - Invalid stream");
+                            goto play_done;
                         }
-                    }
-                    else if (bank >= 2 && bank <= 6) {
-                        const char* filename = getSDFile(bank, page, index);
-                        if (filename) {
-                            SDBank* sdBank = findSDBank(bank, page);
-                            char fullPath[128];
-                            snprintf(fullPath, sizeof(fullPath), "/%s/%s", 
-                                    sdBank->dirName, filename);
-                            
-                            // Send acknowledgement (queued for Serial2)
-                            sendSerialResponse(serial, "PACK:PLAY");
-                            sendSerialResponseF(serial, "S:%d,ply,%d", stream, volume);
-
-                            if (startStream(stream, fullPath)) {
-                                if (volume >= 0) {
-                                    if (volume > 99) volume = 99;
-                                    streams[stream].volume = (float)volume / 99.0f;
-                                }
+
+                        noteSoundTrigger(bank, page, index);
+
+                        // Acknowledge only a start that happened: a host that sees
+                        // PACK:PLAY expects the S:...,idle that follows it
+                        uint32_t rejectsBefore = admissionRejectCount();
+                        if (startSoundPath(stream, fullPath, volume, priority) < 0) {
+                            if (admissionRejectCount() != rejectsBefore) {
+                                serial.println("ERR:ADMIT - Over the playback budget (ADMT)");
                             } else {
                                 serial.println("ERR:NOFILE");
                             }
-                        } else {
-                            serial.println("ERR:PARAM - Invalid file index");
+                            goto play_done;
                         }
-                    }
-                    else {
-                        serial.println("ERR:PARAM - Invalid bank");
+
+                        // Send acknowledgement (queued for Serial2)
+                        sendSerialResponse(serial, "PACK:PLAY");
+                        sendSerialResponseF(serial, "S:%d,ply,%d", stream, volume);
                     }
                     
                     play_done:;
@@ -217,26 +251,81 @@ void processSerialCommands(Stream &serial) {
                 }
                 
                 // STOP Command  
+                // STOP:n,ms fades out over ms and reports idle when silent
                 else if (strcmp(cmdBuffer, "STOP") == 0 || strncmp(cmdBuffer, "STOP:", 5) == 0) {
+                    char* comma = strchr(cmdBuffer, ',');
+                    int fadeMs = comma ? atoi(comma + 1) : 0;
+
                     if (strcmp(cmdBuffer, "STOP") == 0 || cmdBuffer[5] == '*') {
                         // Stop all streams if just "STOP" or "STOP:*"
+                        cancelCrossfade(-1);
                         for (int i = 0; i < MAX_STREAMS; i++) {
-                            stopStream(i);
                             sendSerialResponse(serial, "PACK:STOP");
+                            if (fadeMs > 0 && fadeOutStream(i, fadeMs, &serial)) continue;
+                            stopStream(i);
+                            clearStreamBookmark(i);
                             sendSerialResponseF(serial, "S:%d,idle,,0", i);
                         }
                     } else {
                         int stream = cmdBuffer[5] - '0';
                         if (stream >= 0 && stream < MAX_STREAMS) {
-                            stopStream(stream);
                             sendSerialResponse(serial, "PACK:STOP");
-                            sendSerialResponseF(serial, "S:%d,idle,,0", stream);
+                            if (!(fadeMs > 0 && fadeOutStream(stream, fadeMs, &serial))) {
+                                cancelCrossfade(stream);
+                                stopStream(stream);
+                                clearStreamBookmark(stream);
+                                sendSerialResponseF(serial, "S:%d,idle,,0", stream);
+                            }
                         } else {
                             serial.println("ERR:PARAM - Invalid stream");
                         }
                     }
                 }
 
+                // FADE Command: FADE:stream,vol,ms ramps the stream's fader
+                // (0-99 of its VOL level). Fading to 0 releases the stream.
+                else if (strncmp(cmdBuffer, "FADE:", 5) == 0) {
+                    char* p1 = strchr(cmdBuffer + 5, ',');
+                    char* p2 = p1 ? strchr(p1 + 1, ',') : nullptr;
+                    if (!p2) {
+                        serial.println("ERR:PARAM - Format: FADE:stream,vol,ms");
+                    } else if (fadeStream(atoi(cmdBuffer + 5), atoi(p1 + 1), max(atoi(p2 + 1), 0), &serial)) {
+                        sendSerialResponse(serial, "PACK:FADE");
+                    } else {
+                        serial.println("ERR:PARAM - Stream not playing");
+                    }
+                }
+
+                // PAUS Command: PAUS:n freezes stream n, keeping file/decoder/buffer
+                else if (strncmp(cmdBuffer, "PAUS:", 5) == 0) {
+                    int stream = atoi(cmdBuffer + 5);
+                    if (pauseStream(stream)) {
+                        sendSerialResponse(serial, "PACK:PAUS");
+                        sendSerialResponseF(serial, "S:%d,paus", stream);
+                    } else {
+                        serial.println("ERR:PARAM - Stream not playing");
+                    }
+                }
+
+                // RESM Command: RESM:n continues a paused (or reclaimed) stream
+                else if (strncmp(cmdBuffer, "RESM:", 5) == 0) {
+                    int stream = resumeStream(atoi(cmdBuffer + 5));
+                    if (stream >= 0) {
+                        sendSerialResponse(serial, "PACK:RESM");
+                        sendSerialResponseF(serial, "S:%d,ply,%d", stream, (int)(streams[stream].volume * 99.0f));
+                    } else {
+                        serial.println("ERR:PARAM - Nothing to resume");
+                    }
+                }
+
+                // XFAD Command: XFAD:ms sets the crossfade used when a PLAY (or
+                // F/R track change) replaces a playing track. 0 = hard cut.
+                else if (strncmp(cmdBuffer, "XFAD:", 5) == 0) {
+                    int ms = atoi(cmdBuffer + 5);
+                    crossfadeMs = constrain(ms, 0, GAIN_RAMP_MAX_MS);
+                    sendSerialResponse(serial, "PACK:XFAD");
+                }
+
                 // CHRP Command
                 else if (strncmp(cmdBuffer, "CHRP:", 5) == 0) {
                     // Format: CHRP:StartHz,EndHz,DurationMs,Volume
@@ -285,6 +374,7 @@ void processSerialCommands(Stream &serial) {
                         
                         if (stream >= 0 && stream < MAX_STREAMS) {
                             streams[stream].volume = (float)volume / 99.0f;
+                            syncMixVoice(stream);
                             sendSerialResponse(serial, "PACK:SVOL");
                         } else {
                             serial.println("ERR:PARAM - Invalid stream");
@@ -297,6 +387,7 @@ void processSerialCommands(Stream &serial) {
 
                         for (int i = 0; i < MAX_STREAMS; i++) {
                             streams[i].volume = (float)volume / 99.0f;
+                            syncMixVoice(i);
                         }
                         
                         sendSerialResponse(serial, "PACK:SVOL");
@@ -305,51 +396,54 @@ void processSerialCommands(Stream &serial) {
                 
                 // LIST Command
                 else if (strcmp(cmdBuffer, "LIST") == 0) {
+                    const Catalog* cat = catalog();
                     serial.println("\n=== Bank 1 (Flash) ===");
-                    serial.printf("Sounds: %d\n", bank1SoundCount);
-                    for (int i = 0; i < bank1SoundCount && i < 10; i++) {
+                    serial.printf("Sounds: %d\n", cat->bank1SoundCount);
+                    for (int i = 0; i < cat->bank1SoundCount && i < 10; i++) {
                         serial.printf("  %2d. %s (%d variants)\n",
                                       i + 1,
-                                      bank1Sounds[i].basename,
-                                      bank1Sounds[i].variantCount);
+                                      cat->bank1Sounds[i].basename,
+                                      cat->bank1Sounds[i].variantCount);
                     }
-                    if (bank1SoundCount > 10) {
-                        serial.printf("  ... and %d more\n", bank1SoundCount - 10);
+                    if (cat->bank1SoundCount > 10) {
+                        serial.printf("  ... and %d more\n", cat->bank1SoundCount - 10);
                     }
                     
                     serial.println("\n=== Banks 2-6 (SD) ===");
-                    for (int i = 0; i < sdBankCount; i++) {
+                    for (int i = 0; i < cat->sdBankCount; i++) {
                         serial.printf("Bank %d%c: %s (%d files)\n",
-                                      sdBanks[i].bankNum,
-                                      sdBanks[i].page ? sdBanks[i].page : ' ',
-                                      sdBanks[i].dirName,
-                                      sdBanks[i].fileCount);
+                                      cat->sdBanks[i].bankNum,
+                                      cat->sdBanks[i].page ? cat->sdBanks[i].page : ' ',
+                                      cat->sdBanks[i].dirName,
+                                      cat->sdBanks[i].fileCount);
                     }
                     serial.println();
                 }
                 
                 // GMAN Command (with MSUM)
                 else if (strcmp(cmdBuffer, "GMAN") == 0) {
-                    sendSerialResponseF(serial, "MDAT:%d", sdBankCount + 1);
+                    const Catalog* cat = catalog();
+                    sendSerialResponseF(serial, "MDAT:%d", cat->sdBankCount + 1);
                     // Send full directory name for Bank 1 (e.g. "1A_R2D2")
                     sendSerialResponseF(serial, "BANK:1,%s,%d", 
-                                  bank1DirName, 
-                                  bank1SoundCount);
+                                  cat->bank1DirName, 
+                                  cat->bank1SoundCount);
 
-                    for (int i = 0; i < sdBankCount; i++) {
+                    for (int i = 0; i < cat->sdBankCount; i++) {
                         // Send full directory name (e.g. "1A_R2D2") instead of just page char
                         sendSerialResponseF(serial, "BANK:%d,%s,%d",
-                                     sdBanks[i].bankNum,
-                                     sdBanks[i].dirName,
-                                     sdBanks[i].fileCount);
+                                     cat->sdBanks[i].bankNum,
+                                     cat->sdBanks[i].dirName,
+                                     cat->sdBanks[i].fileCount);
                     }
                     
-                    sendSerialResponseF(serial, "MSUM:%lu", globalFilenameChecksum);
+                    sendSerialResponseF(serial, "MSUM:%lu", cat->checksum);
                     sendSerialResponse(serial, "MEND");
                 }
                 
                 // GNME Command (with new parser and .wav fix)
                 else if (strncmp(cmdBuffer, "GNME:", 5) == 0) {
+                    const Catalog* cat = catalog();
                     int bank, index;
                     char page = 0;
                     char* ptr = cmdBuffer + 5; // e.g., "2,A,5" or "1,,1" or "1,A,1"
@@ -376,15 +470,15 @@ void processSerialCommands(Stream &serial) {
 
                     
                     // Now, handle the request
-                    if (bank == 1 && index >= 1 && index <= bank1SoundCount) {
+                    if (bank == 1 && index >= 1 && index <= cat->bank1SoundCount) {
                         // For Bank 1, send the basename + ".wav"
                         sendSerialResponseF(serial, "NAME:1,,%d,%s.wav",
                                       index,
-                                      bank1Sounds[index - 1].basename);
+                                      cat->bank1Sounds[index - 1].basename);
                     }
                     else if (bank >= 2 && bank <= 6 && index >= 1) {
                         // For Banks 2-6, we send the *full filename*
-                        const char* filename = getSDFile(bank, page, index);
+                        const char* filename = getSDFile(cat, bank, page, index);
                         if (filename) {
                             sendSerialResponseF(serial, "NAME:%d,%c,%d,%s",
                                          bank, page == 0 ? ',' : page, 
@@ -413,30 +507,162 @@ void processSerialCommands(Stream &serial) {
                         stopStream(i);
                     }
                     
-                    int count = 0;
-                    Dir dir = LittleFS.openDir("/flash");
-                    while (dir.next()) {
-                        if (!dir.isDirectory()) {
-                            String fullPath = "/flash/" + dir.fileName();
-                            if (LittleFS.remove(fullPath)) {
-                                count++;
-                            }
-                        }
-                    }
+                    // Drops both A/B pack slots along with their headers
+                    int count = clearFlashPacks();
                     
                     serial.printf("Deleted %d files from /flash.\n", count);
                     serial.println("Please REBOOT the board to re-sync files.");
                     sendSerialResponse(serial, "PACK:CCRC");
                 }
 
+                // RESD Command: Bank 1 PSRAM residency report
+                else if (strcmp(cmdBuffer, "RESD") == 0) {
+                    printBank1Residency(serial);
+                }
+
+                // MP3P Command: decoder pool status (MP3P:B,<file> benchmarks placements)
+                else if (strcmp(cmdBuffer, "MP3P") == 0) {
+                    printMp3PoolStatus(serial);
+                }
+                else if (strncmp(cmdBuffer, "MP3P:B,", 7) == 0) {
+                    runMp3PoolBench(serial, cmdBuffer + 7);
+                    sendSerialResponse(serial, "PACK:MP3P");
+                }
+
+                // DSPT Command: DSP kernel self-test and cycle counts
+                else if (strcmp(cmdBuffer, "DSPT") == 0) {
+                    runDspSelfTest(serial);
+                }
+
+                // INPT Command: input event status
+                else if (strcmp(cmdBuffer, "INPT") == 0) {
+                    printInputStatus(serial);
+                }
+
+                // MEM Command: heap / tagged allocation / static section report
+                else if (strcmp(cmdBuffer, "MEM") == 0) {
+                    printMemoryReport(serial);
+                }
+
+                // TRIG Command: trigger pins and edge -> audio latency
+                else if (strcmp(cmdBuffer, "TRIG") == 0) {
+                    printTriggerStatus(serial);
+                }
+
+                // TASK Command: Core 0 scheduler timing (TASK:R resets)
+                else if (strcmp(cmdBuffer, "TASK") == 0) {
+                    printTaskStats(serial);
+                }
+                else if (strcmp(cmdBuffer, "TASK:R") == 0) {
+                    resetTaskStats();
+                    sendSerialResponse(serial, "PACK:TASK");
+                }
+
+                // BUFS Command: ring levels, start thresholds, underruns (BUFS:R resets)
+                else if (strcmp(cmdBuffer, "BUFS") == 0) {
+                    printBufferStatus(serial);
+                }
+                else if (strcmp(cmdBuffer, "BUFS:R") == 0) {
+                    resetBufferStats();
+                    sendSerialResponse(serial, "PACK:BUFS");
+                }
+
+                // PROF Command: PC sampling profiler (PROF:ON[,us], PROF:OFF, PROF:D dumps)
+                else if (strcmp(cmdBuffer, "PROF") == 0) {
+                    printProfilerStatus(serial);
+                }
+                else if (strncmp(cmdBuffer, "PROF:ON", 7) == 0) {
+                    uint32_t periodUs = (cmdBuffer[7] == ',') ? (uint32_t)atoi(cmdBuffer + 8) : 0; // 0 = default
+                    if (startProfiler(periodUs)) sendSerialResponse(serial, "PACK:PROF");
+                    else serial.println("ERR:PROF - no memory, or PROF:D still dumping");
+                }
+                else if (strcmp(cmdBuffer, "PROF:OFF") == 0) {
+                    stopProfiler();
+                    sendSerialResponse(serial, "PACK:PROF");
+                }
+                else if (strcmp(cmdBuffer, "PROF:D") == 0) {
+                    dumpProfile(serial);
+                }
+
+                // ADMT Command: admission control (ADMT:L learned costs, ADMT:ON/OFF,
+                // ADMT:B,core0%,sdKB/s budget, ADMT:R resets the counters)
+                else if (strcmp(cmdBuffer, "ADMT") == 0 || strcmp(cmdBuffer, "ADMT:L") == 0) {
+                    printAdmissionStatus(serial, cmdBuffer[4] == ':');
+                }
+                else if (strcmp(cmdBuffer, "ADMT:ON") == 0 || strcmp(cmdBuffer, "ADMT:OFF") == 0) {
+                    admissionEnabled = (cmdBuffer[6] == 'N');
+                    sendSerialResponse(serial, "PACK:ADMT");
+                }
+                else if (strncmp(cmdBuffer, "ADMT:B,", 7) == 0) {
+                    int pct, kbps;
+                    if (sscanf(cmdBuffer + 7, "%d,%d", &pct, &kbps) == 2) {
+                        setAdmissionBudget(pct, kbps);
+                        sendSerialResponse(serial, "PACK:ADMT");
+                    } else {
+                        serial.println("ERR:ADMT - use ADMT:B,core0%,sdKB/s");
+                    }
+                }
+                else if (strcmp(cmdBuffer, "ADMT:R") == 0) {
+                    resetAdmissionStats();
+                    sendSerialResponse(serial, "PACK:ADMT");
+                }
+
+                // PRED Command: next-sound model and pre-roll cache hit rate
+                // (PRED:L lists the model and slots, PRED:R resets, PRED:C clears the model)
+                else if (strcmp(cmdBuffer, "PRED") == 0 || strcmp(cmdBuffer, "PRED:L") == 0) {
+                    printPredictStatus(serial, cmdBuffer[4] == ':');
+                }
+                else if (strcmp(cmdBuffer, "PRED:R") == 0) {
+                    resetPredictStats();
+                    sendSerialResponse(serial, "PACK:PRED");
+                }
+                else if (strcmp(cmdBuffer, "PRED:C") == 0) {
+                    clearPredictModel();
+                    sendSerialResponse(serial, "PACK:PRED");
+                }
+
+                // WARM Command: boot warm-up progress (WARM:L lists the hot set, WARM:S restarts)
+                else if (strcmp(cmdBuffer, "WARM") == 0 || strcmp(cmdBuffer, "WARM:L") == 0) {
+                    printWarmupStatus(serial, cmdBuffer[4] == ':');
+                }
+                else if (strcmp(cmdBuffer, "WARM:S") == 0) {
+                    beginWarmup();
+                    sendSerialResponse(serial, "PACK:WARM");
+                }
+
+                // CTLG Command: sound catalog snapshot (CTLG:S rescans in the background)
+                else if (strcmp(cmdBuffer, "CTLG") == 0) {
+                    printCatalogStatus(serial);
+                }
+                else if (strcmp(cmdBuffer, "CTLG:S") == 0) {
+                    if (requestCatalogRescan()) {
+                        sendSerialResponse(serial, "PACK:CTLG");
+                    } else {
+                        sendSerialResponse(serial, "ERR:CTLG - rescan already running");
+                    }
+                }
+
+                // SDIO Command: SD card arbitration per request class (SDIO:R resets)
+                else if (strcmp(cmdBuffer, "SDIO") == 0) {
+                    printSdIoStats(serial);
+                }
+                else if (strcmp(cmdBuffer, "SDIO:R") == 0) {
+                    resetSdIoStats();
+                    sendSerialResponse(serial, "PACK:SDIO");
+                }
+
                 // STAT Command
                 else if (strncmp(cmdBuffer, "STAT:", 5) == 0) {
                     int stream = atoi(cmdBuffer + 5);
                     if (stream >= 0 && stream < MAX_STREAMS) {
                         if (streams[stream].active) {
                             int vol = (int)(streams[stream].volume * 99.0f);
-                            serial.printf("STAT:playing,%s,%d\n",
+                            serial.printf("STAT:%s,%s,%d\n",
+                                         streams[stream].paused ? "paused" :
+                                         streams[stream].releaseOnFade ? "fading" : "playing",
                                          streams[stream].filename, vol);
+                        } else if (hasStreamBookmark(stream)) {
+                            serial.printf("STAT:reclaimed,,0\n");
                         } else {
                             serial.printf("STAT:idle,,0\n");
                         }
@@ -51,7 +51,7 @@ bool queueSerial2Message(const char* msg) {
 // ===================================
 bool isCpuBusy() {
     // Check if any MP3 stream has a buffer running low
-    for (int i = 0; i < MAX_STREAMS; i++) {
+    for (int i = 0; i < MAX_VOICES; i++) {
         if (streams[i].active && streams[i].type == STREAM_TYPE_MP3_SD) {
             int available = streams[i].ringBuffer->availableForRead();
             // If buffer is less than 25% full, CPU should prioritize refilling
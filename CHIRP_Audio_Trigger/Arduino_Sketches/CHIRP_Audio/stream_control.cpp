@@ -0,0 +1,379 @@
+#include "config.h"
+
+// =================================================================================
+//  STREAM PAUSE / RESUME
+// =================================================================================
+// PAUS:n just tells the mixer to stop reading stream n. The file stays open,
+// the MP3 decoder stays assigned and Core 0 keeps the ring topped up, so
+// RESM:n is instant (with the usual 50ms fade-in).
+//
+// A paused stream is still holding a stream slot and possibly a decoder. When
+// either is needed (no free stream for a PLAY, or the MP3 pool is empty) the
+// oldest paused stream is reclaimed: its file and play position are saved in a
+// bookmark and the stream is stopped. RESM:n then reopens the file and seeks
+// to the bookmark instead.
+//
+// The play position is estimated as
+//     sourceBytesRead * framesMixed / framesQueued
+// i.e. the share of what was read that actually reached the DAC. That is exact
+// for WAV, close for MP3 (the decoder re-syncs on the next frame header), and
+// rounded down to a whole frame for QOA.
+
+struct StreamBookmark {
+    bool valid;
+    char filename[64];
+    uint32_t offset;   // Source bytes into the audio data
+    float volume;
+    uint8_t priority;
+};
+
+static StreamBookmark bookmarks[MAX_STREAMS];
+
+// Source bytes the listener has actually heard
+static uint32_t playedOffset(AudioStream* s) {
+    uint32_t offset = s->bytesConsumed;
+    uint32_t mixed = mixVoices.framesMixed[s - streams];
+    if (s->framesQueued > 0 && mixed < s->framesQueued) {
+        offset = (uint32_t)((uint64_t)s->bytesConsumed * mixed / s->framesQueued);
+    }
+
+    // Align so the resumed read starts on a decodable boundary
+    if (s->type == STREAM_TYPE_QOA_SD) {
+        uint32_t frameBytes = 8 + 16 * s->channels + 256 * 8 * s->channels;
+        offset -= offset % frameBytes;
+    } else if (s->type != STREAM_TYPE_MP3_SD && s->blockAlign > 0) {
+        offset -= offset % s->blockAlign;
+    }
+    return s->bytesSkipped + offset;
+}
+
+// Skip the first 'bytes' of audio data on a freshly started stream (Core 0,
+// before the first fillStreamBuffers() for it)
+static void skipStreamData(AudioStream* s, uint32_t bytes) {
+    if (bytes == 0) return;
+
+    if (s->type == STREAM_TYPE_WAV_SD || s->type == STREAM_TYPE_WAV_FLASH || s->type == STREAM_TYPE_WAV_RAM) {
+        if (bytes > s->dataRemaining) bytes = s->dataRemaining;
+        s->dataRemaining -= bytes;
+    }
+
+    if (s->type == STREAM_TYPE_WAV_RAM) {
+        s->ramData += bytes;
+    } else if (s->type == STREAM_TYPE_WAV_FLASH) {
+        mutex_enter_blocking(&flash_mutex);
+        s->flashFile.seek(s->flashFile.position() + bytes);
+        mutex_exit(&flash_mutex);
+    } else {
+        uint32_t cached = skipPreroll(s, bytes); // File is already past a pre-roll hit
+        sdBegin(SDIO_OPEN);
+        uint64_t target = s->sdFile.position() + (bytes - cached);
+        if (target > s->sdFile.size()) target = s->sdFile.size();
+        s->sdFile.seek(target);
+        sdEnd();
+    }
+    s->bytesSkipped = bytes;
+}
+
+static void settleCrossfade(int streamIdx);
+
+// ===================================
+// Pause / Resume
+// ===================================
+bool pauseStream(int streamIdx) {
+    if (streamIdx < 0 || streamIdx >= MAX_STREAMS) return false;
+    settleCrossfade(streamIdx);
+    AudioStream* s = &streams[streamIdx];
+    if (!s->active || s->paused) return false;
+
+    s->paused = true;
+    s->pausedAt = millis();
+    syncMixVoice(streamIdx);
+    log_message(String("Stream ") + streamIdx + ": Paused");
+    return true;
+}
+
+// Returns the stream the sound resumed on (a reclaimed one may land on a
+// different slot if its own is busy), or -1.
+int resumeStream(int streamIdx) {
+    if (streamIdx < 0 || streamIdx >= MAX_STREAMS) return -1;
+    AudioStream* s = &streams[streamIdx];
+
+    // Still paused in place: just let the mixer read again
+    if (s->active && s->paused) {
+        mixVoices.gainQ30[streamIdx] = 0; // Mixer isn't touching a paused stream
+        setStreamGainRamp(streamIdx, GAIN_UNITY, STREAM_FADE_IN_MS);
+        s->paused = false;
+        syncMixVoice(streamIdx);
+        log_message(String("Stream ") + streamIdx + ": Resumed after " + (millis() - s->pausedAt) + "ms");
+        return streamIdx;
+    }
+
+    StreamBookmark* b = &bookmarks[streamIdx];
+    if (!b->valid) return -1;
+
+    // Reclaimed: reopen and seek, preferring the original slot
+    int target = -1;
+    if (!s->active && !s->waitingForDecoder) {
+        target = streamIdx;
+    } else {
+        for (int i = 0; i < MAX_STREAMS; i++) {
+            if (!streams[i].active && !streams[i].waitingForDecoder) {
+                target = i;
+                break;
+            }
+        }
+    }
+    if (target < 0) {
+        log_message(String("Stream ") + streamIdx + ": Resume failed, no free stream");
+        return -1;
+    }
+
+    StreamBookmark saved = *b;
+    b->valid = false;
+    if (!startStream(target, saved.filename, saved.priority)) return -1;
+
+    AudioStream* t = &streams[target];
+    t->volume = saved.volume;
+    syncMixVoice(target);
+    skipStreamData(t, saved.offset);
+    log_message(String("Stream ") + target + ": Resumed " + saved.filename + " at byte " + saved.offset);
+    return target;
+}
+
+// ===================================
+// Reclaim (under stream/decoder pressure)
+// ===================================
+bool reclaimPausedStream(int streamIdx) {
+    if (streamIdx < 0 || streamIdx >= MAX_STREAMS) return false;
+    AudioStream* s = &streams[streamIdx];
+    if (!s->active || !s->paused) return false;
+
+    StreamBookmark* b = &bookmarks[streamIdx];
+    strncpy(b->filename, s->filename, sizeof(b->filename) - 1);
+    b->filename[sizeof(b->filename) - 1] = '\0';
+    b->offset = playedOffset(s);
+    b->volume = s->volume;
+    b->priority = s->priority;
+    b->valid = true;
+
+    log_message(String("Stream ") + streamIdx + ": Paused stream reclaimed, bookmarked at byte " + b->offset);
+    stopStream(streamIdx);
+    return true;
+}
+
+// Oldest paused stream, or -1
+int findReclaimablePausedStream() {
+    int oldest = -1;
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (!streams[i].active || !streams[i].paused) continue;
+        if (oldest < 0 || (int32_t)(streams[i].pausedAt - streams[oldest].pausedAt) < 0) {
+            oldest = i;
+        }
+    }
+    return oldest;
+}
+
+void clearStreamBookmark(int streamIdx) {
+    if (streamIdx >= 0 && streamIdx < MAX_STREAMS) bookmarks[streamIdx].valid = false;
+}
+
+bool hasStreamBookmark(int streamIdx) {
+    return streamIdx >= 0 && streamIdx < MAX_STREAMS && bookmarks[streamIdx].valid;
+}
+
+// =================================================================================
+//  GAIN RAMPS / CROSSFADE
+// =================================================================================
+// The mixer moves each voice's gainQ30 towards gainTarget by gainStep per
+// sample. Core 0 only ever writes target and step (step last), so a ramp can
+// be retargeted mid-flight without a jump. The ramp runs in Q30 so even a
+// GAIN_RAMP_MAX_MS fade has a step of a few hundred, and its length is
+// within a fraction of a percent of what was asked.
+//
+// A crossfade starts the new file on the shadow voice (SHADOW_VOICE), held
+// silent until it has prebuffered, then ramps it up while the old track ramps
+// down. When the old track reaches zero the two voices are swapped so the new
+// track carries on as stream n, and the old file is released from the shadow.
+
+#define XFADE_PREBUFFER 4096     // Ring samples queued before the fade starts (~46ms)
+#define XFADE_START_TIMEOUT_MS 1000
+
+uint32_t crossfadeMs = 0; // XFAD:ms, 0 = hard cut (default)
+
+struct CrossfadeState {
+    int8_t stream;      // Stream being replaced, -1 = idle
+    bool fading;        // false while the shadow voice prebuffers
+    uint32_t fadeMs;
+    uint32_t startedAt;
+};
+
+static CrossfadeState xfade = { -1, false, 0, 0 };
+
+void setStreamGainRamp(int streamIdx, int32_t targetQ16, uint32_t ms) {
+    if (streamIdx < 0 || streamIdx >= MAX_VOICES) return;
+    if (ms > GAIN_RAMP_MAX_MS) ms = GAIN_RAMP_MAX_MS;
+
+    int32_t target = targetQ16 << GAIN_RAMP_SHIFT;
+    int32_t delta = target - mixVoices.gainQ30[streamIdx];
+    int32_t samples = (int32_t)((uint64_t)ms * SAMPLE_RATE / 1000);
+    int32_t step = delta;
+    if (samples > 0) step = (delta + (delta < 0 ? -samples : samples) / 2) / samples; // Rounded
+    if (step == 0) step = (delta > 0) ? 1 : -1;
+
+    mixVoices.gainStep[streamIdx] = 0; // Hold while retargeting
+    mixVoices.gainTarget[streamIdx] = target;
+    mixVoices.gainStep[streamIdx] = step;
+}
+
+// Swap the old stream and the shadow voice. The mixer reads only the voice
+// table, which it swaps itself between two samples; the AudioStream control
+// objects (file handles, decoder) are Core 0's alone and are exchanged after,
+// with the mixer still running.
+static void swapShadowVoice(int streamIdx) {
+    swapMixVoices(streamIdx, SHADOW_VOICE);
+    AudioStream tmp = streams[streamIdx];
+    streams[streamIdx] = streams[SHADOW_VOICE];
+    streams[SHADOW_VOICE] = tmp;
+
+    // Decoders are tracked by voice index
+    if (streams[streamIdx].type == STREAM_TYPE_MP3_SD) setMp3DecoderOwner(streams[streamIdx].decoderIndex, streamIdx);
+    if (streams[SHADOW_VOICE].type == STREAM_TYPE_MP3_SD) setMp3DecoderOwner(streams[SHADOW_VOICE].decoderIndex, SHADOW_VOICE);
+}
+
+static void finishCrossfade() {
+    int idx = xfade.stream;
+    swapShadowVoice(idx);
+    stopStream(SHADOW_VOICE); // The old track
+    xfade.stream = -1;
+    log_message(String("Stream ") + idx + ": Crossfade complete");
+}
+
+void cancelCrossfade(int streamIdx) {
+    if (xfade.stream < 0 || (streamIdx >= 0 && xfade.stream != streamIdx)) return;
+    stopStream(SHADOW_VOICE);
+    xfade.stream = -1;
+}
+
+// Land a crossfade on streamIdx (-1 = any) right away: one that is already
+// fading completes, one still prebuffering is dropped
+static void settleCrossfade(int streamIdx) {
+    if (xfade.stream < 0 || (streamIdx >= 0 && xfade.stream != streamIdx)) return;
+    if (xfade.fading) finishCrossfade();
+    else cancelCrossfade(-1);
+}
+
+// Returns the voice the new file plays on (set its volume there), or -1
+int crossfadeStream(int streamIdx, const char* filename, uint32_t fadeMs, uint8_t priority) {
+    if (streamIdx < 0 || streamIdx >= MAX_STREAMS) return -1;
+
+    // Nothing to fade from: plain start
+    AudioStream* s = &streams[streamIdx];
+    if (fadeMs == 0 || !s->active || s->paused) {
+        return startStream(streamIdx, filename, priority) ? streamIdx : -1;
+    }
+
+    // One shadow voice: land any crossfade still in progress first
+    settleCrossfade(-1);
+
+    if (!startStream(SHADOW_VOICE, filename, priority)) return -1;
+
+    // Hold the shadow silent until it has data
+    AudioStream* sh = &streams[SHADOW_VOICE];
+    sh->paused = true;
+    sh->volume = s->volume;
+    syncMixVoice(SHADOW_VOICE);
+    mixVoices.gainStep[SHADOW_VOICE] = 0;
+    mixVoices.gainQ30[SHADOW_VOICE] = 0;
+    mixVoices.gainTarget[SHADOW_VOICE] = 0;
+
+    xfade.stream = streamIdx;
+    xfade.fading = false;
+    xfade.fadeMs = fadeMs;
+    xfade.startedAt = millis();
+    log_message(String("Stream ") + streamIdx + ": Crossfading to " + filename + " over " + fadeMs + "ms");
+    return SHADOW_VOICE;
+}
+
+// ===================================
+// Service (Core 0 loop)
+// ===================================
+void serviceCrossfade() {
+    if (xfade.stream < 0) return;
+    int idx = xfade.stream;
+    AudioStream* s = &streams[idx];
+    AudioStream* sh = &streams[SHADOW_VOICE];
+
+    if (!xfade.fading) {
+        bool timedOut = millis() - xfade.startedAt > XFADE_START_TIMEOUT_MS;
+
+        // Start failed (bad file, no decoder in time): keep the old track
+        if (!sh->active) {
+            if (sh->waitingForDecoder && !timedOut) return;
+            log_message(String("Stream ") + idx + ": Crossfade aborted");
+            cancelCrossfade(-1);
+            return;
+        }
+        // Slow card: fade in whatever has arrived rather than wait forever
+        if (!timedOut && sh->ringBuffer->availableForRead() < XFADE_PREBUFFER && !sh->fileFinished) return;
+
+        if (s->active) setStreamGainRamp(idx, 0, xfade.fadeMs);
+        setStreamGainRamp(SHADOW_VOICE, GAIN_UNITY, xfade.fadeMs);
+        sh->paused = false;
+        syncMixVoice(SHADOW_VOICE);
+        xfade.fading = true;
+        return;
+    }
+
+    // Done when the old track is silent (or ended on its own)
+    if (!s->active || (mixVoices.gainQ30[idx] == 0 && mixVoices.gainTarget[idx] == 0)) {
+        finishCrossfade();
+    }
+}
+
+// =================================================================================
+//  TIMED FADES (FADE / STOP:n,ms)
+// =================================================================================
+// FADE moves the stream's fader (the gain ramp, 0..99 of its VOL level) over
+// the given time; VOL itself is left alone, so a later VOL still sets the
+// level the fader scales. Fading to 0 (FADE:n,0,ms or STOP:n,ms) releases the
+// stream once the mixer reaches silence and reports "S:n,idle,,0" to the port
+// that asked. Times above GAIN_RAMP_MAX_MS are clamped to it. A stream that
+// stops some other way first (end of file, STOP, a new PLAY) drops the pending
+// release, so there is no second report.
+
+bool fadeStream(int streamIdx, int targetVol, uint32_t ms, Stream* notify) {
+    if (streamIdx < 0 || streamIdx >= MAX_STREAMS) return false;
+    settleCrossfade(streamIdx);
+    AudioStream* s = &streams[streamIdx];
+    if (!s->active && !s->waitingForDecoder) return false;
+
+    targetVol = constrain(targetVol, 0, 99);
+    if (ms > GAIN_RAMP_MAX_MS) ms = GAIN_RAMP_MAX_MS;
+    int32_t target = (int32_t)(((int64_t)targetVol * GAIN_UNITY) / 99);
+    s->releaseOnFade = (target == 0) ? notify : nullptr;
+    setStreamGainRamp(streamIdx, target, ms);
+    return true;
+}
+
+bool fadeOutStream(int streamIdx, uint32_t ms, Stream* notify) {
+    return fadeStream(streamIdx, 0, ms, notify);
+}
+
+// Release streams whose fade to zero has finished (Core 0 loop)
+void serviceStreamFades() {
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        AudioStream* s = &streams[i];
+        Stream* notify = s->releaseOnFade;
+        if (!notify) continue;
+
+        // Paused or never started: the mixer won't finish the ramp, cut now
+        bool silent = mixVoices.gainQ30[i] == 0 && mixVoices.gainTarget[i] == 0;
+        if (!silent && s->active && !s->paused) continue;
+
+        s->releaseOnFade = nullptr;
+        stopStream(i);
+        clearStreamBookmark(i);
+        sendSerialResponseF(*notify, "S:%d,idle,,0", i);
+        log_message(String("Stream ") + i + ": Faded out");
+    }
+}
@@ -0,0 +1,262 @@
+#include "config.h"
+
+// =================================================================================
+//  TRIGGER INPUTS (MP3 Trigger style trigger pins)
+// =================================================================================
+// Spare GPIOs can each be bound to a sound in CHIRP.INI:
+//
+//   #TRIGGER <pin> <index>,<bank>,<page>[,<volume>] <mode>
+//   #TRIGGER 2 5,1,A EDGE        pin 2 plays Bank 1 sound 5
+//   #TRIGGER 3 1,2,B,80 RETRIG   pin 3 plays Bank 2 page B sound 1 at volume 80
+//
+// Pins are active low (internal pull-up; switch to GND), same as the panel
+// buttons, and go through the edge interrupt queue (input_events.cpp), so a
+// trigger doesn't wait for serial parsing or a poll. Modes:
+//   EDGE   - play on press; ignored while its sound is still playing
+//   RETRIG - every press restarts the sound (on the voice it already has)
+//   LEVEL  - play while held; a quick fade-out on release
+//
+// Latency is measured per trigger from the interrupt timestamp to (a) the
+// stream being started and (b) the mixer taking the first frame (stamped on
+// Core 1, so the TRIG numbers don't depend on how often we look). The worst
+// case path is the input task period (1ms) + the longest other task in that
+// scheduler pass + file open + refill up to the start threshold. Bank 1 (flash/PSRAM resident)
+// fits comfortably in TRIGGER_LATENCY_BUDGET_US; SD banks depend on the card.
+// Misses are counted; TRIG shows the numbers.
+
+#define TRIGGER_LEVEL_RELEASE_MS 20
+
+enum TriggerMode {
+    TRIGGER_EDGE,
+    TRIGGER_RETRIG,
+    TRIGGER_LEVEL
+};
+
+struct TriggerInput {
+    uint8_t pin;
+    uint8_t mode;
+    uint8_t bank;
+    char page;
+    int index;
+    int volume;
+    int input;             // input_events.cpp id
+    int stream;            // Voice it last started, -1 = none
+    char path[64];         // File it started there (to tell if it's still ours)
+
+    // Latency of the press in flight
+    bool pending;
+    uint32_t edgeUs;
+};
+
+static TriggerInput triggers[TRIGGER_MAX];
+static int triggerCount = 0;
+static int8_t triggerForInput[INPUT_MAX];
+
+// Latency stats (us)
+static uint32_t trigFires = 0;
+static uint32_t trigMeasured = 0;
+static uint64_t trigSumUs = 0;
+static uint32_t trigMaxUs = 0;
+static uint32_t trigMaxStartUs = 0;
+static uint32_t trigMisses = 0;
+
+static const char* modeName(uint8_t mode) {
+    switch (mode) {
+        case TRIGGER_EDGE:   return "EDGE";
+        case TRIGGER_RETRIG: return "RETRIG";
+        case TRIGGER_LEVEL:  return "LEVEL";
+        default:             return "?";
+    }
+}
+
+// Pins the board already uses
+static bool pinIsFree(int pin) {
+    const int used[] = { LED_PIN, SD_CS, SD_MISO, SD_MOSI, SD_SCK, I2S_BCLK, I2S_LRCK, I2S_DATA,
+                         NEOPIXEL_PIN, UART_TX, UART_RX, PIN_BTN_NAV, PIN_BTN_FWD, PIN_BTN_REV };
+    if (pin < 0 || pin > 29) return false;
+    for (unsigned i = 0; i < sizeof(used) / sizeof(used[0]); i++) {
+        if (used[i] == pin) return false;
+    }
+    for (int i = 0; i < triggerCount; i++) {
+        if (triggers[i].pin == pin) return false;
+    }
+    return true;
+}
+
+// ===================================
+// Config (parseIniFile, one #TRIGGER line)
+// ===================================
+// 'args' is everything after "#TRIGGER"
+bool addTriggerFromIni(const char* args) {
+    if (triggerCount >= TRIGGER_MAX) {
+        Serial.println("TRIGGER: ERROR - too many triggers");
+        return false;
+    }
+
+    int pin = -1, index = 0, bank = 1, volume = -1;
+    char page = 'A';
+    char modeStr[8] = "EDGE";
+    char spec[32] = {0};
+    if (sscanf(args, "%d %31s %7s", &pin, spec, modeStr) < 2) {
+        Serial.printf("TRIGGER: ERROR - bad line '%s'\n", args);
+        return false;
+    }
+
+    // index,bank,page[,volume] like PLAY
+    char* p = spec;
+    index = atoi(p);
+    if ((p = strchr(p, ',')) != nullptr) {
+        bank = atoi(++p);
+        if ((p = strchr(p, ',')) != nullptr) {
+            p++;
+            if (*p >= 'a' && *p <= 'z') page = *p - 32;
+            else if ((*p >= 'A' && *p <= 'Z') || *p == '0') page = (*p == '0') ? 0 : *p;
+            if ((p = strchr(p, ',')) != nullptr) volume = constrain(atoi(p + 1), 0, 99);
+        }
+    }
+
+    uint8_t mode;
+    if (strcasecmp(modeStr, "EDGE") == 0) mode = TRIGGER_EDGE;
+    else if (strcasecmp(modeStr, "RETRIG") == 0) mode = TRIGGER_RETRIG;
+    else if (strcasecmp(modeStr, "LEVEL") == 0) mode = TRIGGER_LEVEL;
+    else {
+        Serial.printf("TRIGGER: ERROR - unknown mode '%s'\n", modeStr);
+        return false;
+    }
+
+    if (!pinIsFree(pin)) {
+        Serial.printf("TRIGGER: ERROR - pin %d is not available\n", pin);
+        return false;
+    }
+    if (index < 1 || bank < 1 || bank > 6) {
+        Serial.printf("TRIGGER: ERROR - bad sound '%s'\n", spec);
+        return false;
+    }
+
+    TriggerInput* t = &triggers[triggerCount++];
+    memset(t, 0, sizeof(*t));
+    t->pin = pin;
+    t->mode = mode;
+    t->bank = bank;
+    t->page = page;
+    t->index = index;
+    t->volume = volume;
+    t->input = -1;
+    t->stream = -1;
+    return true;
+}
+
+// Re-emit the config (parseIniFile rewrites CHIRP.INI on a firmware update)
+void writeTriggerIni(Print& out) {
+    for (int i = 0; i < triggerCount; i++) {
+        TriggerInput* t = &triggers[i];
+        out.printf("#TRIGGER %d %d,%d,%c", t->pin, t->index, t->bank, t->page ? t->page : '0');
+        if (t->volume >= 0) out.printf(",%d", t->volume);
+        out.printf(" %s\n", modeName(t->mode));
+    }
+}
+
+// Is the voice this trigger started still playing its sound?
+static bool ownsStream(TriggerInput* t) {
+    if (t->stream < 0) return false;
+    AudioStream* s = &streams[t->stream];
+    return (s->active || s->waitingForDecoder) && strcmp(s->filename, t->path) == 0;
+}
+
+static void fireTrigger(TriggerInput* t, uint32_t edgeUs) {
+    int stream;
+    if (ownsStream(t)) {
+        if (t->mode == TRIGGER_EDGE) return; // One-shot: let it finish
+        stream = t->stream;                   // Retrigger in place
+    } else {
+        stream = getNextAvailableStream();
+    }
+
+    trigFires++;
+    int voice = playSound(stream, t->bank, t->page, t->index, t->volume, STREAM_PRIORITY_HIGH);
+    if (voice < 0) {
+        log_message(String("TRIGGER: pin ") + t->pin + " failed to start");
+        return;
+    }
+
+    uint32_t startUs = micros() - edgeUs;
+    if (startUs > trigMaxStartUs) trigMaxStartUs = startUs;
+
+    // Follow the stream slot (a crossfade lands on it when done)
+    t->stream = stream;
+    strncpy(t->path, streams[voice].filename, sizeof(t->path) - 1);
+    t->path[sizeof(t->path) - 1] = '\0';
+    t->pending = true;
+    t->edgeUs = edgeUs;
+}
+
+static void onTriggerInput(uint8_t input, uint8_t gesture, uint32_t edgeUs) {
+    if (input >= INPUT_MAX || triggerForInput[input] < 0) return;
+    TriggerInput* t = &triggers[triggerForInput[input]];
+
+    if (gesture == INPUT_PRESS) {
+        fireTrigger(t, edgeUs);
+    } else if (gesture == INPUT_RELEASE && t->mode == TRIGGER_LEVEL && ownsStream(t)) {
+        fadeOutStream(t->stream, TRIGGER_LEVEL_RELEASE_MS, &Serial);
+    }
+}
+
+// ===================================
+// Init (setup, after parseIniFile)
+// ===================================
+void initTriggerInputs() {
+    for (int i = 0; i < INPUT_MAX; i++) triggerForInput[i] = -1;
+
+    for (int i = 0; i < triggerCount; i++) {
+        TriggerInput* t = &triggers[i];
+        t->input = registerInput(t->pin, true, onTriggerInput);
+        if (t->input >= 0) triggerForInput[t->input] = i;
+        Serial.printf("  Trigger pin %d -> %d,%d,%c %s\n", t->pin, t->index, t->bank,
+                      t->page ? t->page : '0', modeName(t->mode));
+    }
+}
+
+// ===================================
+// Service (Core 0 scheduler task): first-audio latency
+// ===================================
+void serviceTriggerLatency() {
+    for (int i = 0; i < triggerCount; i++) {
+        TriggerInput* t = &triggers[i];
+        if (!t->pending) continue;
+
+        // Measure on whichever voice has the file (a crossfade starts it on
+        // the shadow voice)
+        int voice = -1;
+        if (ownsStream(t)) {
+            voice = t->stream;
+        } else if (streams[SHADOW_VOICE].active && strcmp(streams[SHADOW_VOICE].filename, t->path) == 0) {
+            voice = SHADOW_VOICE;
+        }
+        if (voice < 0) {
+            t->pending = false; // Stopped before it played
+            continue;
+        }
+        if (mixVoices.framesMixed[voice] == 0) continue;
+
+        uint32_t us = mixVoices.firstMixUs[voice] - t->edgeUs;
+        t->pending = false;
+        trigMeasured++;
+        trigSumUs += us;
+        if (us > trigMaxUs) trigMaxUs = us;
+        if (us > TRIGGER_LATENCY_BUDGET_US) trigMisses++;
+    }
+}
+
+// ===================================
+// Status (TRIG command)
+// ===================================
+void printTriggerStatus(Print& out) {
+    out.printf("TRIG:triggers %d,fired %lu,latency avg %luus max %luus (start max %luus),budget %luus,misses %lu\n",
+               triggerCount, trigFires, trigMeasured ? (uint32_t)(trigSumUs / trigMeasured) : 0,
+               trigMaxUs, trigMaxStartUs, (uint32_t)TRIGGER_LATENCY_BUDGET_US, trigMisses);
+    for (int i = 0; i < triggerCount; i++) {
+        TriggerInput* t = &triggers[i];
+        out.printf("TRIG:pin %d -> %d,%d,%c %s%s\n", t->pin, t->index, t->bank, t->page ? t->page : '0',
+                   modeName(t->mode), ownsStream(t) ? " (playing)" : "");
+    }
+}
@@ -0,0 +1,127 @@
+#include "config.h"
+
+// =================================================================================
+//  RIFF/WAVE PARSER
+// =================================================================================
+// Walks the chunk list instead of assuming the canonical 44-byte header, so
+// files exported from DAWs (LIST/bext/junk chunks, WAVE_FORMAT_EXTENSIBLE,
+// 24-bit or float samples) play correctly. Rules:
+//   - every chunk is padded to an even size (odd sizes get one pad byte)
+//   - chunk sizes are bounds-checked against the file size; a truncated data
+//     chunk is clamped, any other chunk running past the end stops the walk
+//   - the data size is trimmed to whole frames, so trailing chunks (ID3, LIST)
+//     are never played as audio
+// Supported: PCM 8/16/24/32-bit, IEEE float 32-bit, mono or stereo.
+
+#define WAVE_FORMAT_PCM        0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+#define WAV_MAX_CHUNKS 64 // Stop walking after this many chunks (corrupt file guard)
+
+static inline uint16_t le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static inline uint32_t le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+// Works for both LittleFS File and SdFat FsFile (same read/seek/size shape)
+template <typename F>
+static bool parseWav(F& f, WavInfo* info) {
+    uint32_t fileSize = f.size();
+    uint8_t hdr[12];
+
+    f.seek(0);
+    if (fileSize < 12 || f.read(hdr, 12) != 12) return false;
+    if (memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0) return false;
+
+    // The RIFF size may lie (streamed recordings write 0 or 0xFFFFFFFF); trust the file
+    uint32_t riffEnd = le32(hdr + 4);
+    riffEnd = (riffEnd >= 4 && riffEnd <= fileSize - 8) ? riffEnd + 8 : fileSize;
+
+    bool haveFmt = false;
+    bool haveData = false;
+    uint16_t formatTag = 0;
+    uint16_t channels = 0;
+    uint32_t pos = 12;
+
+    for (int n = 0; n < WAV_MAX_CHUNKS && pos + 8 <= riffEnd && !(haveFmt && haveData); n++) {
+        uint8_t ch[8];
+        f.seek(pos);
+        if (f.read(ch, 8) != 8) break;
+        uint32_t size = le32(ch + 4);
+        uint32_t body = pos + 8;
+
+        if (memcmp(ch, "fmt ", 4) == 0) {
+            uint8_t fmt[40];
+            if (size < 16 || size > riffEnd - body) return false;
+            uint32_t want = size < sizeof(fmt) ? size : sizeof(fmt);
+            if (f.read(fmt, want) != (int)want) return false;
+
+            formatTag = le16(fmt);
+            channels = le16(fmt + 2);
+            info->sampleRate = le32(fmt + 4);
+            info->blockAlign = le16(fmt + 12);
+            info->bitsPerSample = le16(fmt + 14);
+
+            // Extensible: real format is the first two bytes of the SubFormat GUID
+            if (formatTag == WAVE_FORMAT_EXTENSIBLE) {
+                if (want < 40 || le16(fmt + 16) < 22) return false;
+                formatTag = le16(fmt + 24);
+            }
+            haveFmt = true;
+
+        } else if (memcmp(ch, "data", 4) == 0) {
+            info->dataOffset = body;
+            uint32_t left = riffEnd - body;
+            info->dataSize = size > left ? left : size; // Truncated file: play what's there
+            haveData = true;
+        }
+
+        if (size > riffEnd - body) break; // Chunk runs off the end
+        pos = body + size + (size & 1);
+    }
+
+    if (!haveFmt || !haveData) return false;
+
+    // Map to a conversion kernel
+    uint16_t bits = info->bitsPerSample;
+    if (formatTag == WAVE_FORMAT_PCM) {
+        if (bits == 8) info->sampleFormat = WAV_FMT_U8;
+        else if (bits == 16) info->sampleFormat = WAV_FMT_S16;
+        else if (bits == 24) info->sampleFormat = WAV_FMT_S24;
+        else if (bits == 32) info->sampleFormat = WAV_FMT_S32;
+        else return false;
+    } else if (formatTag == WAVE_FORMAT_IEEE_FLOAT && bits == 32) {
+        info->sampleFormat = WAV_FMT_F32;
+    } else {
+        return false;
+    }
+
+    if (channels < 1 || channels > 2 || info->sampleRate == 0) return false;
+    if (info->blockAlign != channels * (bits / 8)) return false;
+    info->channels = channels;
+
+    info->dataSize -= info->dataSize % info->blockAlign;
+    f.seek(info->dataOffset);
+    return true;
+}
+
+// ===================================
+// Parse (leaves the file at the first sample)
+// ===================================
+bool parseWavFile(FsFile& f, WavInfo* info) {
+    return parseWav(f, info);
+}
+
+bool parseWavFile(File& f, WavInfo* info) {
+    return parseWav(f, info);
+}
+
+const char* wavFormatName(uint8_t sampleFormat) {
+    switch (sampleFormat) {
+        case WAV_FMT_U8:  return "PCM 8-bit";
+        case WAV_FMT_S16: return "PCM 16-bit";
+        case WAV_FMT_S24: return "PCM 24-bit";
+        case WAV_FMT_S32: return "PCM 32-bit";
+        case WAV_FMT_F32: return "Float 32-bit";
+        default:          return "Unknown";
+    }
+}
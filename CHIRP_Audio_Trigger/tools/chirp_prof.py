@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""
+chirp_prof.py - turn a CHIRP PROF:D dump into a flat and caller profile.
+
+The firmware's sampling profiler (PROF command) records the interrupted PC
+and LR on each core at a fixed rate. This maps those addresses onto the
+firmware ELF's symbols and prints, per core:
+
+  flat    - share of samples whose PC was in each function (where time goes)
+  callers - for the top functions, which functions their LR points into
+            (the caller, for a leaf; for a function that has already called
+            something else LR may be stale, so treat it as a hint)
+
+Usage:
+    python3 chirp_prof.py CHIRP_Audio.ino.elf dump.txt
+    python3 chirp_prof.py CHIRP_Audio.ino.elf --port /dev/ttyACM0   (needs pyserial)
+    python3 chirp_prof.py CHIRP_Audio.ino.elf dump.txt --top 40 --core 0
+
+Capture a dump by hand with PROF:ON, let it run (PROF shows progress), then
+PROF:D and save the "PROF:..." lines; anything else in the file is ignored.
+The ELF is in the Arduino build folder (Sketch > Export Compiled Binary, or
+the path printed with verbose compile output).
+
+Symbols come from arm-none-eabi-nm; pass --nm if it isn't on the PATH.
+"""
+
+import argparse
+import bisect
+import collections
+import subprocess
+import sys
+
+
+def load_symbols(elf, nm):
+    """Sorted list of (start, end, name) for code symbols."""
+    try:
+        out = subprocess.run([nm, "-n", "-C", "--defined-only", "--print-size", elf],
+                             check=True, capture_output=True, text=True).stdout
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit("chirp_prof: could not run %s on %s (%s)" % (nm, elf, e))
+
+    syms = []
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) == 4 and parts[2] in "tTwW":
+            addr, size, name = int(parts[0], 16), int(parts[1], 16), parts[3]
+        elif len(parts) == 3 and parts[1] in "tTwW":
+            addr, size, name = int(parts[0], 16), 0, parts[2]
+        else:
+            continue
+        syms.append((addr & ~1, size, name))
+    syms.sort()
+
+    # Symbols without a size run up to the next one
+    table = []
+    for i, (addr, size, name) in enumerate(syms):
+        end = addr + size if size else (syms[i + 1][0] if i + 1 < len(syms) else addr + 4)
+        table.append((addr, end, name))
+    return table
+
+
+class Symbolizer:
+    def __init__(self, table):
+        self.table = table
+        self.starts = [t[0] for t in table]
+
+    def name(self, addr):
+        i = bisect.bisect_right(self.starts, addr) - 1
+        if i >= 0 and addr < self.table[i][1]:
+            return self.table[i][2]
+        return "?? 0x%08x" % addr
+
+
+def read_samples(lines):
+    """(core, pc, lr) tuples from PROF:core,pc,lr lines."""
+    samples = []
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("PROF:") or line.startswith("PROF:END"):
+            continue
+        fields = line[5:].split(",")
+        if len(fields) != 3:
+            continue
+        try:
+            samples.append((int(fields[0]), int(fields[1], 16), int(fields[2], 16)))
+        except ValueError:
+            continue
+    return samples
+
+
+def capture(port, baud):
+    try:
+        import serial
+    except ImportError:
+        sys.exit("chirp_prof: --port needs pyserial (pip install pyserial)")
+    lines = []
+    with serial.Serial(port, baud, timeout=5) as s:
+        s.reset_input_buffer()
+        s.write(b"PROF:D\n")
+        while True:
+            raw = s.readline()
+            if not raw:
+                sys.exit("chirp_prof: timed out waiting for PROF:END")
+            line = raw.decode("ascii", "replace")
+            lines.append(line)
+            if line.startswith("PROF:END"):
+                return lines
+
+
+def report(core, samples, sym, top):
+    total = len(samples)
+    print("=== Core %d: %d samples ===" % (core, total))
+    if not total:
+        return
+
+    flat = collections.Counter()
+    callers = collections.defaultdict(collections.Counter)
+    for _, pc, lr in samples:
+        fn = sym.name(pc & ~1)
+        flat[fn] += 1
+        # LR is the return address (Thumb bit set); step back into the call
+        if lr & 0xF0000000 != 0xF0000000:  # Not an EXC_RETURN value
+            callers[fn][sym.name((lr & ~1) - 2)] += 1
+
+    print("\nFlat profile")
+    print("  %6s %6s  %s" % ("samples", "%", "function"))
+    cum = 0
+    for fn, n in flat.most_common(top):
+        cum += n
+        print("  %6d %5.1f%%  %s" % (n, 100.0 * n / total, fn))
+    rest = total - cum
+    if rest:
+        print("  %6d %5.1f%%  (%d other functions)" % (rest, 100.0 * rest / total, len(flat) - top))
+
+    print("\nCallers (from LR) of the top functions")
+    for fn, n in flat.most_common(min(top, 10)):
+        print("  %s (%d)" % (fn, n))
+        for caller, m in callers[fn].most_common(5):
+            print("      %5.1f%%  %s" % (100.0 * m / n, caller))
+    print()
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Symbolize a CHIRP PROF:D dump")
+    ap.add_argument("elf", help="firmware ELF (CHIRP_Audio.ino.elf)")
+    ap.add_argument("dump", nargs="?", help="saved PROF:D output (default: stdin)")
+    ap.add_argument("--port", help="read the dump straight from this serial port")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--nm", default="arm-none-eabi-nm")
+    ap.add_argument("--top", type=int, default=25, help="functions to list")
+    ap.add_argument("--core", type=int, choices=(0, 1), help="only this core")
+    args = ap.parse_args()
+
+    if args.port:
+        lines = capture(args.port, args.baud)
+    elif args.dump:
+        with open(args.dump, "r", errors="replace") as f:
+            lines = f.readlines()
+    else:
+        lines = sys.stdin.readlines()
+
+    samples = read_samples(lines)
+    if not samples:
+        sys.exit("chirp_prof: no PROF samples found")
+    sym = Symbolizer(load_symbols(args.elf, args.nm))
+
+    for core in (0, 1):
+        if args.core is not None and core != args.core:
+            continue
+        report(core, [s for s in samples if s[0] == core], sym, args.top)
+
+
+if __name__ == "__main__":
+    main()
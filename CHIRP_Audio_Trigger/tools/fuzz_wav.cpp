@@ -0,0 +1,266 @@
+// =================================================================================
+//  fuzz_wav.cpp - host fuzz target for the firmware's RIFF/WAVE parser
+// =================================================================================
+// Builds wav_format.cpp from the sketch unchanged, against the in-memory
+// FsFile/File shims below, and checks what parseWavFile() returns on every
+// input it accepts:
+//   - mono or stereo, a known sample format, blockAlign = channels * bytes
+//   - the data chunk lies inside the file and is whole frames
+//   - the file is left at the first sample
+// Anything else (or an ASan/UBSan report) aborts with the input saved.
+//
+// libFuzzer (clang):
+//     clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined fuzz_wav.cpp -o fuzz_wav
+//     ./fuzz_wav -seeds corpus/      (writes the built-in seed files, then exits)
+//     ./fuzz_wav corpus/
+//
+// Standalone (g++, no libFuzzer): a fixed-seed mutation loop over the same
+// seeds, so a run is reproducible.
+//     g++ -std=c++17 -g -O1 -fsanitize=address,undefined -DFUZZ_STANDALONE fuzz_wav.cpp -o fuzz_wav
+//     ./fuzz_wav 300000 [seed]       (iterations, PRNG seed)
+//     ./fuzz_wav file.wav ...        (replay inputs, e.g. a saved crash)
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// ===================================
+// Shims (stand in for config.h)
+// ===================================
+// Defining CONFIG_H makes wav_format.cpp's #include "config.h" a no-op. The
+// two types it needs are copied here: keep them in step with config.h.
+#define CONFIG_H
+
+enum WavSampleFormat {
+    WAV_FMT_U8 = 0,
+    WAV_FMT_S16,
+    WAV_FMT_S24,
+    WAV_FMT_S32,
+    WAV_FMT_F32
+};
+
+struct WavInfo {
+    uint8_t sampleFormat;
+    uint8_t channels;
+    uint16_t bitsPerSample;
+    uint16_t blockAlign;
+    uint32_t sampleRate;
+    uint32_t dataOffset;
+    uint32_t dataSize;
+};
+
+// Same read/seek/size shape as SdFat's FsFile and LittleFS's File
+struct MemFile {
+    const uint8_t* data = nullptr;
+    uint32_t len = 0;
+    uint32_t pos = 0;
+
+    uint32_t size() { return len; }
+    uint32_t position() { return pos; }
+    bool seek(uint32_t p) {
+        if (p > len) return false;
+        pos = p;
+        return true;
+    }
+    int read(void* buf, size_t n) {
+        uint32_t left = len - pos;
+        if (n > left) n = left;
+        memcpy(buf, data + pos, n);
+        pos += n;
+        return (int)n;
+    }
+};
+struct FsFile : MemFile {};
+struct File : MemFile {};
+
+#include "../Arduino_Sketches/CHIRP_Audio/wav_format.cpp"
+
+// ===================================
+// Target
+// ===================================
+static void check(bool ok, const char* what) {
+    if (ok) return;
+    fprintf(stderr, "fuzz_wav: invariant failed: %s\n", what);
+    abort();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size > 0xFFFFFFFFu) return 0;
+
+    // Exact-size copy, so ASan catches any read past the end
+    std::vector<uint8_t> copy(data, data + size);
+    FsFile f;
+    f.data = copy.data();
+    f.len = (uint32_t)size;
+
+    WavInfo info;
+    memset(&info, 0xA5, sizeof(info)); // Fields a success leaves unset show up
+    if (!parseWavFile(f, &info)) return 0;
+
+    check(info.channels == 1 || info.channels == 2, "channels");
+    check(info.sampleFormat <= WAV_FMT_F32, "sample format");
+    check(info.sampleRate != 0, "sample rate");
+    uint32_t bytes = info.sampleFormat == WAV_FMT_U8 ? 1 : info.sampleFormat == WAV_FMT_S16 ? 2 :
+                     info.sampleFormat == WAV_FMT_S24 ? 3 : 4;
+    check(info.bitsPerSample == bytes * 8, "bits per sample");
+    check(info.blockAlign == info.channels * bytes, "block align");
+    check(info.dataSize % info.blockAlign == 0, "whole frames");
+    check(info.dataOffset >= 12 && info.dataOffset <= size, "data offset");
+    check(info.dataSize <= size - info.dataOffset, "data inside the file");
+    check(f.position() == info.dataOffset, "left at the first sample");
+    return 0;
+}
+
+// ===================================
+// Seeds
+// ===================================
+static void put16(std::string& s, uint16_t v) { s += (char)(v & 0xFF); s += (char)(v >> 8); }
+static void put32(std::string& s, uint32_t v) { put16(s, v & 0xFFFF); put16(s, v >> 16); }
+
+static std::string chunk(const char* id, const std::string& body) {
+    std::string s(id, 4);
+    put32(s, (uint32_t)body.size());
+    s += body;
+    if (body.size() & 1) s += '\0';
+    return s;
+}
+
+static std::string fmtBody(uint16_t tag, uint16_t ch, uint32_t rate, uint16_t bits, bool extensible) {
+    std::string b;
+    put16(b, extensible ? 0xFFFE : tag);
+    put16(b, ch);
+    put32(b, rate);
+    put32(b, rate * ch * (bits / 8));
+    put16(b, ch * (bits / 8));
+    put16(b, bits);
+    if (extensible) {
+        put16(b, 22);
+        put16(b, bits);
+        put32(b, ch == 2 ? 3 : 4);
+        put16(b, tag);
+        b += std::string("\x00\x00\x00\x00\x10\x00\x80\x00\x00\xAA\x00\x38\x9B\x71", 14);
+    }
+    return b;
+}
+
+static std::string wav(const std::vector<std::string>& chunks, int32_t riffSize = -1) {
+    std::string body = "WAVE";
+    for (const std::string& c : chunks) body += c;
+    std::string s = "RIFF";
+    put32(s, riffSize < 0 ? (uint32_t)body.size() : (uint32_t)riffSize);
+    return s + body;
+}
+
+static std::vector<std::string> seeds() {
+    std::string pcm(64, '\x11');
+    return {
+        wav({ chunk("fmt ", fmtBody(1, 2, 44100, 16, false)), chunk("data", pcm) }),
+        wav({ chunk("fmt ", fmtBody(1, 1, 22050, 8, false)), chunk("data", pcm.substr(0, 33)) }),
+        wav({ chunk("LIST", "INFOISFT\x05\x00\x00\x00test\x00"), chunk("fmt ", fmtBody(1, 2, 48000, 24, true)),
+              chunk("data", pcm.substr(0, 60)), chunk("id3 ", "ID3") }),
+        wav({ chunk("fmt ", fmtBody(3, 2, 44100, 32, false)), chunk("fact", "\x10\x00\x00\x00"),
+              chunk("data", pcm) }),
+        wav({ chunk("fmt ", fmtBody(1, 2, 44100, 32, true)), chunk("data", pcm) }, 0),            // Streamed: RIFF size 0
+        wav({ chunk("fmt ", fmtBody(1, 1, 44100, 16, false)), chunk("data", pcm) }).substr(0, 70),     // Truncated
+    };
+}
+
+#ifdef FUZZ_STANDALONE
+// ===================================
+// Standalone driver
+// ===================================
+static uint64_t rng;
+static uint32_t rnd(uint32_t n) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    return n ? (uint32_t)(rng % n) : 0;
+}
+
+static const uint32_t interesting[] = { 0, 1, 2, 3, 4, 7, 8, 15, 16, 18, 22, 40, 0x7F, 0x80, 0xFF, 0x100,
+                                        0xFFFE, 0xFFFF, 0x7FFFFFFF, 0x80000000u, 0xFFFFFFF7u, 0xFFFFFFFFu };
+
+static void mutate(std::string& s) {
+    int n = 1 + rnd(4);
+    for (int k = 0; k < n; k++) {
+        uint32_t at = rnd((uint32_t)s.size() + 1);
+        switch (rnd(6)) {
+            case 0: if (!s.empty()) s[rnd(s.size())] ^= (char)(1 << rnd(8)); break;        // Bit flip
+            case 1: if (!s.empty()) s[rnd(s.size())] = (char)rnd(256); break;             // Byte
+            case 2: s.resize(rnd((uint32_t)s.size() + 1)); break;                         // Truncate
+            case 3: {                                                                     // 16/32-bit field
+                uint32_t v = interesting[rnd(sizeof(interesting) / sizeof(interesting[0]))];
+                int w = rnd(2) ? 4 : 2;
+                for (int b = 0; b < w && at + b < s.size(); b++) s[at + b] = (char)(v >> (8 * b));
+                break;
+            }
+            case 4: s.insert(at, std::string(1 + rnd(16), (char)rnd(256))); break;          // Insert
+            case 5: if (at < s.size()) s.erase(at, 1 + rnd(16)); break;                    // Delete
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    // Replay files
+    if (argc > 1 && !isdigit((unsigned char)argv[1][0])) {
+        for (int i = 1; i < argc; i++) {
+            FILE* fp = fopen(argv[i], "rb");
+            if (!fp) { perror(argv[i]); return 1; }
+            std::string s;
+            char buf[4096];
+            size_t r;
+            while ((r = fread(buf, 1, sizeof(buf), fp)) > 0) s.append(buf, r);
+            fclose(fp);
+            LLVMFuzzerTestOneInput((const uint8_t*)s.data(), s.size());
+            printf("%s: ok\n", argv[i]);
+        }
+        return 0;
+    }
+
+    long iterations = argc > 1 ? atol(argv[1]) : 100000;
+    rng = argc > 2 ? strtoull(argv[2], nullptr, 0) : 0x43484952505741ull;
+    std::vector<std::string> pool = seeds();
+    long accepted = 0;
+    for (long i = 0; i < iterations; i++) {
+        std::string s = pool[rnd((uint32_t)pool.size())];
+        mutate(s);
+        FILE* fp = fopen("fuzz_wav_last.bin", "wb"); // Input that crashed, if it does
+        if (fp) { fwrite(s.data(), 1, s.size(), fp); fclose(fp); }
+        LLVMFuzzerTestOneInput((const uint8_t*)s.data(), s.size());
+
+        // Keep some accepted inputs around so later mutations go deeper
+        FsFile f;
+        f.data = (const uint8_t*)s.data();
+        f.len = (uint32_t)s.size();
+        WavInfo info;
+        if (parseWavFile(f, &info)) {
+            accepted++;
+            if (pool.size() < 256) pool.push_back(s);
+            else pool[6 + rnd(250)] = s;
+        }
+    }
+    remove("fuzz_wav_last.bin");
+    printf("fuzz_wav: %ld inputs, %ld accepted, no failures\n", iterations, accepted);
+    return 0;
+}
+#else
+// libFuzzer: "-seeds dir" writes the built-in seeds as a starting corpus
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv) {
+    for (int i = 1; i + 1 < *argc; i++) {
+        if (strcmp((*argv)[i], "-seeds") != 0) continue;
+        std::vector<std::string> all = seeds();
+        for (size_t k = 0; k < all.size(); k++) {
+            std::string path = std::string((*argv)[i + 1]) + "/seed" + std::to_string(k) + ".wav";
+            FILE* fp = fopen(path.c_str(), "wb");
+            if (!fp) { perror(path.c_str()); exit(1); }
+            fwrite(all[k].data(), 1, all[k].size(), fp);
+            fclose(fp);
+        }
+        printf("fuzz_wav: wrote %zu seeds to %s\n", all.size(), (*argv)[i + 1]);
+        exit(0);
+    }
+    return 0;
+}
+#endif
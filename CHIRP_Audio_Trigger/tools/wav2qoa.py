@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""
+wav2qoa.py - convert WAV files to QOA for the CHIRP Audio Trigger SD banks.
+
+QOA ("Quite OK Audio", https://qoaformat.org) stores 16-bit audio at a fixed
+3.2 bits/sample. The CHIRP firmware decodes it for about the CPU cost of a WAV
+while reading ~5x less data from the SD card, so more SD streams can run at once.
+
+Usage:
+    python3 wav2qoa.py sound.wav              -> sound.qoa next to it
+    python3 wav2qoa.py sound.wav out.qoa
+    python3 wav2qoa.py /path/to/bank_dir      -> converts every .wav in the folder
+    python3 wav2qoa.py --verify sound.wav     -> also decodes the result and prints SNR
+
+Input must be 8 or 16-bit PCM, mono or stereo. The firmware plays 44100 Hz
+and 22050 Hz sources at the right speed; resample anything else first.
+
+Pure Python, no dependencies. The encoder tries all 16 scalefactors per slice,
+so expect a few seconds per second of stereo audio.
+"""
+
+import os
+import struct
+import sys
+import wave
+
+SLICE_LEN = 20
+FRAME_LEN = 256 * SLICE_LEN  # Samples per channel per frame (5120)
+
+
+def _round(x):
+    return int(x + 0.5) if x > 0 else -int(0.5 - x)
+
+
+SCALEFACTOR_TAB = [_round((s + 1) ** 2.75) for s in range(16)]
+RECIPROCAL_TAB = [((1 << 16) + sf - 1) // sf for sf in SCALEFACTOR_TAB]
+DEQUANT_TAB = [[_round(sf * d) for d in (0.75, -0.75, 2.5, -2.5, 4.5, -4.5, 7, -7)]
+               for sf in SCALEFACTOR_TAB]
+QUANT_TAB = [7, 7, 7, 5, 5, 3, 3, 1,  # -8..-1
+             0,                       #  0
+             0, 2, 2, 4, 4, 6, 6, 6]  #  1.. 8
+
+
+def _clamp(v, lo, hi):
+    return lo if v < lo else hi if v > hi else v
+
+
+def _sign(v):
+    return (v > 0) - (v < 0)
+
+
+def _div(v, scalefactor):
+    # Rounding division by the scalefactor, same as the reference encoder
+    n = (v * RECIPROCAL_TAB[scalefactor] + (1 << 15)) >> 16
+    return n + _sign(v) - _sign(n)
+
+
+class Lms:
+    def __init__(self):
+        self.history = [0, 0, 0, 0]
+        self.weights = [0, 0, -(1 << 13), 1 << 14]
+
+    def copy(self):
+        c = Lms()
+        c.history = self.history[:]
+        c.weights = self.weights[:]
+        return c
+
+    def predict(self):
+        h, w = self.history, self.weights
+        return (h[0] * w[0] + h[1] * w[1] + h[2] * w[2] + h[3] * w[3]) >> 13
+
+    def update(self, sample, residual):
+        delta = residual >> 4
+        for i in range(4):
+            self.weights[i] += -delta if self.history[i] < 0 else delta
+        self.history = self.history[1:] + [sample]
+
+
+def _pack16(values):
+    return b"".join(struct.pack(">h", _clamp(v, -32768, 32767)) for v in values)
+
+
+def encode(samples, channels, rate):
+    """samples: interleaved int16 list. Returns the QOA file as bytes."""
+    total = len(samples) // channels
+    out = bytearray(b"qoaf" + struct.pack(">I", total))
+    lms = [Lms() for _ in range(channels)]
+
+    for frame_start in range(0, total, FRAME_LEN):
+        frame_len = min(FRAME_LEN, total - frame_start)
+        slices = (frame_len + SLICE_LEN - 1) // SLICE_LEN
+        frame_size = 8 + 16 * channels + 8 * slices * channels
+        out += struct.pack(">B", channels) + struct.pack(">I", rate)[1:]
+        out += struct.pack(">HH", frame_len, frame_size)
+
+        for c in range(channels):
+            out += _pack16(lms[c].history) + _pack16(lms[c].weights)
+
+        for si in range(0, frame_len, SLICE_LEN):
+            slice_len = min(SLICE_LEN, frame_len - si)
+            for c in range(channels):
+                best_err, best_slice, best_lms = None, 0, None
+                for sf in range(16):
+                    trial = lms[c].copy()
+                    word = sf
+                    err = 0
+                    for k in range(slice_len):
+                        sample = samples[(frame_start + si + k) * channels + c]
+                        predicted = trial.predict()
+                        q = QUANT_TAB[_clamp(_div(sample - predicted, sf), -8, 8) + 8]
+                        dq = DEQUANT_TAB[sf][q]
+                        rec = _clamp(predicted + dq, -32768, 32767)
+                        err += (sample - rec) ** 2
+                        if best_err is not None and err >= best_err:
+                            break
+                        trial.update(rec, dq)
+                        word = (word << 3) | q
+                    else:
+                        if best_err is None or err < best_err:
+                            best_err, best_slice, best_lms = err, word, trial
+                best_slice <<= (SLICE_LEN - slice_len) * 3
+                lms[c] = best_lms
+                out += struct.pack(">Q", best_slice)
+    return bytes(out)
+
+
+def decode(data):
+    """Returns (interleaved int16 list, channels, rate). Mirrors qoa_decoder.cpp."""
+    if data[:4] != b"qoaf":
+        raise ValueError("not a QOA file")
+    pos = 8
+    pcm, channels, rate = [], 0, 0
+    while pos + 8 <= len(data):
+        channels = data[pos]
+        rate = struct.unpack(">I", b"\0" + data[pos + 1:pos + 4])[0]
+        frame_len, frame_size = struct.unpack(">HH", data[pos + 4:pos + 8])
+        p = pos + 8
+        lms = []
+        for _ in range(channels):
+            l = Lms()
+            l.history = list(struct.unpack(">4h", data[p:p + 8]))
+            l.weights = list(struct.unpack(">4h", data[p + 8:p + 16]))
+            lms.append(l)
+            p += 16
+        frame = [0] * (frame_len * channels)
+        for si in range(0, frame_len, SLICE_LEN):
+            for c in range(channels):
+                word = struct.unpack(">Q", data[p:p + 8])[0]
+                p += 8
+                sf = word >> 60
+                for k in range(min(SLICE_LEN, frame_len - si)):
+                    q = (word >> (57 - 3 * k)) & 7
+                    dq = DEQUANT_TAB[sf][q]
+                    rec = _clamp(lms[c].predict() + dq, -32768, 32767)
+                    frame[(si + k) * channels + c] = rec
+                    lms[c].update(rec, dq)
+        pcm += frame
+        pos += frame_size
+    return pcm, channels, rate
+
+
+def read_wav(path):
+    with wave.open(path, "rb") as w:
+        channels, width, rate = w.getnchannels(), w.getsampwidth(), w.getframerate()
+        raw = w.readframes(w.getnframes())
+    if channels not in (1, 2):
+        raise ValueError("%d channels (only mono or stereo)" % channels)
+    if width == 2:
+        samples = list(struct.unpack("<%dh" % (len(raw) // 2), raw))
+    elif width == 1:
+        samples = [(b - 128) << 8 for b in raw]
+    else:
+        raise ValueError("%d-bit samples (convert to 16-bit first)" % (width * 8))
+    return samples, channels, rate
+
+
+def snr_db(ref, test):
+    import math
+    signal = sum(s * s for s in ref) or 1
+    noise = sum((a - b) ** 2 for a, b in zip(ref, test)) or 1
+    return 10 * math.log10(signal / noise)
+
+
+def convert(src, dst, verify):
+    samples, channels, rate = read_wav(src)
+    if rate not in (44100, 22050):
+        print("  warning: %d Hz will play at the wrong speed (use 44100 or 22050)" % rate)
+    data = encode(samples, channels, rate)
+    with open(dst, "wb") as f:
+        f.write(data)
+    wav_size = os.path.getsize(src)
+    print("%s -> %s  (%d ch, %d Hz, %d KB -> %d KB, %.1fx smaller)" % (
+        os.path.basename(src), os.path.basename(dst), channels, rate,
+        wav_size // 1024, len(data) // 1024, wav_size / max(len(data), 1)))
+    if verify:
+        decoded, _, _ = decode(data)
+        print("  verify: SNR %.1f dB" % snr_db(samples, decoded))
+
+
+def main(argv):
+    verify = "--verify" in argv
+    args = [a for a in argv if a != "--verify"]
+    if not args:
+        print(__doc__)
+        return 1
+
+    src = args[0]
+    if os.path.isdir(src):
+        for name in sorted(os.listdir(src)):
+            if name.lower().endswith(".wav"):
+                path = os.path.join(src, name)
+                convert(path, os.path.splitext(path)[0] + ".qoa", verify)
+    else:
+        dst = args[1] if len(args) > 1 else os.path.splitext(src)[0] + ".qoa"
+        convert(src, dst, verify)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))